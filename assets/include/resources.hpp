@@ -23,7 +23,9 @@ namespace resources
 using Binary_resource = std::vector<unsigned char>;
 
 extern const Binary_resource file_HarmonyOS_Sans_Regular_ttf_, file_shaders_generator_frag_,
-	file_shaders_common_vert_, file_shaders_shader_test_frag_;
+	file_shaders_common_vert_, file_shaders_shader_test_frag_, file_shaders_kernel_glsl_,
+	file_shaders_generator_comp_, file_shaders_colorize_frag_, file_shaders_compaction_comp_,
+	file_shaders_batch_comp_, file_shaders_points_comp_, file_shaders_row_costs_comp_;
 
 inline std::string to_string(const Binary_resource& resource)
 {
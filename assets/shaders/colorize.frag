@@ -0,0 +1,12 @@
+#version 420
+
+// Map an iteration map produced by a compute or CPU kernel to colors
+
+out vec4 color;
+
+layout(binding = 1) uniform sampler2D iteration_map;
+
+void main()
+{
+	color = shade(texelFetch(iteration_map, ivec2(gl_FragCoord.xy), 0).xy);
+}
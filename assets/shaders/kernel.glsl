@@ -0,0 +1,756 @@
+// Shared kernel body, inserted after the #version line of every kernel stage.
+// Specialised by Shader_variant_cache, which injects these switches:
+//   PRECISION_FP32 | PRECISION_FP64 | PRECISION_DD | PRECISION_FIXED
+//   FORMULA_MANDELBROT | FORMULA_JULIA | FORMULA_BURNING_SHIP | FORMULA_TRICORN | FORMULA_MULTIBROT
+//   FORMULA_POWER, FORMULA_FIXED_NORM2, FORMULA_STEP(...), FORMULA_DERIVATIVE(...), generated
+//   from the formula policies of formula.hpp
+//   COLORING_ITERATION | COLORING_SMOOTH | COLORING_DISTANCE
+//   UNROLL 1 | 2 | 4 | 8
+//   BAILOUT_INTERVAL 1 | 4 | 8 | 16
+//   FEATURE_PERIODICITY, FEATURE_DERIVATIVE
+// Stages may add their own switches, BATCH_RENDER replaces the Render_params block by globals.
+// Disabled features are removed by the preprocessor and cost nothing in the inner loop.
+
+#if !defined(PRECISION_FP32) && !defined(PRECISION_DD) && !defined(PRECISION_FIXED)
+#define PRECISION_FP64
+#endif
+
+#ifdef PRECISION_FIXED
+#extension GL_ARB_gpu_shader_int64 : require
+#endif
+
+#if !defined(COLORING_ITERATION) && !defined(COLORING_SMOOTH) && !defined(COLORING_DISTANCE)
+#define COLORING_ITERATION
+#endif
+
+#ifndef FORMULA_STEP
+#error "Formula macros missing, kernel stages are compiled with Kernel_variant::defines()"
+#endif
+
+#ifndef UNROLL
+#define UNROLL 1
+#endif
+
+#ifndef BAILOUT_INTERVAL
+#define BAILOUT_INTERVAL 1
+#endif
+
+#if defined(COLORING_DISTANCE) && !defined(FEATURE_DERIVATIVE)
+#define FEATURE_DERIVATIVE
+#endif
+
+#ifdef PRECISION_FP64
+#define REAL double
+#define REAL2 dvec2
+#define PERIODICITY_EPSILON 1e-24
+#elif defined(PRECISION_DD)
+// Double-double: the orbit is the unevaluated sum of a leading REAL2 and a trailing `z_lo`.
+// Escape tests, derivatives and outputs read the leading part, only the orbit itself and the
+// periodicity test need both.
+#define REAL double
+#define REAL2 dvec2
+#define PERIODICITY_EPSILON 1e-56
+#elif defined(PRECISION_FIXED)
+// 128-bit fixed point: inside the escape circle the orbit is iterated in `z_fixed`, REAL2 z is
+// its rounded copy for escape tests, derivatives and outputs. Orbits leaving the circle go on
+// in double, their remaining steps no longer need the bits.
+#define REAL double
+#define REAL2 dvec2
+#define PERIODICITY_EPSILON 1e-66
+#else
+#define REAL float
+#define REAL2 vec2
+#define PERIODICITY_EPSILON 1e-12
+#endif
+
+// Smooth and distance colouring need a large escape radius for a stable log(log(|z|))
+#ifdef COLORING_ITERATION
+#define ESCAPE_RADIUS2 4.0
+#else
+#define ESCAPE_RADIUS2 65536.0
+#endif
+
+layout(binding = 0) uniform sampler1D palette;
+
+#ifdef BATCH_RENDER
+// Batch kernels render a different view in every invocation, they set these from their view
+// list before calling into the kernel
+dvec2 center;
+dvec2 size;
+int max_iter;
+int palette_cycle;
+dvec2 julia_c;
+dvec2 center_lo;
+#else
+layout(std140, binding = 0) uniform Render_params
+{
+	dvec2 center;
+	dvec2 size;
+	int max_iter;
+	int palette_cycle;
+	dvec2 julia_c;	  // Parameter of FORMULA_JULIA
+	dvec2 center_lo;  // Trailing part of the double-double center
+};
+#endif
+
+#ifdef PRECISION_DD
+// Point of the plane as (x, y) leading parts followed by (x, y) trailing parts
+#define POINT dvec4
+#elif defined(PRECISION_FIXED)
+// Point of the plane as fixed-point (x, y), see fixed_from_double()
+#define POINT u64vec4
+#else
+#define POINT REAL2
+#endif
+
+#ifdef PRECISION_DD
+// Error-free transformations of double-double arithmetic, `precise` keeps the compiler from
+// reassociating away the rounding errors they recover. A value is a dvec2 (leading, trailing).
+
+dvec2 dd_two_sum(double a, double b)
+{
+	precise double s = a + b;
+	precise double v = s - a;
+	precise double e = (a - (s - v)) + (b - v);
+	return dvec2(s, e);
+}
+
+dvec2 dd_quick_two_sum(double a, double b)
+{
+	precise double s = a + b;
+	precise double e = b - (s - a);
+	return dvec2(s, e);
+}
+
+dvec2 dd_add(dvec2 a, dvec2 b)
+{
+	dvec2 s = dd_two_sum(a.x, b.x);
+	dvec2 t = dd_two_sum(a.y, b.y);
+	s		= dd_quick_two_sum(s.x, s.y + t.x);
+	return dd_quick_two_sum(s.x, s.y + t.y);
+}
+
+// Product error through a Dekker split rather than fma(), which drivers may emulate for
+// doubles without a single rounding
+dvec2 dd_mul(dvec2 a, dvec2 b)
+{
+	precise double p  = a.x * b.x;
+	precise double ta = 134217729.0 * a.x;
+	precise double ah = ta - (ta - a.x);
+	precise double al = a.x - ah;
+	precise double tb = 134217729.0 * b.x;
+	precise double bh = tb - (tb - b.x);
+	precise double bl = b.x - bh;
+	precise double e  = (((ah * bh - p) + ah * bl) + al * bh) + al * bl;
+	precise double f  = e + (a.x * b.y + a.y * b.x);
+	return dd_quick_two_sum(p, f);
+}
+
+dvec2 dd_sub(dvec2 a, dvec2 b)
+{
+	return dd_add(a, -b);
+}
+#endif
+
+#ifdef PRECISION_FIXED
+// Q4.124 two's complement numbers in two 64-bit limbs (low, high): 4 integer bits hold every
+// value a step from |z|^FORMULA_POWER < 4 can reach, see formula_fixed()
+#define FIXED_FRACTION_BITS 124
+#define FIXED_MASK32		0xFFFFFFFFul
+
+u64vec2 fixed_add(u64vec2 a, u64vec2 b)
+{
+	uint64_t lo = a.x + b.x;
+	return u64vec2(lo, a.y + b.y + (lo < a.x ? 1ul : 0ul));
+}
+
+u64vec2 fixed_negate(u64vec2 a)
+{
+	return fixed_add(~a, u64vec2(1ul, 0ul));
+}
+
+u64vec2 fixed_sub(u64vec2 a, u64vec2 b)
+{
+	return fixed_add(a, fixed_negate(b));
+}
+
+bool fixed_is_negative(u64vec2 a)
+{
+	return int64_t(a.y) < 0l;
+}
+
+// Add the 64-bit product a * b to the 32-bit columns `low` and `high` above it
+void fixed_mac(uint a, uint b, inout uint64_t low, inout uint64_t high)
+{
+	uint product_high, product_low;
+	umulExtended(a, b, product_high, product_low);
+	low += uint64_t(product_low);
+	high += uint64_t(product_high);
+}
+
+// Twice the product, for the symmetric terms of a square
+void fixed_mac2(uint a, uint b, inout uint64_t low, inout uint64_t high)
+{
+	uint product_high, product_low;
+	umulExtended(a, b, product_high, product_low);
+	low += uint64_t(product_low) << 1;
+	high += uint64_t(product_high) << 1;
+}
+
+// Bits 124 to 251 of the 256-bit product in columns c3 to c7, propagating the carries from c2.
+// Shifts drop the carried bits of each column.
+u64vec2 fixed_columns(uint64_t c2, uint64_t c3, uint64_t c4, uint64_t c5, uint64_t c6, uint64_t c7)
+{
+	c3 += c2 >> 32;
+	c4 += c3 >> 32;
+	c5 += c4 >> 32;
+	c6 += c5 >> 32;
+	c7 += c6 >> 32;
+
+	return u64vec2((c3 & FIXED_MASK32) >> 28 | (c4 & FIXED_MASK32) << 4 | c5 << 36,
+				   (c5 & FIXED_MASK32) >> 28 | (c6 & FIXED_MASK32) << 4 | c7 << 36);
+}
+
+// Product of magnitudes from 32-bit partial products accumulated in 64-bit columns, written
+// out since local arrays end up in memory on some drivers. Columns below 2^64 are left out,
+// they move the result by less than 2^-27 of its last bit.
+u64vec2 fixed_umul(u64vec2 a, u64vec2 b)
+{
+	uint a0 = uint(a.x), a1 = uint(a.x >> 32), a2 = uint(a.y), a3 = uint(a.y >> 32);
+	uint b0 = uint(b.x), b1 = uint(b.x >> 32), b2 = uint(b.y), b3 = uint(b.y >> 32);
+
+	uint64_t c2 = 0ul, c3 = 0ul, c4 = 0ul, c5 = 0ul, c6 = 0ul, c7 = 0ul;
+	fixed_mac(a0, b2, c2, c3);
+	fixed_mac(a1, b1, c2, c3);
+	fixed_mac(a2, b0, c2, c3);
+	fixed_mac(a0, b3, c3, c4);
+	fixed_mac(a1, b2, c3, c4);
+	fixed_mac(a2, b1, c3, c4);
+	fixed_mac(a3, b0, c3, c4);
+	fixed_mac(a1, b3, c4, c5);
+	fixed_mac(a2, b2, c4, c5);
+	fixed_mac(a3, b1, c4, c5);
+	fixed_mac(a2, b3, c5, c6);
+	fixed_mac(a3, b2, c5, c6);
+	fixed_mac(a3, b3, c6, c7);
+
+	return fixed_columns(c2, c3, c4, c5, c6, c7);
+}
+
+// fixed_umul(a, a) with the symmetric partial products computed once
+u64vec2 fixed_usquare(u64vec2 a)
+{
+	uint a0 = uint(a.x), a1 = uint(a.x >> 32), a2 = uint(a.y), a3 = uint(a.y >> 32);
+
+	uint64_t c2 = 0ul, c3 = 0ul, c4 = 0ul, c5 = 0ul, c6 = 0ul, c7 = 0ul;
+	fixed_mac2(a0, a2, c2, c3);
+	fixed_mac(a1, a1, c2, c3);
+	fixed_mac2(a0, a3, c3, c4);
+	fixed_mac2(a1, a2, c3, c4);
+	fixed_mac2(a1, a3, c4, c5);
+	fixed_mac(a2, a2, c4, c5);
+	fixed_mac2(a2, a3, c5, c6);
+	fixed_mac(a3, a3, c6, c7);
+
+	return fixed_columns(c2, c3, c4, c5, c6, c7);
+}
+
+u64vec2 fixed_mul(u64vec2 a, u64vec2 b)
+{
+	bool	a_negative = fixed_is_negative(a), b_negative = fixed_is_negative(b);
+	u64vec2 p		   = fixed_umul(a_negative ? fixed_negate(a) : a, b_negative ? fixed_negate(b) : b);
+	return a_negative != b_negative ? fixed_negate(p) : p;
+}
+
+u64vec2 fixed_square(u64vec2 a)
+{
+	return fixed_usquare(fixed_is_negative(a) ? fixed_negate(a) : a);
+}
+
+// Exact for every double above 2^-124 in magnitude and below 8, lower bits are truncated.
+// Scaling multiplies by powers of two instead of ldexp(), and conversions go through signed
+// 32-bit halves, drivers get both wrong for doubles.
+#define FIXED_TWO_32 4294967296.0LF
+#define FIXED_TWO_60 1152921504606846976.0LF
+
+u64vec2 fixed_from_double_magnitude(double v)
+{
+	double scaled = v * FIXED_TWO_60;
+	double high	  = floor(scaled);
+	double middle = (scaled - high) * FIXED_TWO_32;
+	double upper  = floor(middle);
+	double lower  = (middle - upper) * FIXED_TWO_32;
+	return u64vec2(uint64_t(int64_t(upper) << 32 | int64_t(lower)), uint64_t(int64_t(high)));
+}
+
+u64vec2 fixed_from_double(double v)
+{
+	// Splitting a negative value would round its low bits against the integer part
+	if (v < 0.0) return fixed_negate(fixed_from_double_magnitude(-v));
+	return fixed_from_double_magnitude(v);
+}
+
+double fixed_to_double(u64vec2 a)
+{
+	double lower = double(int64_t(a.x & FIXED_MASK32)) / FIXED_TWO_32;
+	double upper = (double(int64_t(a.x >> 32)) + lower) / FIXED_TWO_32;
+	return (double(int64_t(a.y)) + upper) / FIXED_TWO_60;
+}
+#endif
+
+// Point sampled at `ndc` of the view, see pixel_to_complex() of the CPU kernel
+POINT sample_point(vec2 ndc)
+{
+#ifdef PRECISION_DD
+	// The offset from the center is far smaller than the center in deep views, their exact sum
+	// keeps the bits of the offset that a double sum would round away
+	dvec2 offset = dvec2(ndc) * size / 2.0;
+	dvec2 x		 = dd_add(dvec2(center.x, center_lo.x), dvec2(offset.x, 0.0));
+	dvec2 y		 = dd_add(dvec2(center.y, center_lo.y), dvec2(offset.y, 0.0));
+	return dvec4(x.x, y.x, x.y, y.y);
+#elif defined(PRECISION_FIXED)
+	// Every term converts exactly, but for trailing bits of the center below the fraction, and
+	// the fixed-point sum keeps every bit of the offset
+	dvec2	offset = dvec2(ndc) * size / 2.0;
+	u64vec2 x	   = fixed_add(fixed_from_double(center.x), fixed_from_double(center_lo.x));
+	u64vec2 y	   = fixed_add(fixed_from_double(center.y), fixed_from_double(center_lo.y));
+	x			   = fixed_add(x, fixed_from_double(offset.x));
+	y			   = fixed_add(y, fixed_from_double(offset.y));
+	return u64vec4(x, y);
+#else
+	return REAL2(ndc) * REAL2(size) / 2.0 + REAL2(center);
+#endif
+}
+
+// Point given in double, converted exactly
+POINT point_from_double(dvec2 c)
+{
+#ifdef PRECISION_DD
+	return dvec4(c, 0.0, 0.0);
+#elif defined(PRECISION_FIXED)
+	return u64vec4(fixed_from_double(c.x), fixed_from_double(c.y));
+#else
+	return POINT(c);
+#endif
+}
+
+// Parameter the orbit of `point` iterates with. The Mandelbrot set iterates every point from
+// zero with the point as parameter, Julia sets iterate it from itself with `julia_c`.
+POINT orbit_parameter(POINT point)
+{
+#ifdef FORMULA_JULIA
+	return point_from_double(julia_c);
+#else
+	return point;
+#endif
+}
+
+struct Orbit
+{
+	REAL2 z;
+#ifdef PRECISION_DD
+	dvec2 z_lo;
+#elif defined(PRECISION_FIXED)
+	u64vec4 z_fixed;  // (x, y) as in POINT
+#endif
+#ifdef FEATURE_DERIVATIVE
+	REAL2 dz;
+#endif
+	int iter;
+#ifdef FEATURE_PERIODICITY
+	// Brent-style cycle detection: compare against a snapshot taken at doubling intervals
+	REAL2 snapshot;
+#ifdef PRECISION_DD
+	dvec2 snapshot_lo;
+#elif defined(PRECISION_FIXED)
+	u64vec4 snapshot_fixed;
+#endif
+	int	  next_snapshot;
+	bool  periodic;
+#endif
+};
+
+// Orbit of `point` before the first iteration, see orbit_parameter()
+Orbit orbit_start(POINT point)
+{
+	Orbit o;
+	o.iter = 0;
+#if defined(FORMULA_JULIA) && defined(PRECISION_DD)
+	o.z	   = point.xy;
+	o.z_lo = point.zw;
+#elif defined(FORMULA_JULIA) && defined(PRECISION_FIXED)
+	o.z_fixed = point;
+	o.z		  = REAL2(fixed_to_double(point.xy), fixed_to_double(point.zw));
+#elif defined(FORMULA_JULIA)
+	o.z = point;
+#else
+	o.z = REAL2(0.0);
+#ifdef PRECISION_DD
+	o.z_lo = dvec2(0.0);
+#elif defined(PRECISION_FIXED)
+	o.z_fixed = u64vec4(0ul);
+#endif
+#endif
+#ifdef FEATURE_DERIVATIVE
+	// Derivative with respect to the varying term, the parameter or the starting point
+#ifdef FORMULA_JULIA
+	o.dz = REAL2(1.0, 0.0);
+#else
+	o.dz = REAL2(0.0);
+#endif
+#endif
+#ifdef FEATURE_PERIODICITY
+	o.snapshot = REAL2(0.0);
+#ifdef PRECISION_DD
+	o.snapshot_lo = dvec2(0.0);
+#elif defined(PRECISION_FIXED)
+	o.snapshot_fixed = u64vec4(0ul);
+#endif
+	o.next_snapshot = 16;
+	o.periodic		= false;
+#endif
+	return o;
+}
+
+// Operations of the generated FORMULA_STEP and FORMULA_DERIVATIVE, overloaded for REAL and the
+// number types of the deeper precisions. `precise` keeps the compiler from contracting them
+// into FMAs differently depending on the call site, so that checked and deferred-bailout loops
+// follow bit-identical orbits.
+REAL f_add(REAL a, REAL b)
+{
+	precise REAL r = a + b;
+	return r;
+}
+
+REAL f_sub(REAL a, REAL b)
+{
+	precise REAL r = a - b;
+	return r;
+}
+
+REAL f_mul(REAL a, REAL b)
+{
+	precise REAL r = a * b;
+	return r;
+}
+
+REAL f_square(REAL a)
+{
+	precise REAL r = a * a;
+	return r;
+}
+
+REAL f_twice(REAL a)
+{
+	return 2.0 * a;
+}
+
+REAL f_negate(REAL a)
+{
+	return -a;
+}
+
+REAL f_abs(REAL a)
+{
+	return abs(a);
+}
+
+// `a` negated where `s` is negative
+REAL f_times_sign(REAL a, REAL s)
+{
+	return s < 0.0 ? -a : a;
+}
+
+REAL2 formula(REAL2 z, REAL2 c)
+{
+	REAL x = z.x, y = z.y;
+	FORMULA_STEP(REAL, x, y, c.x, c.y)
+	return REAL2(x, y);
+}
+
+#ifdef PRECISION_DD
+dvec2 f_add(dvec2 a, dvec2 b)
+{
+	return dd_add(a, b);
+}
+
+dvec2 f_sub(dvec2 a, dvec2 b)
+{
+	return dd_sub(a, b);
+}
+
+dvec2 f_mul(dvec2 a, dvec2 b)
+{
+	return dd_mul(a, b);
+}
+
+dvec2 f_square(dvec2 a)
+{
+	return dd_mul(a, a);
+}
+
+// Doubling and negating both parts is exact
+dvec2 f_twice(dvec2 a)
+{
+	return a + a;
+}
+
+dvec2 f_negate(dvec2 a)
+{
+	return -a;
+}
+
+dvec2 f_abs(dvec2 a)
+{
+	return a.x < 0.0 ? -a : a;
+}
+
+void formula_dd(inout Orbit o, POINT c)
+{
+	dvec2 x = dvec2(o.z.x, o.z_lo.x), y = dvec2(o.z.y, o.z_lo.y);
+	FORMULA_STEP(dvec2, x, y, c.xz, c.yw)
+
+	o.z	   = dvec2(x.x, y.x);
+	o.z_lo = dvec2(x.y, y.y);
+}
+#endif
+
+#ifdef PRECISION_FIXED
+u64vec2 f_add(u64vec2 a, u64vec2 b)
+{
+	return fixed_add(a, b);
+}
+
+u64vec2 f_sub(u64vec2 a, u64vec2 b)
+{
+	return fixed_sub(a, b);
+}
+
+u64vec2 f_mul(u64vec2 a, u64vec2 b)
+{
+	return fixed_mul(a, b);
+}
+
+u64vec2 f_square(u64vec2 a)
+{
+	return fixed_square(a);
+}
+
+u64vec2 f_twice(u64vec2 a)
+{
+	return u64vec2(a.x << 1, (a.y << 1) | (a.x >> 63));
+}
+
+u64vec2 f_negate(u64vec2 a)
+{
+	return fixed_negate(a);
+}
+
+u64vec2 f_abs(u64vec2 a)
+{
+	return fixed_is_negative(a) ? fixed_negate(a) : a;
+}
+
+void formula_fixed(inout Orbit o, POINT c)
+{
+	// |z|^FORMULA_POWER < 4 keeps every intermediate within the 4 integer bits
+	if (!(dot(o.z, o.z) < FORMULA_FIXED_NORM2))
+	{
+		precise REAL2 z = formula(o.z, REAL2(fixed_to_double(c.xy), fixed_to_double(c.zw)));
+		o.z				= z;
+		return;
+	}
+
+	u64vec2 x = o.z_fixed.xy, y = o.z_fixed.zw;
+	FORMULA_STEP(u64vec2, x, y, c.xy, c.zw)
+
+	o.z_fixed = u64vec4(x, y);
+	o.z		  = REAL2(fixed_to_double(x), fixed_to_double(y));
+}
+#endif
+
+void orbit_step(inout Orbit o, POINT c)
+{
+#ifdef FEATURE_DERIVATIVE
+	REAL dx = o.dz.x, dy = o.dz.y;
+	FORMULA_DERIVATIVE(REAL, o.z.x, o.z.y, dx, dy)
+#ifdef FORMULA_JULIA
+	o.dz = REAL2(dx, dy);
+#else
+	o.dz = REAL2(f_add(dx, 1.0), dy);
+#endif
+#endif
+#ifdef PRECISION_DD
+	formula_dd(o, c);
+#elif defined(PRECISION_FIXED)
+	formula_fixed(o, c);
+#else
+	precise REAL2 z = formula(o.z, c);
+	o.z				= z;
+#endif
+	o.iter++;
+}
+
+REAL norm2(REAL2 z)
+{
+	precise REAL n = z.x * z.x + z.y * z.y;
+	return n;
+}
+
+// Advance the orbit by one step, returns true when the loop should stop
+bool advance(inout Orbit o, POINT c, int limit)
+{
+	if (o.iter >= limit) return true;
+
+	orbit_step(o, c);
+
+	return norm2(o.z) >= ESCAPE_RADIUS2;
+}
+
+#ifdef FEATURE_PERIODICITY
+// Brent step, returns true once the orbit is found periodic
+bool check_periodicity(inout Orbit o)
+{
+#ifdef PRECISION_DD
+	// The leading parts alone can't tell orbits apart closer than their rounding
+	REAL2 diff = REAL2(dd_sub(dvec2(o.z.x, o.z_lo.x), dvec2(o.snapshot.x, o.snapshot_lo.x)).x,
+					   dd_sub(dvec2(o.z.y, o.z_lo.y), dvec2(o.snapshot.y, o.snapshot_lo.y)).x);
+#elif defined(PRECISION_FIXED)
+	// Outside the escape circle `z_fixed` is no longer updated
+	if (!(norm2(o.z) < 4.0)) return false;
+	REAL2 diff = REAL2(fixed_to_double(fixed_sub(o.z_fixed.xy, o.snapshot_fixed.xy)),
+					   fixed_to_double(fixed_sub(o.z_fixed.zw, o.snapshot_fixed.zw)));
+#else
+	REAL2 diff = o.z - o.snapshot;
+#endif
+	if (dot(diff, diff) < PERIODICITY_EPSILON)
+	{
+		o.periodic = true;
+		return true;
+	}
+
+	if (o.iter >= o.next_snapshot)
+	{
+		o.snapshot = o.z;
+#ifdef PRECISION_DD
+		o.snapshot_lo = o.z_lo;
+#elif defined(PRECISION_FIXED)
+		o.snapshot_fixed = o.z_fixed;
+#endif
+		o.next_snapshot *= 2;
+	}
+
+	return false;
+}
+#endif
+
+bool orbit_escaped(Orbit o)
+{
+#ifdef FEATURE_PERIODICITY
+	if (o.periodic) return false;
+#endif
+	return norm2(o.z) >= ESCAPE_RADIUS2;
+}
+
+// Iterate until the orbit escapes, is proven periodic or reaches `limit` iterations.
+// Returns true once the orbit is finished, false if it only ran out of `limit`.
+bool iterate(inout Orbit o, POINT c, int limit)
+{
+#if BAILOUT_INTERVAL > 1
+	// Deferred bailout: run blocks of unchecked steps and test the block end only. An escaped
+	// orbit keeps growing until it overflows to inf/NaN, which the negated compare also catches,
+	// so a block that ends inside the radius never crossed it. On escape the block is rolled
+	// back and replayed by the checked loop below, which yields the exact iteration.
+	while (o.iter + BAILOUT_INTERVAL <= limit)
+	{
+		Orbit checkpoint = o;
+
+		for (int i = 0; i < BAILOUT_INTERVAL; i++) orbit_step(o, c);
+
+		// isnan() guards against drivers folding the negated compare into `>=`
+		if (!(norm2(o.z) < ESCAPE_RADIUS2) || any(isnan(o.z)))
+		{
+			o = checkpoint;
+			break;
+		}
+
+#ifdef FEATURE_PERIODICITY
+		if (check_periodicity(o)) return true;
+#endif
+	}
+#endif
+
+	for (;;)
+	{
+		if (advance(o, c, limit)) break;
+#if UNROLL >= 2
+		if (advance(o, c, limit)) break;
+#endif
+#if UNROLL >= 4
+		if (advance(o, c, limit)) break;
+		if (advance(o, c, limit)) break;
+#endif
+#if UNROLL >= 8
+		if (advance(o, c, limit)) break;
+		if (advance(o, c, limit)) break;
+		if (advance(o, c, limit)) break;
+		if (advance(o, c, limit)) break;
+#endif
+
+#ifdef FEATURE_PERIODICITY
+		if (check_periodicity(o)) return true;
+#endif
+	}
+
+	return o.iter >= max_iter || orbit_escaped(o);
+}
+
+// Kernel output of a finished orbit: (iteration value, distance estimate in pixels).
+// The iteration value is negative for points considered inside the set.
+vec2 orbit_output(Orbit o, float pixel_size)
+{
+	if (!orbit_escaped(o)) return vec2(-1.0, 0.0);
+
+#if defined(COLORING_ITERATION)
+	float value = float(o.iter - 1);
+#else
+	float value = float(o.iter) - log2(log(float(length(o.z)))) / log2(float(FORMULA_POWER));
+#endif
+
+#ifdef FEATURE_DERIVATIVE
+	float z_abs	   = float(length(o.z));
+	float estimate = z_abs * log(z_abs) / float(length(o.dz)) / pixel_size;
+#else
+	float estimate = 0.0;
+#endif
+
+	return vec2(value, estimate);
+}
+
+// Iterate the orbit of `point` to completion, see orbit_output()
+vec2 evaluate(POINT point, float pixel_size)
+{
+	Orbit o = orbit_start(point);
+	iterate(o, orbit_parameter(point), max_iter);
+	return orbit_output(o, pixel_size);
+}
+
+// Map the output of evaluate() to a color
+vec4 shade(vec2 data)
+{
+	if (data.x < 0.0) return vec4(0.0);
+
+#if defined(COLORING_ITERATION)
+	float t = float(int(data.x) % palette_cycle) / float(palette_cycle);
+#else
+	float t = mod(data.x, float(palette_cycle)) / float(palette_cycle);
+#endif
+
+	vec3 rgb = texture(palette, t).xyz;
+
+#ifdef COLORING_DISTANCE
+	rgb *= clamp(sqrt(data.y), 0.0, 1.0);
+#endif
+
+	return vec4(rgb, 1.0);
+}
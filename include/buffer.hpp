@@ -0,0 +1,56 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "common-include.hpp"
+
+class Buffer
+{
+  public:
+	Buffer(const Buffer&)			 = delete;
+	Buffer(Buffer&&)				 = default;
+	Buffer& operator=(const Buffer&) = delete;
+	Buffer& operator=(Buffer&&)		 = default;
+	Buffer();
+	~Buffer();
+
+	void bind(GLenum target) const { glBindBuffer(target, *ptr); }
+	void bind_base(GLenum target, GLuint index) const { glBindBufferBase(target, index, *ptr); }
+
+	// Reallocate the storage of the buffer
+	void stream_data(GLsizeiptr	 size,
+					 GLenum		 usage = GL_DYNAMIC_DRAW,
+					 const void* data  = nullptr) const;
+
+	// Overwrite a range of the existing storage
+	void update(GLintptr offset, GLsizeiptr size, const void* data) const;
+
+	// Allocate immutable storage of `size` bytes and map all of it persistently and coherently
+	// for `access`, GL_MAP_READ_BIT and/or GL_MAP_WRITE_BIT. The mapping stays valid for the
+	// life of the buffer and must not be accessed while the GPU works on it. Needs
+	// ARB_buffer_storage, returns nullptr on failure.
+	void* map_storage(GLsizeiptr size, GLbitfield access) const;
+
+	// Overwrite the head of the storage with a trivially copyable struct
+	template <typename T> void update(const T& value) const { update(0, sizeof(T), &value); }
+
+	GLuint operator*() const { return *ptr; }
+
+  private:
+	std::shared_ptr<GLuint> ptr;
+};
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+DESCRIPTION:
+CPU counterpart of kernel.glsl. Produces the same iteration map format, (iteration value,
+distance estimate in pixels) per pixel with a negative value for interior points, so that the
+result can be colorized by the GPU like the compute backends.
+*/
+
+#pragma once
+
+#include "common-include.hpp"
+#include "kernel.hpp"
+#include "reference-orbit.hpp"
+#include "render-params.hpp"
+
+#include <cstdint>
+
+// Rectangle of pixels inside a render region
+struct Cpu_tile
+{
+	int x, y, width, height;
+};
+
+// Occupancy of the SIMD lanes in the inner loop
+struct Lane_stats
+{
+	uint64_t active_lane_steps = 0;	 // Lane iterations spent on a pending pixel
+	uint64_t total_lane_steps  = 0;	 // Lane iterations issued, simd::width per loop step
+	uint64_t rebases		  = 0;	 // Perturbed pixels restarted at the start of the orbit
+
+	Lane_stats& operator+=(const Lane_stats& other)
+	{
+		active_lane_steps += other.active_lane_steps;
+		total_lane_steps += other.total_lane_steps;
+		rebases += other.rebases;
+		return *this;
+	}
+
+	[[nodiscard]] double utilisation() const
+	{
+		return total_lane_steps == 0 ? 1.0 : (double)active_lane_steps / total_lane_steps;
+	}
+};
+
+// Evaluate every pixel of `tile` into `output`, a row-major map of the whole
+// `region_width`x`region_height` region. Lanes are refilled with the next pending pixel of
+// the tile as soon as their orbit finishes, so no lane waits for the slowest one.
+// Pixels flagged in `skip`, one byte per pixel of the tile in row-major order, are left untouched.
+Lane_stats cpu_render_tile(const Render_params&	 params,
+						   const Kernel_variant& variant,
+						   const Cpu_tile&		 tile,
+						   glm::vec2*			 output,
+						   int					 region_width,
+						   int					 region_height,
+						   const uint8_t*		 skip = nullptr);
+
+// Caller-owned result arrays of a point evaluation, one element per point. Null arrays are
+// neither computed nor written.
+struct Point_results
+{
+	int32_t* iterations = nullptr;	// Iteration at which the orbit escaped, -1 if it never did
+	double*	 z_x		= nullptr;	// Last iterate, at escape for escaped orbits
+	double*	 z_y		= nullptr;
+	double*	 distance	= nullptr;	// Exterior distance estimate in units of the plane, 0 inside
+
+	// Results of the points from `first` onwards
+	[[nodiscard]] Point_results offset(size_t first) const
+	{
+		const auto shift = [first](auto* array)
+		{
+			return array != nullptr ? array + first : nullptr;
+		};
+
+		return {shift(iterations), shift(z_x), shift(z_y), shift(distance)};
+	}
+};
+
+// Evaluate `count` arbitrary points, given as separate arrays of real and imaginary parts, with
+// the same lane-refilling loop as cpu_render_tile(). The escape radius, periodicity checks and
+// bailout interval come from `variant`, derivatives are tracked whenever distances are requested.
+Lane_stats cpu_evaluate_points(const Kernel_variant& variant,
+							   int					 max_iter,
+							   const double*		 x,
+							   const double*		 y,
+							   size_t				 count,
+							   const Point_results&	 results);
+
+// Evaluate the pixels of `tile` like cpu_render_tile(), as offsets from the iterates of `orbit`
+// so that they are resolved far below the precision of double. `reference_offset` is the
+// center of the view minus that of the orbit. Offsets are rebased onto the start of the orbit
+// whenever the pixel comes closer to zero than to the reference, or the reference runs out.
+// Scalar, rebased pixels would leave the lanes reading different iterates. Periodicity checks
+// are skipped, the orbit of a pixel is only known to double precision relative to zero.
+Lane_stats cpu_render_tile_perturbed(const Render_params&	params,
+									 const Kernel_variant&	variant,
+									 const Reference_orbit& orbit,
+									 glm::dvec2				reference_offset,
+									 const Cpu_tile&		tile,
+									 glm::vec2*				output,
+									 int					region_width,
+									 int					region_height,
+									 const uint8_t*			skip = nullptr);
+
+// Outcome shared by every pixel of a tile, proven with interval arithmetic
+struct Tile_certificate
+{
+	enum Kind
+	{
+		Unknown,   // No proof, `iter` is the iteration at which the attempt gave up
+		Interior,  // No pixel ever escapes
+		Escaped	   // Every pixel escapes at iteration `iter`
+	} kind;
+
+	int iter = 0;
+};
+
+// Try to prove the outcome of every pixel of `tile` at once by iterating the rectangle of
+// c values they sample. Interior is proven when an iterate is contained in an earlier one
+// while all iterates stay inside the escape radius, since the sequence of rectangles can then
+// never leave their union. Escape proofs are only attempted when the output depends on the
+// iteration alone (iteration coloring without derivatives).
+Tile_certificate cpu_certify_tile(const Render_params&	params,
+								  const Kernel_variant& variant,
+								  const Cpu_tile&		tile,
+								  int					region_width,
+								  int					region_height);
+
+// Write the output of a certificate to every pixel of `tile`
+void cpu_fill_tile(const Tile_certificate& certificate,
+				   const Cpu_tile&		   tile,
+				   glm::vec2*			   output,
+				   int					   region_width);
+
+// Scalar reference of a single point, see evaluate() in kernel.glsl
+glm::vec2 cpu_evaluate(const Render_params&	 params,
+					   const Kernel_variant& variant,
+					   glm::dvec2			 c,
+					   float				 pixel_size);
+
+// Offset of the point sampled by the center of a pixel from the center of the view
+glm::dvec2 pixel_offset(const Render_params& params,
+						int					 x,
+						int					 y,
+						int					 region_width,
+						int					 region_height);
+
+// Point of the complex plane sampled by the center of a pixel, matches the compute backends
+glm::dvec2 pixel_to_complex(const Render_params& params,
+							int					 x,
+							int					 y,
+							int					 region_width,
+							int					 region_height);
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "common-include.hpp"
+#include "cpu-kernel.hpp"
+#include "nucleus.hpp"
+#include "reference-orbit-store.hpp"
+#include "symmetry.hpp"
+#include "thread-pool.hpp"
+
+#include <span>
+#include <stop_token>
+
+struct Cpu_render_stats
+{
+	Lane_stats lanes;
+	int		   tile_count	 = 0;
+	int		   mirrored_rows = 0;
+	float	   time_ms		 = 0;
+
+	// Pixels filled from interval certificates instead of being iterated
+	uint64_t pixel_count			   = 0;
+	uint64_t certified_interior_pixels = 0;
+	uint64_t certified_escaped_pixels  = 0;
+
+	// Tiles iterated with a limit below `max_iter`, picked from their border
+	int limited_tiles = 0;
+
+	// Reference orbit of a perturbed render, and the time spent finding and computing it for
+	// this one. `nucleus` is set if the orbit is that of a nucleus, `reference_distance` is the
+	// distance of its center from the view center in pixels.
+	std::optional<Reference_orbit_stats> reference;
+	std::optional<Nucleus>				 nucleus;
+	float								 reference_ms		= 0;
+	double								 reference_distance	= 0;
+
+	[[nodiscard]] double certified_fraction() const
+	{
+		return pixel_count == 0
+				 ? 0.0
+				 : (double)(certified_interior_pixels + certified_escaped_pixels) / pixel_count;
+	}
+};
+
+// Renders iteration maps on the CPU, splitting the region into tiles shared by a thread pool
+class Cpu_renderer
+{
+  public:
+	// `thread_count` of 0 uses one thread per hardware thread
+	Cpu_renderer(unsigned int thread_count = 0);
+
+	// Evaluate the view into `output`, resized to `width`x`height`, row 0 at the bottom like
+	// the iteration map of the GPU backends. `stop` is checked before every tile, returns
+	// false if the render was cancelled, leaving `output` partially written.
+	bool render(const Render_params&	 params,
+				const Kernel_variant&	 variant,
+				int						 width,
+				int						 height,
+				std::vector<glm::vec2>& output,
+				std::stop_token			 stop = {});
+
+	// Evaluate only the rows of `rows` into `output`, already sized to `width`x`height` by the
+	// caller, leaving all other rows untouched. Ignores `use_symmetry`.
+	bool render_rows(const Render_params&	  params,
+					 const Kernel_variant&	  variant,
+					 int					  width,
+					 int					  height,
+					 const Row_bands&		  rows,
+					 std::vector<glm::vec2>& output,
+					 std::stop_token		  stop = {});
+
+	// Evaluate every view of `views` into its own `width`x`height` map, stored one after another
+	// in `output`, which is resized to hold them. The tiles of all views share one run of the
+	// pool, so batches of small views keep every thread busy. Iterates in double, ignoring
+	// `perturbation` and `use_symmetry`.
+	bool render_batch(std::span<const Render_params> views,
+					  const Kernel_variant&			 variant,
+					  int							 width,
+					  int							 height,
+					  std::vector<glm::vec2>&		 output,
+					  std::stop_token				 stop = {});
+
+	// Evaluate `count` points with cpu_evaluate_points(), split into blocks of `point_block_size`
+	// shared by the pool, writing straight into the caller's arrays. `stop` is checked before
+	// every block, returns false if cancelled.
+	bool evaluate_points(const Kernel_variant& variant,
+						 int				   max_iter,
+						 const double*		   x,
+						 const double*		   y,
+						 size_t				   count,
+						 const Point_results&  results,
+						 std::stop_token	   stop = {});
+
+	[[nodiscard]] const Cpu_render_stats& get_stats() const { return stats; }
+	[[nodiscard]] unsigned int			  get_thread_count() const { return pool.get_worker_count(); }
+
+	static constexpr int	tile_size		 = 32;
+	static constexpr size_t point_block_size = 4096;
+
+	// Fill rows mirrored across the real axis by reflection instead of computing them
+	bool use_symmetry = true;
+
+	// Try to certify each tile with interval arithmetic before iterating its pixels, and
+	// retry on quadrants down to `min_certified_size` if the attempt failed within
+	// `max_split_iteration` iterations
+	bool				 certify_tiles		 = true;
+	static constexpr int min_certified_size	 = 8;
+	static constexpr int max_split_iteration = 16;
+
+	// Evaluate the border of each tile at the full `max_iter` first. If all of it escapes by
+	// iteration m, iterate the inside up to `border_limit_factor * m + border_limit_margin`
+	// first. Escaped pixels get the same value under any limit; the ones still inside are
+	// iterated again up to `max_iter`, so the image is the same as without tile limits.
+	bool				 adaptive_limits	 = true;
+	static constexpr int border_limit_factor = 4;
+	static constexpr int border_limit_margin = 64;
+
+	// Iterate pixels as offsets from a high-precision reference orbit instead of in double,
+	// for views finer than double resolves. The orbit is kept across renders and reused while
+	// its center stays inside the view and it is long and precise enough. Disables
+	// `certify_tiles`, the certificates bound c values in double. Ignored for formulas other
+	// than Kernel_formula::Mandelbrot, see Kernel_variant::supports_perturbation().
+	bool					  perturbation = false;
+	Reference_orbit::Settings reference_settings;
+
+	// Center new reference orbits at the nucleus of the lowest period in the view instead of at
+	// the view center, if Newton's method finds one inside the view. Its orbit never escapes,
+	// so pixels are only rebased once they leave it.
+	bool nucleus_reference = true;
+
+	// Takes new reference orbits from this store instead of computing them, if set
+	Reference_orbit_store* reference_store = nullptr;
+
+	[[nodiscard]] std::shared_ptr<const Reference_orbit> get_reference() const { return reference; }
+
+  private:
+	struct Worker_stats
+	{
+		Lane_stats lanes;
+		uint64_t   certified_interior_pixels = 0;
+		uint64_t   certified_escaped_pixels	 = 0;
+		int		   limited_tiles			 = 0;
+	};
+
+	Thread_pool				  pool;
+	std::vector<Cpu_tile>	  tiles;
+	std::vector<Worker_stats> worker_stats;
+	Cpu_render_stats		  stats;
+
+	std::shared_ptr<const Reference_orbit> reference;
+	glm::dvec2							   reference_offset;  // View center minus reference center
+	std::optional<Nucleus>				   nucleus;			  // Nucleus at the reference center
+
+	// Reset `stats` to the sum of `worker_stats` over `pixel_count` pixels in `tiles`
+	void gather_stats(uint64_t pixel_count);
+
+	// Reuse or recompute the reference for `params`, returns false if cancelled
+	bool prepare_reference(const Render_params&	 params,
+						   const Kernel_variant& variant,
+						   int					 width,
+						   std::stop_token		 stop);
+
+	// cpu_render_tile(), or its perturbed counterpart
+	Lane_stats evaluate_tile(const Render_params&  params,
+							 const Kernel_variant& variant,
+							 const Cpu_tile&	   tile,
+							 glm::vec2*			   output,
+							 int				   width,
+							 int				   height,
+							 const uint8_t*		   skip) const;
+
+	void render_tile(const Render_params&  params,
+					 const Kernel_variant& variant,
+					 const Cpu_tile&	   tile,
+					 glm::vec2*			   output,
+					 int				   width,
+					 int				   height,
+					 Worker_stats&		   worker);
+
+	// Certify `region` of `tile`, or its quadrants if that fails early, filling and flagging
+	// the proven pixels in `skip`
+	void certify_region(const Render_params&  params,
+						const Kernel_variant& variant,
+						const Cpu_tile&		  tile,
+						const Cpu_tile&		  region,
+						glm::vec2*			  output,
+						int					  width,
+						int					  height,
+						uint8_t*			  skip,
+						uint64_t&			  certified,
+						Worker_stats&		  worker);
+
+	// Evaluate the pixels of the border of `tile` not flagged in `skip` and flag them, returns
+	// the iteration limit the rest of the tile is tried with first
+	int probe_tile_limit(const Render_params&  params,
+						 const Kernel_variant& variant,
+						 const Cpu_tile&	   tile,
+						 glm::vec2*			   output,
+						 int				   width,
+						 int				   height,
+						 uint8_t*			   skip,
+						 Worker_stats&		   worker);
+};
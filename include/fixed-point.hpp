@@ -0,0 +1,117 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+DESCRIPTION:
+Fixed-point real numbers of selectable precision for reference orbits. A number is a two's
+complement integer of 64-bit limbs, least significant first, scaled so that the top limb is the
+signed integer part and every other limb holds 64 fraction bits.
+*/
+
+#pragma once
+
+#include "common-include.hpp"
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+class Fixed_real
+{
+  public:
+	static constexpr int max_limbs = 18;
+
+	// Zero with `limbs` limbs, one integer limb and `limbs - 1` fraction limbs
+	explicit Fixed_real(int limbs = 2);
+
+	// Nearest value to `value` with `limbs` limbs, exact unless `value` has bits below the
+	// last fraction limb
+	static Fixed_real from_double(double value, int limbs);
+
+	// Value of the first `limbs` words of `words`, as laid out by get_words()
+	static Fixed_real from_words(const uint64_t* words, int limbs);
+
+	// Limbs needed to resolve `spacing` with `guard_bits` to spare
+	static int limbs_for_spacing(double spacing, int guard_bits = 64);
+
+	[[nodiscard]] double to_double() const;
+	[[nodiscard]] int	 get_limbs() const { return limbs; }
+	[[nodiscard]] bool	 is_negative() const { return (int64_t)words[limbs - 1] < 0; }
+
+	// Limbs, least significant first
+	[[nodiscard]] const uint64_t* get_words() const { return words.data(); }
+
+	// Same value with `limbs` limbs, truncating or zero-extending the fraction
+	[[nodiscard]] Fixed_real with_limbs(int limbs) const;
+
+	// Operands have the same number of limbs. Results wrap around outside the integer part,
+	// which is never reached while orbits stay inside the escape radius.
+	friend Fixed_real operator+(const Fixed_real& a, const Fixed_real& b);
+	friend Fixed_real operator-(const Fixed_real& a, const Fixed_real& b);
+	friend Fixed_real operator*(const Fixed_real& a, const Fixed_real& b);
+	friend Fixed_real operator-(const Fixed_real& a);
+
+	// Exact multiplication by 2^bits, `bits` in [0, 64)
+	[[nodiscard]] Fixed_real shifted_left(int bits) const;
+
+	friend bool operator==(const Fixed_real& a, const Fixed_real& b) = default;
+
+  private:
+	std::array<uint64_t, max_limbs> words{};
+	int								limbs;
+};
+
+struct Fixed_complex
+{
+	Fixed_real x, y;
+
+	[[nodiscard]] glm::dvec2 to_double() const { return {x.to_double(), y.to_double()}; }
+
+	static Fixed_complex from_double(glm::dvec2 value, int limbs)
+	{
+		return {Fixed_real::from_double(value.x, limbs), Fixed_real::from_double(value.y, limbs)};
+	}
+
+	// Sum of a double-double (`leading`, `trailing`), like the center of Render_params
+	static Fixed_complex from_double_double(glm::dvec2 leading, glm::dvec2 trailing, int limbs)
+	{
+		const auto a = from_double(leading, limbs), b = from_double(trailing, limbs);
+		return {a.x + b.x, a.y + b.y};
+	}
+
+	// Double-double of the value, as (leading, trailing)
+	[[nodiscard]] std::pair<glm::dvec2, glm::dvec2> to_double_double() const
+	{
+		const auto leading = to_double();
+		const auto rest	   = Fixed_complex{x - Fixed_real::from_double(leading.x, x.get_limbs()),
+										   y - Fixed_real::from_double(leading.y, y.get_limbs())};
+		return {leading, rest.to_double()};
+	}
+
+	[[nodiscard]] Fixed_complex with_limbs(int limbs) const
+	{
+		return {x.with_limbs(limbs), y.with_limbs(limbs)};
+	}
+
+	// z^2 + c
+	[[nodiscard]] Fixed_complex step(const Fixed_complex& c) const
+	{
+		return {x * x - y * y + c.x, (x * y).shifted_left(1) + c.y};
+	}
+
+	friend bool operator==(const Fixed_complex& a, const Fixed_complex& b) = default;
+};
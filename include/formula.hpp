@@ -0,0 +1,289 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+DESCRIPTION:
+Iteration formulas of the Mandelbrot family as compile-time policies. The step of a formula is
+written once against an abstract number type and instantiated for every consumer: double for
+scalar code, simd::Pack for the CPU lane kernels, Interval for tile certification, and
+Glsl_value, which records the operations as the GLSL of the shader kernels.
+*/
+
+#pragma once
+
+#include "interval.hpp"
+#include "kernel.hpp"
+#include "shader.hpp"
+#include "simd.hpp"
+
+#include <cmath>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace formulas
+{
+// Statements recorded by Glsl_value, one temporary of the macro parameter type T each
+struct Glsl_recording
+{
+	std::string code;
+	int			temporaries = 0;
+};
+
+// Symbolic number whose operations are appended to a Glsl_recording. The statements call the
+// f_* functions of kernel.glsl, which are overloaded for the number type of every precision, so
+// that one recording serves all of them.
+class Glsl_value
+{
+  public:
+	// Variable `name`, a parameter of the generated macro
+	Glsl_value(Glsl_recording& recording, std::string name);
+
+	[[nodiscard]] const std::string& get_name() const { return name; }
+
+	friend Glsl_value operator+(const Glsl_value& a, const Glsl_value& b);
+	friend Glsl_value operator-(const Glsl_value& a, const Glsl_value& b);
+	friend Glsl_value operator*(const Glsl_value& a, const Glsl_value& b);
+	friend Glsl_value operator-(const Glsl_value& a);
+
+	friend Glsl_value square(const Glsl_value& a);
+	friend Glsl_value twice(const Glsl_value& a);
+	friend Glsl_value abs(const Glsl_value& a);
+	friend Glsl_value times_sign(const Glsl_value& a, const Glsl_value& s);
+	friend Glsl_value scaled(const Glsl_value& a, double k);
+
+  private:
+	Glsl_recording* recording;
+	std::string		name;
+
+	// New temporary holding `expression`
+	Glsl_value emit(const std::string& expression) const;
+};
+
+// Body of a function-like macro: the recorded statements, then the assignment of each result
+// to its macro parameter, e.g. {"x", value}
+std::string glsl_macro_body(const Glsl_recording&								 recording,
+							const std::vector<std::pair<std::string, Glsl_value>>& results);
+
+/* Operations of the steps on the concrete number types */
+
+using std::abs;
+
+inline double times_sign(double a, double s)
+{
+	return std::signbit(s) ? -a : a;
+}
+
+template <typename T>
+T square(const T& a)
+{
+	if constexpr (std::is_same_v<T, Interval>)
+		return sqr(a);
+	else
+		return a * a;
+}
+
+// 2a, exact. Steps double a factor rather than a product, which keeps the doubling off the
+// critical path of the iteration.
+template <typename T>
+T twice(const T& a)
+{
+	if constexpr (std::is_same_v<T, Interval>)
+		return 2.0 * a;
+	else
+		return a + a;
+}
+
+template <typename T>
+T scaled(const T& a, double k)
+{
+	return a * k;
+}
+
+inline simd::Pack scaled(simd::Pack a, double k)
+{
+	return a * simd::Pack::broadcast(k);
+}
+
+template <typename T>
+struct Complex
+{
+	T x, y;
+};
+
+// z^N, unrolled at compile time by binary powering
+template <int N, typename T>
+Complex<T> complex_power(const T& x, const T& y)
+{
+	static_assert(N >= 1);
+
+	if constexpr (N == 1)
+		return {x, y};
+	else if constexpr (N % 2 == 0)
+	{
+		const auto h = complex_power<N / 2>(x, y);
+		return {square(h.x) - square(h.y), twice(h.x) * h.y};
+	}
+	else
+	{
+		const auto h = complex_power<N - 1>(x, y);
+		return {h.x * x - h.y * y, h.x * y + h.y * x};
+	}
+}
+
+/* Formulas
+ *
+ * `step(x, y, c_x, c_y)` advances z = (x, y) by one iteration with parameter c.
+ * `derivative(x, y, dx, dy)` advances the derivative dz by the derivative of the step at z,
+ * callers add the derivative of the parameter term. `power` is the degree of the step, which
+ * sets the growth of escaping orbits.
+ */
+
+// z' = z^N + c
+template <int N>
+struct Multibrot
+{
+	static constexpr int power = N;
+
+	template <typename T>
+	static void step(T& x, T& y, const T& c_x, const T& c_y)
+	{
+		const auto p = complex_power<N>(x, y);
+		x			 = p.x + c_x;
+		y			 = p.y + c_y;
+	}
+
+	// dz' = N z^(N-1) dz
+	template <typename T>
+	static void derivative(const T& x, const T& y, T& dx, T& dy)
+	{
+		const auto p	  = complex_power<N - 1>(x, y);
+		const T	   new_dx = scaled(p.x * dx - p.y * dy, N);
+		dy				  = scaled(p.x * dy + p.y * dx, N);
+		dx				  = new_dx;
+	}
+};
+
+using Mandelbrot = Multibrot<2>;
+
+// z' = conj(z)^2 + c
+struct Tricorn
+{
+	static constexpr int power = 2;
+
+	template <typename T>
+	static void step(T& x, T& y, const T& c_x, const T& c_y)
+	{
+		const T new_x = square(x) - square(y) + c_x;
+		y			  = c_y - twice(x) * y;
+		x			  = new_x;
+	}
+
+	// Antiholomorphic, dz' = 2 conj(z dz)
+	template <typename T>
+	static void derivative(const T& x, const T& y, T& dx, T& dy)
+	{
+		const T new_dx = twice(x * dx - y * dy);
+		dy			   = -twice(x * dy + y * dx);
+		dx			   = new_dx;
+	}
+};
+
+// z' = (|Re z| + i |Im z|)^2 + c
+struct Burning_ship
+{
+	static constexpr int power = 2;
+
+	template <typename T>
+	static void step(T& x, T& y, const T& c_x, const T& c_y)
+	{
+		const T new_x = square(x) - square(y) + c_x;
+		y			  = abs(twice(x) * y) + c_y;
+		x			  = new_x;
+	}
+
+	// The fold is not complex differentiable, this is the derivative along dz:
+	// d(2 |xy|) = 2 sign(xy) (x dy + y dx)
+	template <typename T>
+	static void derivative(const T& x, const T& y, T& dx, T& dy)
+	{
+		const T new_dx = twice(x * dx - y * dy);
+		dy			   = twice(times_sign(x * dy + y * dx, x * y));
+		dx			   = new_dx;
+	}
+};
+
+// Call `function.template operator()<Formula>()` with the policy of `formula`. Julia sets
+// iterate the Mandelbrot step from a different starting point.
+template <typename Function>
+decltype(auto) dispatch(Kernel_formula formula, Function&& function)
+{
+	switch (formula)
+	{
+	case Kernel_formula::Burning_ship:
+		return function.template operator()<Burning_ship>();
+	case Kernel_formula::Tricorn:
+		return function.template operator()<Tricorn>();
+	case Kernel_formula::Multibrot3:
+		return function.template operator()<Multibrot<3>>();
+	case Kernel_formula::Multibrot4:
+		return function.template operator()<Multibrot<4>>();
+	case Kernel_formula::Multibrot5:
+		return function.template operator()<Multibrot<5>>();
+	case Kernel_formula::Multibrot6:
+		return function.template operator()<Multibrot<6>>();
+	case Kernel_formula::Multibrot7:
+		return function.template operator()<Multibrot<7>>();
+	case Kernel_formula::Multibrot8:
+		return function.template operator()<Multibrot<8>>();
+	default:
+		return function.template operator()<Mandelbrot>();
+	}
+}
+
+// Shader switches of `Formula`, see kernel.glsl: FORMULA_POWER, FORMULA_FIXED_NORM2 and the
+// macros FORMULA_STEP(T, x, y, c_x, c_y) and FORMULA_DERIVATIVE(T, x, y, dx, dy)
+template <typename Formula>
+const Shader_variant_cache::Defines& glsl_defines()
+{
+	static const Shader_variant_cache::Defines defines = []
+	{
+		Glsl_recording step, derivative;
+
+		Glsl_value x(step, "x"), y(step, "y");
+		Formula::step(x, y, Glsl_value(step, "c_x"), Glsl_value(step, "c_y"));
+
+		Glsl_value dx(derivative, "dx"), dy(derivative, "dy");
+		Formula::derivative(Glsl_value(derivative, "x"), Glsl_value(derivative, "y"), dx, dy);
+
+		// The fixed-point step keeps |z|^power < 4, so that every intermediate stays inside
+		// the 4 integer bits
+		const double fixed_norm2 = std::pow(4.0, 2.0 / Formula::power);
+
+		return Shader_variant_cache::Defines{
+			{"FORMULA_POWER", std::to_string(Formula::power)},
+			{"FORMULA_FIXED_NORM2", std::format("{:.17e}", fixed_norm2)},
+			{"FORMULA_STEP(T, x, y, c_x, c_y)", glsl_macro_body(step, {{"x", x}, {"y", y}})},
+			{"FORMULA_DERIVATIVE(T, x, y, dx, dy)",
+			 glsl_macro_body(derivative, {{"dx", dx}, {"dy", dy}})},
+		};
+	}();
+
+	return defines;
+}
+}
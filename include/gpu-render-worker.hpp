@@ -0,0 +1,175 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "common-include.hpp"
+#include "cpu-renderer.hpp"
+#include "gpu-renderer.hpp"
+#include "hybrid-scheduler.hpp"
+#include "iteration-controller.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+struct Gpu_render_request
+{
+	Render_params  params;
+	Kernel_variant variant;
+	Gpu_backend	   backend = Gpu_backend::Fragment;
+
+	// Rendered region, and the size of the render targets holding it
+	int width = 0, height = 0;
+	int target_width = 0, target_height = 0;
+
+	// Frame of an ongoing interaction, rendered at reduced scale
+	bool  interactive = false;
+	float scale		  = 1.0f;
+
+	// Gpu_renderer settings, applied by the worker
+	bool use_symmetry	   = true;
+	int	 persistent_groups = 256;
+	int	 batch_iterations  = 64;
+
+	// Split the rows between the fragment kernel and the CPU engine instead of using `backend`
+	bool hybrid			 = false;
+	bool certify_tiles	 = true;
+	bool adaptive_limits = true;
+
+	// Probe with this copy of the controller and render at the limit it picks, the request of
+	// the result holds both
+	std::optional<Iteration_controller> iteration_controller;
+};
+
+struct Gpu_render_result
+{
+	Gpu_render_request	  request;
+	float				  time_ms = 0;
+	std::vector<uint32_t> compaction_history;
+
+	std::optional<Hybrid_frame_stats> hybrid;
+
+	// Iteration map of a settled frame, see Gpu_renderer::copy_map()
+	std::optional<Buffer> map;
+};
+
+// Runs the GPU backends on a worker thread with its own GL context, sharing objects with the UI
+// context. Frames are rendered into the back one of two textures while the UI keeps sampling the
+// front one. The UI swaps them once the fence placed after a frame has signalled, and fences
+// the swap in turn, so neither side ever waits for the other on the CPU.
+class Gpu_render_worker
+{
+  public:
+	// Create the worker context next to `share`, on the thread that owns the windows.
+	// `palette` belongs to the UI context and must not change while frames are in flight.
+	// Throws if the context can't be created.
+	Gpu_render_worker(GLFWwindow* share, const Texture1d& palette);
+	~Gpu_render_worker();
+
+	Gpu_render_worker(const Gpu_render_worker&) = delete;
+	Gpu_render_worker(Gpu_render_worker&&)		= delete;
+
+	// Render `request` next, replacing a request that has not started yet
+	void submit(const Gpu_render_request& request);
+
+	// Swap the front and back textures if a frame has finished, never blocks.
+	// Must be called on the UI context.
+	std::optional<Gpu_render_result> poll();
+
+	// A request is queued, being rendered, or waiting to be swapped in
+	[[nodiscard]] bool busy() const;
+
+	// Texture holding the last swapped-in frame, 0 before the first one
+	[[nodiscard]] GLuint get_front() const { return front; }
+
+	// Run task(renderer, stop) on the worker context while no frame can start, for other GPU
+	// work that shouldn't block the UI. The task must leave the textures of the frames alone,
+	// `stop` is requested when the worker shuts down.
+	template <typename F> auto submit_task(F task)
+	{
+		using Result   = std::invoke_result_t<F&, Gpu_renderer&, std::stop_token>;
+		using Packaged = std::packaged_task<Result(Gpu_renderer&, std::stop_token)>;
+
+		// Shared, std::function needs a copyable target
+		auto packaged = std::make_shared<Packaged>(std::move(task));
+		auto future	  = packaged->get_future();
+
+		std::lock_guard lock(mutex);
+		tasks.emplace_back([packaged](Gpu_renderer& renderer, std::stop_token stop)
+						   { (*packaged)(renderer, stop); });
+		wakeup.notify_one();
+
+		return future;
+	}
+
+  private:
+	using Task = std::function<void(Gpu_renderer&, std::stop_token)>;
+
+	struct Frame
+	{
+		GLsync			  fence;
+		GLuint			  texture;
+		Gpu_render_result result;
+	};
+
+	GLFWwindow*		 context;
+	const Texture1d& palette;
+
+	mutable std::mutex			mutex;
+	std::condition_variable_any wakeup;
+
+	std::optional<Gpu_render_request> pending;
+	std::optional<Frame>			  ready;  // Rendered into the back texture, not swapped in yet
+	std::deque<Task>				  tasks;
+	std::stop_source				  job;	// Cancels the iteration probe of the request in progress
+	GLsync released = nullptr;	// Signals when the UI no longer samples the back texture
+	bool   rendering = false;
+
+	GLuint front = 0;
+
+	// Split and times of the last hybrid frame, reported to the scheduler with the row costs
+	// of its iteration map
+	struct Hybrid_report
+	{
+		int		  width, max_iter;
+		Row_bands gpu_rows;
+		float	  gpu_ms;
+		Row_bands cpu_rows;
+		float	  cpu_ms;
+	};
+
+	// Hybrid rendering state, worker thread only. The CPU renderer is created on first use.
+	std::unique_ptr<Cpu_renderer> hybrid_cpu;
+	Hybrid_scheduler			  hybrid_scheduler;
+	std::vector<glm::vec2>		  hybrid_map;  // CPU rows of the current frame
+	std::optional<Hybrid_report>  hybrid_report;
+
+	std::jthread thread;  // Last member, started once everything else is constructed
+
+	void run(std::stop_token stop);
+
+	// Render `result.request` with the GPU and the CPU in parallel, the GPU part runs on
+	// `renderer` while this thread computes the CPU part
+	void render_hybrid(Gpu_renderer&	 renderer,
+					   Query_timer&		 timer,
+					   const Texture2d&	 target,
+					   Gpu_render_result& result);
+};
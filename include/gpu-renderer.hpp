@@ -0,0 +1,257 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "buffer.hpp"
+#include "common-include.hpp"
+#include "framebuffer.hpp"
+#include "kernel.hpp"
+#include "program-cache.hpp"
+#include "quad.hpp"
+#include "render-params.hpp"
+#include "shader.hpp"
+#include "symmetry.hpp"
+#include "texture.hpp"
+#include "timer.hpp"
+
+#include <span>
+
+enum class Gpu_backend
+{
+	Fragment,  // Full-screen fragment pass, colors written directly
+	Compute,   // Persistent work groups pulling tiles from an atomic counter
+	Compaction	// Iteration batches over a compacted list of still-active pixels
+};
+
+const char* get_backend_name(Gpu_backend backend);
+
+// Result buffers of Gpu_renderer::evaluate_points(), each holding one element per point from
+// offset 0 in the types of Point_results. Null buffers are neither computed nor written.
+struct Gpu_point_results
+{
+	const Buffer* iterations = nullptr;
+	const Buffer* z_x		 = nullptr;
+	const Buffer* z_y		 = nullptr;
+	const Buffer* distance	 = nullptr;
+};
+
+// Runs the GPU kernels and owns their programs and intermediate buffers
+class Gpu_renderer
+{
+  public:
+	Gpu_renderer(Program_cache& program_cache);
+
+	// Compile all programs of `variant` ahead of time and validate their interfaces, throws on failure
+	void prepare(const Kernel_variant& variant);
+
+	// Whether the current context can run kernels of `precision`
+	static bool supports(Kernel_precision precision);
+
+	// Render the view described by `params` into the top-left `width`x`height` region of `target`
+	void render(const Render_params&  params,
+				const Kernel_variant& variant,
+				Gpu_backend			  backend,
+				const Texture2d&	  target,
+				const Texture1d&	  palette,
+				int					  width,
+				int					  height);
+
+	// Colorize an iteration map computed elsewhere, `map` holds `width`x`height` pixels in the
+	// format of orbit_output() in kernel.glsl
+	void present(const Render_params&  params,
+				 const Kernel_variant& variant,
+				 const glm::vec2*	   map,
+				 const Texture2d&	   target,
+				 const Texture1d&	   palette,
+				 int				   width,
+				 int				   height);
+
+	// Hybrid rendering assembles the iteration map from several sources before colorizing it.
+	// Evaluate the rows of `rows` of the `width`x`height` view into the iteration map with the
+	// fragment kernel, other rows are left untouched.
+	void render_map_rows(const Render_params&  params,
+						 const Kernel_variant& variant,
+						 int				   width,
+						 int				   height,
+						 const Row_bands&	   rows);
+
+	// Copy the rows of `rows` of `map`, a `width`x`height` map computed elsewhere, into the
+	// iteration map
+	void upload_map_rows(const glm::vec2* map, int width, int height, const Row_bands& rows);
+
+	// Fill the mirrored rows of the iteration map from their partner rows
+	void mirror_map_rows(const Row_symmetry& symmetry, int width, int height);
+
+	// Copy the `width`x`height` region of the iteration map into a new buffer without waiting for
+	// the GPU. Any context sharing objects with this one can read it with read_map_buffer() once
+	// a fence placed after the copy has signalled.
+	[[nodiscard]] Buffer copy_map(int width, int height);
+
+	// Read a `width`x`height` map copied by copy_map()
+	static std::vector<glm::vec2> read_map_buffer(const Buffer& buffer, int width, int height);
+
+	// Sum every row of the `width`x`height` region of the iteration map on the GPU into the
+	// iteration values plus one of its escaped pixels and the number of its interior pixels
+	void measure_row_costs(int width, int height);
+
+	// Sums of the last measure_row_costs(), one per row. Waits for them, read them once a fence
+	// placed after the measurement has signalled.
+	[[nodiscard]] std::vector<glm::vec2> read_row_costs() const;
+
+	// Colorize the `width`x`height` region of the iteration map into `target`
+	void colorize_map(const Render_params&	params,
+					  const Kernel_variant& variant,
+					  const Texture2d&		target,
+					  const Texture1d&		palette,
+					  int					width,
+					  int					height);
+
+	// Largest number of views of one batch, the layer limit of array textures
+	static int get_max_batch_size();
+
+	// Render every view of `views` into the top-left `width`x`height` region of the layer of
+	// `target` with the same index, all in a single compute dispatch. `target` is an RGBA8 array
+	// of at least `views.size()` layers, at most get_max_batch_size().
+	void render_batch(std::span<const Render_params> views,
+					  const Kernel_variant&			 variant,
+					  const Texture2d_array&		 target,
+					  const Texture1d&				 palette,
+					  int							 width,
+					  int							 height);
+
+	// Colorize the iteration maps of a batch computed elsewhere into `target` like
+	// render_batch(), `maps` holds the `width`x`height` map of every view one after another
+	void present_batch(std::span<const Render_params> views,
+					   const Kernel_variant&		  variant,
+					   const glm::vec2*				  maps,
+					   const Texture2d_array&		  target,
+					   const Texture1d&				  palette,
+					   int							  width,
+					   int							  height);
+
+	// Evaluate `count` points like cpu_evaluate_points(), reading their real and imaginary parts
+	// as doubles from `x` and `y`. All buffers belong to the caller and are bound in place, so
+	// points produced or results consumed by other GPU work never pass through host memory.
+	// Returns without waiting for the GPU.
+	void evaluate_points(const Kernel_variant&	  variant,
+						 int					  max_iter,
+						 const Buffer&			  x,
+						 const Buffer&			  y,
+						 size_t					  count,
+						 const Gpu_point_results& results);
+
+	// Average GPU time in milliseconds of rendering the view `runs` times with `backend`
+	float benchmark(const Render_params&  params,
+					const Kernel_variant& variant,
+					Gpu_backend			  backend,
+					const Texture2d&	  target,
+					const Texture1d&	  palette,
+					int					  width,
+					int					  height,
+					int					  runs);
+
+	// Number of persistent work groups launched by the compute backend
+	int persistent_groups = 256;
+
+	// Fragment backend: compute the rows on one side of the real axis only and fill their
+	// mirror images with a flipped blit
+	bool use_symmetry = true;
+
+	// Fragment backend: evaluate into the iteration map and colorize it in a second pass like the
+	// other backends, so that copy_map() finds the map of the frame
+	bool keep_map = false;
+
+	// Minimum iterations per batch of the compaction backend, raised for large `max_iter` so
+	// that no render takes more than `max_compaction_batches` batches
+	int					 batch_iterations		= 64;
+	static constexpr int max_compaction_batches = 64;
+
+	// Active pixels at the start of each batch of the last compaction render. Waits for that
+	// render to finish, read it once its fence has signalled.
+	[[nodiscard]] std::vector<uint32_t> read_compaction_history() const;
+
+  private:
+	Shader_variant_cache fragment_variants, compute_variants, colorize_variants, compaction_variants,
+		batch_variants, point_variants, row_cost_variants;
+
+	Framebuffer framebuffer;
+	Quad_mesh	quad;
+	Buffer		params_buffer, tile_counter, row_costs;
+	Query_timer timer;
+
+	Texture2d iteration_map;
+	int		  iteration_map_width = 0, iteration_map_height = 0;
+	int		  row_cost_capacity = 0, measured_rows = 0;
+
+	struct
+	{
+		Buffer control, states, flags, offsets, block_sums;
+		Buffer lists[2];
+		Buffer history;	 // Copy of the history in `control`, read back on request
+
+		size_t pixel_capacity = 0, state_stride = 0;
+		int	   history_length = 0;
+	} compaction;
+
+	// View list of batch.comp, and the iteration maps of batches colorized by present_batch()
+	Buffer			batch_views;
+	Texture2d_array batch_map;
+	int				batch_map_width = 0, batch_map_height = 0, batch_map_layers = 0;
+
+	std::optional<Shader> get_program(Shader_variant_cache& cache, const Kernel_variant& variant);
+
+	// Make sure the iteration map can hold `width`x`height` pixels
+	void reserve_iteration_map(int width, int height);
+
+	// Rows of the view mirrored by the fragment backend, if `use_symmetry` applies to it
+	std::optional<Row_symmetry> find_symmetry(const Render_params&	params,
+											  const Kernel_variant& variant,
+											  int					height) const;
+
+	void render_fragment(const Render_params&  params,
+						 const Kernel_variant& variant,
+						 int				   width,
+						 int				   height);
+
+	// Draw the full-screen quad clipped to `rows` of the bound framebuffer
+	void draw_rows(const Row_bands& rows, int width);
+
+	// Copy the partner rows of `symmetry` onto the mirrored rows of the bound framebuffer
+	void mirror_rows(const Row_symmetry& symmetry, int width);
+	void render_compute(const Kernel_variant& variant, int width, int height);
+	void render_compaction(const Render_params& params,
+						   const Kernel_variant& variant,
+						   int					 width,
+						   int					 height);
+
+	// Make sure the compaction buffers can hold `pixel_count` pixels of `variant`
+	void reserve_compaction(const Kernel_variant& variant, size_t pixel_count);
+
+	// Map the iteration map to colors into the bound framebuffer
+	void colorize(const Kernel_variant& variant, int width, int height);
+
+	// Run batch.comp over `views` into `target`, reading the iteration maps from `batch_map`
+	// with `from_map`
+	void dispatch_batch(std::span<const Render_params> views,
+						const Kernel_variant&		   variant,
+						bool						   from_map,
+						const Texture2d_array&		   target,
+						const Texture1d&			   palette,
+						int							   width,
+						int							   height);
+};
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "common-include.hpp"
+#include "symmetry.hpp"
+
+// Split of one hybrid frame, reported with its result
+struct Hybrid_frame_stats
+{
+	int	  split_row = 0;  // Rows below go to the GPU, the others to the CPU
+	int	  height	= 0;
+	float gpu_share = 0;  // Fraction of the predicted cost assigned to the GPU
+	float gpu_ms = 0, cpu_ms = 0;
+};
+
+// Splits the rows of a frame between the GPU kernel and the CPU engine so that both finish at
+// about the same time. The cost of each row is predicted from the iteration map of the previous
+// frame, the throughput of each backend is learned from the times measured so far.
+class Hybrid_scheduler
+{
+  public:
+	// Predicted cost in iterations of each row of a `width`x`height` frame, rows outside `rows`
+	// cost nothing. Uniform before the first report.
+	[[nodiscard]] std::vector<double> predict_row_costs(int				 width,
+														int				 height,
+														int				 max_iter,
+														const Row_bands& rows) const;
+
+	// First row of the CPU part, so that both parts of `row_costs` are predicted to take
+	// equally long
+	[[nodiscard]] int split(const std::vector<double>& row_costs) const;
+
+	// Feed back a finished frame: the row costs of its iteration map as summed by
+	// Gpu_renderer::measure_row_costs(), and the rows each backend computed in the measured time
+	void report(const std::vector<glm::vec2>& row_costs,
+				int							  width,
+				int							  max_iter,
+				const Row_bands&			  gpu_rows,
+				float						  gpu_ms,
+				const Row_bands&			  cpu_rows,
+				float						  cpu_ms);
+
+	// Iterations per millisecond, 0 before the first measurement
+	[[nodiscard]] double get_gpu_throughput() const { return gpu_throughput; }
+	[[nodiscard]] double get_cpu_throughput() const { return cpu_throughput; }
+
+  private:
+	// Weight of the newest frame in the throughput estimates
+	static constexpr double smoothing = 0.5;
+
+	// Per-pixel averages of one row of the previous frame. Interior pixels are kept apart, they
+	// cost `max_iter` whatever it is in the next frame.
+	struct Row_profile
+	{
+		double escaped_iterations = 0;
+		double interior_fraction  = 0;
+	};
+
+	std::vector<Row_profile> profile;
+
+	double gpu_throughput = 0, cpu_throughput = 0;
+
+	// Iterations spent on the rows of `rows`
+	static double measure_cost(const std::vector<glm::vec2>& row_costs,
+							   int							 max_iter,
+							   const Row_bands&				 rows);
+};
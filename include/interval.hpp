@@ -0,0 +1,106 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+DESCRIPTION:
+Closed interval arithmetic on doubles with outward rounding: every result is widened by at
+least one ulp on each side, so it encloses the exact result of the operation on any members
+of the operands.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+struct Interval
+{
+	double lo, hi;
+
+	static Interval point(double x) { return {x, x}; }
+
+	// Smallest interval containing both `a` and `b`
+	static Interval hull(double a, double b) { return {std::min(a, b), std::max(a, b)}; }
+
+	[[nodiscard]] bool contains(const Interval& other) const
+	{
+		return lo <= other.lo && other.hi <= hi;
+	}
+
+	friend Interval operator+(const Interval& a, const Interval& b)
+	{
+		return widen(a.lo + b.lo, a.hi + b.hi);
+	}
+
+	friend Interval operator-(const Interval& a, const Interval& b)
+	{
+		return widen(a.lo - b.hi, a.hi - b.lo);
+	}
+
+	friend Interval operator*(const Interval& a, const Interval& b)
+	{
+		const double p[] = {a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi};
+		return widen(*std::min_element(p, p + 4), *std::max_element(p, p + 4));
+	}
+
+	// Multiplication by a power of two is exact
+	friend Interval operator*(double scale, const Interval& a)
+	{
+		return hull(scale * a.lo, scale * a.hi);
+	}
+
+	// Tighter than a * a, the square is never negative
+	friend Interval sqr(const Interval& a)
+	{
+		if (a.lo >= 0) return widen(a.lo * a.lo, a.hi * a.hi);
+		if (a.hi <= 0) return widen(a.hi * a.hi, a.lo * a.lo);
+		return widen(0.0, std::max(a.lo * a.lo, a.hi * a.hi));
+	}
+
+	// Exact, negation never rounds
+	friend Interval abs(const Interval& a)
+	{
+		if (a.lo >= 0) return a;
+		if (a.hi <= 0) return {-a.hi, -a.lo};
+		return {0.0, std::max(-a.lo, a.hi)};
+	}
+
+  private:
+	// A round-to-nearest result is within half an ulp of the exact one and an ulp is at most
+	// |x| * 2^-52, so moving by that much (plus the smallest denormal) is outward rounding
+	// without switching the FPU rounding mode
+	static Interval widen(double lo, double hi)
+	{
+		constexpr double epsilon = 0x1p-52, tiny = std::numeric_limits<double>::denorm_min();
+		return {lo - (std::abs(lo) * epsilon + tiny), hi + (std::abs(hi) * epsilon + tiny)};
+	}
+};
+
+// Rectangle of the complex plane
+struct Complex_interval
+{
+	Interval x, y;
+
+	[[nodiscard]] bool contains(const Complex_interval& other) const
+	{
+		return x.contains(other.x) && y.contains(other.y);
+	}
+
+	// Enclosure of |z|^2 over the rectangle
+	[[nodiscard]] Interval norm2() const { return sqr(x) + sqr(y); }
+};
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "common-include.hpp"
+#include "kernel.hpp"
+#include "render-params.hpp"
+
+#include <stop_token>
+
+// Picks `max_iter` from the escape statistics of a low-resolution probe of the view. Pixels
+// that reach the limit but escape within the longer limit of the probe lie on the boundary and
+// would be rendered as interior; the limit is set so that they make up `target_fraction` of the
+// view. Deep interior pixels never escape and don't count, so the limit doesn't grow without
+// bound over the body of the set.
+class Iteration_controller
+{
+  public:
+	float target_fraction = 0.002f;
+	int	  min_iter		  = 64;
+	int	  max_iter_limit  = 1 << 20;
+
+	// Probe the view of `params`, whose `max_iter` is ignored, and pick the limit for it. Takes
+	// up to `max_probes` renders of up to `max_iter_limit` iterations, so the render threads
+	// probe with a copy of the controller. Keeps the current limit once `stop` is requested.
+	int update(const Render_params&  params,
+			   const Kernel_variant& variant,
+			   std::stop_token		 stop = {});
+
+	// Take the limit picked by `probed`, a copy that has probed on a render thread
+	void take_result(const Iteration_controller& probed)
+	{
+		max_iter			= probed.max_iter;
+		unresolved_fraction = probed.unresolved_fraction;
+	}
+
+	[[nodiscard]] int get_max_iter() const { return max_iter; }
+
+	// Continue from a known limit, e.g. that of a restored view
+	void set_max_iter(int value) { max_iter = std::clamp(value, min_iter, max_iter_limit); }
+
+	// Fraction of the probe that escaped later than the picked limit
+	[[nodiscard]] float get_unresolved_fraction() const { return unresolved_fraction; }
+
+	// Probe resolution along x, y follows the aspect ratio of the view
+	static constexpr int probe_width = 64;
+
+	// Probes per update, each one looks twice as far as the limit it checks
+	static constexpr int max_probes = 4;
+
+  private:
+	int	  max_iter			  = 256;
+	float unresolved_fraction = 0;
+
+	std::vector<glm::vec2> probe;
+	std::vector<float>	   escapes;
+};
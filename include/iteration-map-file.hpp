@@ -0,0 +1,64 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+DESCRIPTION:
+Iteration map container (.mbim), saves a render together with everything needed to colorize it
+again. Layout, little-endian:
+
+	File_header		magic "MBIM", version, region and tile size, render parameters, kernel variant
+	Tile_entry[n]	offset and length of each tile payload, tiles in row-major order
+	payloads
+
+A tile payload holds the two channels of the tile one after the other, pixels in row-major order
+within the tile. A channel is the stream of differences between the bit patterns of consecutive
+values, zigzag-encoded as varints, where a zero difference is followed by the length of the run of
+zeros it starts. Iteration values repeat in long runs and change in small steps, interior pixels
+and an absent distance estimate collapse into single runs.
+*/
+
+#pragma once
+
+#include "common-include.hpp"
+#include "kernel.hpp"
+#include "render-params.hpp"
+#include "thread-pool.hpp"
+#include "util.hpp"
+
+#include <filesystem>
+
+// Iteration map of a `width`x`height` region, in the format of orbit_output() in kernel.glsl
+struct Iteration_map_image
+{
+	Render_params		   params;
+	Kernel_variant		   variant;
+	int					   width = 0, height = 0;
+	std::vector<glm::vec2> map;
+};
+
+// Tiles are encoded and decoded independently, in parallel
+constexpr int iteration_map_tile_size = 64;
+
+// Encode `image` on `pool` and write it to `path` through a temporary file, returns the size of
+// the file
+Result<size_t, std::string> save_iteration_map(const std::filesystem::path& path,
+											   const Iteration_map_image&	image,
+											   Thread_pool&					pool);
+
+// Memory-map `path` and decode its tiles on `pool`
+Result<Iteration_map_image, std::string> load_iteration_map(const std::filesystem::path& path,
+															Thread_pool&				 pool);
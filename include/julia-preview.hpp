@@ -0,0 +1,83 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+DESCRIPTION:
+Inset view of the Julia set of the point under the cursor, for exploring the parameter plane.
+It renders on the calling context into a target of its own, bypassing the render queue of the
+main view. While the cursor moves every frame is rendered at reduced resolution with the
+cheapest kernel; once the cursor rests the view is rendered again at full resolution in FP64.
+*/
+
+#pragma once
+
+#include "common-include.hpp"
+#include "gpu-renderer.hpp"
+#include "texture.hpp"
+
+#include <chrono>
+
+class Julia_preview
+{
+  public:
+	Julia_preview();
+
+	// Follow the cursor to `c`, rendering a frame if the preview changed or is due for
+	// refinement. `variant` supplies the coloring and kernel options.
+	void update(Gpu_renderer&		  renderer,
+				const Kernel_variant& variant,
+				const Texture1d&	  palette,
+				int					  palette_cycle,
+				glm::dvec2			  c);
+
+	// Texture holding the preview in its top-left `get_uv_extent()`, 0 before the first frame
+	[[nodiscard]] GLuint	get_texture() const { return region == 0 ? 0 : *target; }
+	[[nodiscard]] glm::vec2 get_uv_extent() const { return glm::vec2((float)region / size); }
+
+	[[nodiscard]] glm::dvec2 get_c() const { return c; }
+	[[nodiscard]] int		 get_resolution() const { return region; }
+	[[nodiscard]] bool		 is_refined() const { return refined; }
+
+	// Full resolution, previews are rendered at `1 / preview_divisor` of it
+	static constexpr int size			 = 320;
+	static constexpr int preview_divisor = 4;
+
+	static constexpr int preview_iter = 256, refined_iter = 1024;
+
+	// Width of the plane shown, centered at the origin
+	static constexpr double extent = 3.2;
+
+	// Rest of the cursor after which the preview is refined
+	std::chrono::milliseconds refine_delay{150};
+
+  private:
+	Texture2d target;
+	int		  region  = 0;	// Rendered square of `target`
+	bool	  refined = false;
+
+	// Inputs of the frame in `target`, and the time `c` was last changed
+	glm::dvec2							  c = {0.0, 0.0};
+	Kernel_variant						  variant;
+	int									  palette_cycle = 0;
+	std::chrono::steady_clock::time_point moved;
+
+	void render(Gpu_renderer&	 renderer,
+				const Texture1d& palette,
+				Kernel_precision precision,
+				int				 resolution,
+				int				 max_iter);
+};
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "common-include.hpp"
+#include "shader.hpp"
+
+enum class Kernel_precision
+{
+	Fp32,
+	Fp64,
+	Double_double,	// Pairs of doubles, resolves views around 2^50 times deeper than Fp64
+	Fixed128		// 128-bit fixed point in 64-bit integers, needs GL_ARB_gpu_shader_int64
+};
+
+enum class Kernel_formula
+{
+	Mandelbrot,
+	Julia,	// Of Render_params::julia_c, GPU kernels only
+	Burning_ship,
+	Tricorn,
+	Multibrot3,	 // z^3 + c
+	Multibrot4,
+	Multibrot5,
+	Multibrot6,
+	Multibrot7,
+	Multibrot8
+};
+
+enum class Kernel_coloring
+{
+	Iteration,
+	Smooth,
+	Distance
+};
+
+// Compile-time configuration of a generated kernel, see generator.frag for the switches
+struct Kernel_variant
+{
+	Kernel_precision precision = Kernel_precision::Fp64;
+	Kernel_formula	 formula   = Kernel_formula::Mandelbrot;
+	Kernel_coloring	 coloring  = Kernel_coloring::Iteration;
+
+	int	 unroll			  = 1;	// 1, 2, 4 or 8
+	int	 bailout_interval = 1;	// 1, 4, 8 or 16, iterations between escape checks
+	bool periodicity	  = false;
+	bool derivative		  = false;	// implied by Kernel_coloring::Distance
+
+	[[nodiscard]] Shader_variant_cache::Defines defines() const;
+
+	bool operator==(const Kernel_variant&) const = default;
+
+	static const char* name(Kernel_precision precision);
+	static const char* name(Kernel_formula formula);
+	static const char* name(Kernel_coloring coloring);
+
+	// Whether conjugate points get conjugate orbits, making the image symmetric to the real axis
+	static bool is_conjugate_symmetric(Kernel_formula formula);
+
+	// Whether perturbation and the nucleus search apply, both are derived for z^2 + c
+	static bool supports_perturbation(Kernel_formula formula);
+};
+
+// Insert the shared kernel body (kernel.glsl) after the #version line of a kernel stage
+std::string compose_kernel_stage(const std::string& stage_source);
@@ -17,34 +17,110 @@
 #pragma once
 
 #include "common-include.hpp"
-#include "framebuffer.hpp"
+#include "cpu-renderer.hpp"
+#include "gpu-render-worker.hpp"
+#include "gpu-renderer.hpp"
+#include "iteration-controller.hpp"
+#include "iteration-map-file.hpp"
+#include "julia-preview.hpp"
+#include "kernel.hpp"
 #include "palette.hpp"
-#include "shader.hpp"
+#include "precision-selector.hpp"
+#include "program-cache.hpp"
+#include "render-service.hpp"
+#include "render-params.hpp"
+#include "resolution-governor.hpp"
 #include "texture.hpp"
 #include "timer.hpp"
 
 #include <chrono>
+#include <future>
+#include <thread>
 
+// The center is a double-double like the one of Render_params and is only ever moved by
+// offsets, so that panning and zooming resolve about 2^53 times finer than a double center
 struct Mandelbrot_coord
 {
-	glm::dvec2 center = {0.0, 0.0};
-	double	   width  = 2;
+	glm::dvec2 center	 = {0.0, 0.0};
+	glm::dvec2 center_lo = {0.0, 0.0};
+	double	   width	 = 2;
+
+	// Move the center by `offset`, keeping the bits that fall below the ulp of `center`
+	void move(glm::dvec2 offset);
 };
 
 class Logic_handler
 {
   public:
-	Logic_handler(float content_scale);
+	Logic_handler(GLFWwindow* window, float content_scale);
+	~Logic_handler();
 
 	void update(int width, int height);
 
   private:
-	Framebuffer framebuffer;
-	Texture2d	mandelbrot_buffer;
-	Texture1d	palette_texture;
-	Shader		mandelbrot_shader;
+	Program_cache  program_cache{"shader-cache"};
+	Gpu_renderer   gpu_renderer;
+	Kernel_variant kernel_variant;
+	Gpu_backend	   gpu_backend = Gpu_backend::Fragment;
+
+	// Declared before `gpu_worker`, which samples it until the worker is destroyed
+	Texture1d palette_texture;
+
+	// GPU backends render on a worker context, `gpu_renderer` only colorizes CPU results and
+	// runs benchmarks. Null if the worker context is unavailable, then everything renders here.
+	std::unique_ptr<Gpu_render_worker> gpu_worker;
+	std::vector<uint32_t>			   compaction_history;
+
+	// With `automatic_precision`, every render picks the cheapest engine that resolves its
+	// pixels: FP32, FP64 and double-double kernels, then CPU perturbation. `precision_tier` is
+	// the engine of the last request, also when picked by hand.
+	Precision_selector precision_selector;
+	bool			   automatic_precision = true;
+	Precision_tier	   precision_tier	   = Precision_tier::Fp64;
+
+	// Snap the view to the real axis and let the renderers mirror it
+	bool real_axis_symmetry = true;
+
+	// CPU rendering on the render service thread, finished iteration maps are colorized by
+	// the GPU. `cpu_request` is the last submitted request. Perturbed renders share their
+	// reference orbits with other sessions and processes through `reference_store`.
+	Reference_orbit_store reference_store{"reference-cache"};
+	Cpu_renderer		  cpu_renderer;
+	Render_service		  render_service{cpu_renderer};
+	bool				  cpu_render		= false;
+	bool				  certify_tiles		= true;
+	bool				  adaptive_limits	= true;
+	bool				  perturbation		= false;
+	bool				  nucleus_reference	= true;
+	Render_request		  cpu_request;
+	Cpu_render_stats	  cpu_stats;
+
+	// Split each frame between the fragment kernel and the CPU engine on the GPU worker,
+	// `hybrid_stats` is the split of the last hybrid frame
+	bool							  hybrid_render = false;
+	std::optional<Hybrid_frame_stats> hybrid_stats;
+
+	Texture2d mandelbrot_buffer;
+
+	// Interactive frames render a scaled-down view into the top-left corner of their target.
+	// `display_texture` holds the frame on screen, `render_width`x`render_height` of its
+	// `display_target_size` pixels are rendered.
+	Resolution_governor governor;
+	bool				interacting		= false;
+	GLuint				display_texture = 0;
+	int					render_width	= 0;
+	int					render_height	= 0;
+	glm::ivec2			display_target_size{1, 1};
 
-	int display_ratio = 1;
+	// The settled view is saved at exit and shown again at startup, without running a kernel if
+	// the window size is unchanged. `settled_map` is the last finished settled frame of any
+	// backend. GPU frames leave its map empty and keep it in `settled_map_buffer` instead, read
+	// back only when saving.
+	static constexpr const char*	   session_path = "last-session.mbim";
+	std::optional<Iteration_map_image> settled_map;
+	std::optional<Buffer>			   settled_map_buffer;
+	Texture2d						   restored_texture;
+	std::optional<glm::ivec2>		   restored_size;
 
 	int	  width = 0, height = 0;
 	float content_scale = 1;
@@ -56,8 +132,12 @@ class Logic_handler
 			true,
 			"Default Rainbow"}};
 
-	int	 manual_max_iter	 = 256;
-	bool manual_iter_enabled = false;
+	// `manual_max_iter` overrides the limit picked by `iteration_controller`. Settled frames
+	// probe with a copy of it on their render thread and bring the picked limit back.
+	Iteration_controller iteration_controller;
+	int					 manual_max_iter	 = 256;
+	bool				 manual_iter_enabled = false;
+
 	int	 palette_cycle		 = 256;
 	int	 palette_size		 = 256;
 
@@ -69,6 +149,26 @@ class Logic_handler
 	Query_timer timer;
 	float		prev_time_elapsed;
 
+	// Last benchmark result of each GPU backend, and of each precision with the current backend,
+	// in ms
+	std::vector<std::pair<Gpu_backend, float>>		benchmark_result;
+	std::vector<std::pair<Kernel_precision, float>> precision_benchmark_result;
+
+	// Wall-clock time of rendering `thumbnail_count` thumbnails of the current view in ms: in
+	// batches on the GPU, one fragment render each, and the iteration maps in batches on the CPU
+	static constexpr int thumbnail_count = 4096, thumbnail_size = 128;
+	struct Thumbnail_benchmark
+	{
+		float gpu_batch_ms, gpu_single_ms, cpu_batch_ms;
+		int	  batch_size;
+	};
+	std::optional<Thumbnail_benchmark> thumbnail_benchmark_result;
+	std::future<Thumbnail_benchmark>   thumbnail_benchmark_gpu;  // Without the CPU timing
+	std::future<float>				   thumbnail_benchmark_cpu;
+
+	// Submitted once the GPU part has finished, so that the two don't compete for the CPU
+	std::function<float(Cpu_renderer&, std::stop_token)> thumbnail_benchmark_cpu_part;
+
 	struct
 	{
 		float status_bar_height = 30.0f;
@@ -82,7 +182,89 @@ class Logic_handler
 		palette.manipulate_texture(palette_texture, palette_size);
 	}
 
+	// Switch to another kernel variant, compiling it on first use
+	void select_variant(const Kernel_variant& variant);
+
+	// Compile the variants of the precisions next to the current one on the worker context, so
+	// that switching to them loads their programs from the shader cache instead of compiling
+	// them on the UI thread. `prepared_neighbours` is the variant they were compiled for.
+	void prepare_neighbour_variants();
+
+	std::optional<Kernel_variant> prepared_neighbours;
+
+	// Render the current view with every GPU backend and every precision, recording the timings
+	void run_benchmark();
+
+	// Render thumbnails of a grid of cells of the current view with the batch APIs and one by
+	// one, recording the timings. The GPU part runs on the worker context and the CPU part on
+	// the render service, collect_thumbnail_benchmark() records the timings once both finished.
+	void run_thumbnail_benchmark();
+	void collect_thumbnail_benchmark();
+
+	// Search the nucleus of the lowest period in view on another thread, replacing a search in
+	// progress. Once it has finished, collect_nucleus_search() centers the view on it and zooms
+	// to its minibrot. `zoom_nucleus` is the last one found, `zoom_nucleus_ms` the time spent
+	// finding it.
+	void zoom_to_nucleus();
+	void collect_nucleus_search();
+
+	struct Nucleus_search
+	{
+		std::optional<Nucleus> nucleus;
+		int					   max_period;
+		float				   time_ms;
+	};
+
+	std::optional<Nucleus>		zoom_nucleus;
+	float						zoom_nucleus_ms = 0;
+	std::future<Nucleus_search> nucleus_search;
+	std::jthread				nucleus_search_thread;	// Stopped and joined when replaced
+
+	// Inset of the Julia set of the point under the cursor, rendered here on the UI context
+	Julia_preview julia_preview;
+	bool		  julia_preview_enabled = false;
+
+	// Point of the plane under the screen position `position` of the view `coord`, and its
+	// offset from the center
+	[[nodiscard]] glm::dvec2 screen_to_complex(const Mandelbrot_coord& coord, ImVec2 position) const;
+	[[nodiscard]] glm::dvec2 screen_to_offset(const Mandelbrot_coord& coord, ImVec2 position) const;
+
+	// Update the Julia preview to the point under the cursor, while it is over the view
+	void update_julia_preview();
+
+	// View of `coord` rendered into a region `region_height` pixels high
+	[[nodiscard]] Render_params get_render_params(const Mandelbrot_coord& coord,
+												  int					  region_height) const;
+
 	void update_view();
 	void render_view();
+
+	// Engine for `params` rendered `region_width` pixels wide, switching the kernel precision
+	// to it when selected automatically
+	Precision_tier select_precision(const Render_params& params, int region_width);
+
+	// Render `manipulate_coord` at the governed scale, synchronously on the GPU or by
+	// submitting it to the render service
+	void request_render(bool interactive);
+
+	// Present the render service result, if one has finished
+	void collect_cpu_render();
+
+	// Swap in the frame of the GPU worker, if one has finished
+	void collect_gpu_render();
+
+	// Show `texture`, a `target_size` texture whose top-left `region_size` pixels hold `params`
+	void show_frame(GLuint				 texture,
+					const Render_params& params,
+					glm::ivec2			 region_size,
+					glm::ivec2			 target_size);
+
 	void render_imgui();
+
+	// Show the view saved by save_session(), if there is one
+	void restore_session();
+
+	// Save the iteration map of the view on screen, evaluating it again if it only exists as
+	// colors
+	void save_session();
 };
\ No newline at end of file
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "common-include.hpp"
+#include "util.hpp"
+
+#include <cstddef>
+#include <filesystem>
+
+// Read-only memory mapping of a whole file, pages are loaded by the OS on first access
+class Mapped_file
+{
+  public:
+	static Result<Mapped_file, std::string> open(const std::filesystem::path& path);
+
+	Mapped_file(const Mapped_file&)			   = delete;
+	Mapped_file& operator=(const Mapped_file&) = delete;
+	Mapped_file(Mapped_file&& other) noexcept;
+	Mapped_file& operator=(Mapped_file&& other) noexcept;
+	~Mapped_file();
+
+	[[nodiscard]] const std::byte* data() const { return view; }
+	[[nodiscard]] size_t		   size() const { return length; }
+
+  private:
+	Mapped_file() = default;
+
+	const std::byte* view	= nullptr;
+	size_t			 length = 0;
+
+#ifdef _WIN32
+	void* file_handle	 = nullptr;
+	void* mapping_handle = nullptr;
+#endif
+
+	void close();
+};
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/*
+DESCRIPTION:
+Nuclei of minibrots, the centers c whose orbit returns to zero after `period` iterations.
+Perturbation orbits referenced at a nucleus never escape, so pixels are only rebased where
+they leave it, and the same nucleus is found from every view around it.
+*/
+
+#pragma once
+
+#include "common-include.hpp"
+#include "fixed-point.hpp"
+
+#include <optional>
+#include <stop_token>
+
+struct Nucleus
+{
+	Fixed_complex center;
+	int			  period	   = 0;
+	int			  newton_steps = 0;
+
+	// Scale of the minibrot relative to the whole set, which spans about 3 of it in x
+	double size = 0;
+};
+
+// Lowest period of the nuclei within `radius` of `center`, up to `max_period`. The disk is
+// iterated as a ball around the orbit of `center` with first-order radius |dz/dc| * `radius`,
+// the period is the first iteration at which the ball contains zero. Returns nullopt if the
+// orbit of `center` escapes first or `stop` was requested.
+std::optional<int> find_period(const Fixed_complex& center,
+							   double				radius,
+							   int					max_period,
+							   std::stop_token		stop = {});
+
+// Solve z_period(c) = 0 with Newton's method from `guess`, iterating z in the precision of
+// `guess` and dz/dc in double. Converges once a step falls to the rounding noise of the
+// iteration, returns nullopt if it doesn't within `max_steps`, an orbit leaves the range of the
+// fixed-point numbers, or `stop` was requested.
+std::optional<Nucleus> find_nucleus(const Fixed_complex& guess,
+									int					 period,
+									int					 max_steps = 64,
+									std::stop_token		 stop	   = {});
+
+// Nucleus of the lowest period within `radius` of `center`, see find_period(). Newton's method
+// may still converge to a nucleus outside the disk, the caller decides whether it's close enough.
+std::optional<Nucleus> find_nearest_nucleus(const Fixed_complex& center,
+											double				 radius,
+											int					 max_period,
+											std::stop_token		 stop = {});
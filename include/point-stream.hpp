@@ -0,0 +1,71 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+DESCRIPTION:
+Evaluation of point lists too large to hold in memory. Points are pulled from a reader one
+chunk at a time and the results of every chunk are handed to a writer before its buffers are
+reused, so memory stays at a few chunks whatever the size of the input.
+*/
+
+#pragma once
+
+#include "common-include.hpp"
+#include "cpu-renderer.hpp"
+#include "gpu-renderer.hpp"
+
+#include <functional>
+#include <stop_token>
+
+// Results computed by stream_points()
+struct Point_outputs
+{
+	bool iterations = true;
+	bool z			= true;
+	bool distance	= true;
+};
+
+// Writes up to `capacity` points into `x` and `y` and returns how many it wrote, 0 once the
+// input is exhausted
+using Point_reader = std::function<size_t(double* x, double* y, size_t capacity)>;
+
+// Receives the results of the `count` points starting at index `first` of the input. The arrays
+// are only valid during the call, and null for outputs that were not requested.
+using Point_writer = std::function<void(uint64_t first, size_t count, const Point_results& results)>;
+
+// Evaluate every point of `read` on the threads of `renderer`, `chunk_size` points at a time.
+// Returns the number of points evaluated and written, short of the input if `stop` was requested.
+uint64_t stream_points(Cpu_renderer&		 renderer,
+					   const Kernel_variant& variant,
+					   int					 max_iter,
+					   const Point_outputs&	 outputs,
+					   size_t				 chunk_size,
+					   const Point_reader&	 read,
+					   const Point_writer&	 write,
+					   std::stop_token		 stop = {});
+
+// Same on the GPU, with two chunks in flight so that the next one is read while the GPU
+// evaluates the current one. With ARB_buffer_storage the chunk buffers are mapped persistently:
+// the reader writes its points and the writer reads the results in place, without copies.
+uint64_t stream_points(Gpu_renderer&		 renderer,
+					   const Kernel_variant& variant,
+					   int					 max_iter,
+					   const Point_outputs&	 outputs,
+					   size_t				 chunk_size,
+					   const Point_reader&	 read,
+					   const Point_writer&	 write,
+					   std::stop_token		 stop = {});
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "common-include.hpp"
+#include "kernel.hpp"
+#include "render-params.hpp"
+
+#include <span>
+
+// Numeric engines in order of cost, each resolving deeper views than the previous one
+enum class Precision_tier
+{
+	Fp32,
+	Fp64,
+	Double_double,
+	Fixed128,	  // Absolute precision, deeper than double-double anywhere in the set
+	Perturbation  // CPU, offsets from a fixed-point reference orbit
+};
+
+const char* get_tier_name(Precision_tier tier);
+
+// Kernel precision of a tier run by a generated kernel, Fp64 for perturbation whose offsets are
+// doubles
+Kernel_precision get_kernel_precision(Precision_tier tier);
+
+// Tier of a generated kernel running in `precision`
+Precision_tier get_precision_tier(Kernel_precision precision);
+
+// Picks the cheapest tier that still resolves the pixels of a view. A tier resolves a view
+// while its ulp at the center coordinates is `guard_bits` below the pixel spacing; past that,
+// neighbouring pixels round to the same point or close to it and the image breaks into blocks.
+class Precision_selector
+{
+  public:
+	static constexpr double guard_bits = 8;
+
+	// A cheaper tier is only taken back with this much headroom above `guard_bits`, so that
+	// views near a threshold don't switch back and forth between frames
+	static constexpr double hysteresis_bits = 2;
+
+	// Tier for `params` rendered `region_width` pixels wide, out of `available` in order of cost
+	Precision_tier select(const Render_params&			  params,
+						  int							  region_width,
+						  std::span<const Precision_tier> available);
+
+	// Bits between the pixel spacing and the ulp of the center coordinates in `tier`, negative
+	// once pixels are closer together than the center can be resolved
+	static double get_headroom(Precision_tier tier, const Render_params& params, int region_width);
+
+	[[nodiscard]] Precision_tier get_tier() const { return tier; }
+	[[nodiscard]] double		 get_headroom() const { return headroom; }
+
+	// Feed back the time of a frame rendered with `tier`, for get_cost()
+	void report(Precision_tier tier, float time_ms, int pixel_count);
+
+	// Measured milliseconds per megapixel of `tier`, 0 before the first report
+	[[nodiscard]] float get_cost(Precision_tier tier) const { return cost[(int)tier]; }
+
+  private:
+	static constexpr float smoothing = 0.5f;
+
+	Precision_tier tier		= Precision_tier::Fp64;
+	double		   headroom = 0;
+	float		   cost[5]	= {};
+};
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "common-include.hpp"
+#include "shader.hpp"
+
+#include <filesystem>
+#include <functional>
+
+// On-disk cache of linked program binaries.
+// Entries are keyed by a hash of the shader sources and the driver vendor, renderer and version,
+// so that a driver update or a GPU swap never picks up a stale binary.
+class Program_cache
+{
+  public:
+	Program_cache(std::filesystem::path directory);
+
+	// Load the program built from `sources` from the cache, or build it with `compile` on a miss
+	// and store the result. Falls back to `compile` if the driver rejects the cached binary.
+	Result<Shader, std::string> get(const std::vector<std::string_view>&				sources,
+									const std::function<Result<Shader, std::string>()>& compile);
+
+  private:
+	std::filesystem::path directory;
+	std::string			  driver_id;
+	bool				  enabled = false;
+
+	[[nodiscard]] std::filesystem::path entry_path(uint64_t key) const;
+	[[nodiscard]] uint64_t hash_key(const std::vector<std::string_view>& sources) const;
+
+	[[nodiscard]] std::optional<Program_binary> load(uint64_t key) const;
+	void store(uint64_t key, const Program_binary& binary) const;
+};
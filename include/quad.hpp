@@ -28,7 +28,10 @@ class Quad_mesh
 
   private:
 	static const std::array<glm::vec2, 4> quad_data;
-	static GLuint						  shared_vao;
-	static GLuint						  shared_vbo;
-	static size_t						  use_count;
+
+	// Vertex arrays are not shared between contexts, so one set per thread, each rendering
+	// thread owns its own context
+	static thread_local GLuint shared_vao;
+	static thread_local GLuint shared_vbo;
+	static thread_local size_t use_count;
 };
\ No newline at end of file
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+DESCRIPTION:
+On-disk store of reference orbits, shared between sessions and between processes on one host.
+Orbits are mapped read-only, so every process rendering the same location reads the same
+pages, and an orbit asked for with a larger `max_iter` is extended from its last stored
+iterate instead of being computed again.
+*/
+
+#pragma once
+
+#include "common-include.hpp"
+#include "kernel.hpp"
+#include "reference-orbit.hpp"
+
+#include <filesystem>
+
+class Reference_orbit_store
+{
+  public:
+	Reference_orbit_store(std::filesystem::path directory);
+
+	struct Stats
+	{
+		uint64_t hits		= 0;  // Stored orbit long enough
+		uint64_t extensions = 0;  // Stored orbit too short and extended
+		uint64_t misses		= 0;  // Nothing stored for the key
+	};
+
+	// Orbit of `center` up to `max_iter` or its escape. Entries are keyed by the center, its
+	// number of limbs, the formula and the storage settings. Falls back to an in-memory orbit
+	// if the entry can't be written. Returns nullptr if `stop` was requested.
+	std::shared_ptr<const Reference_orbit> get(const Fixed_complex&			   center,
+											   int							   max_iter,
+											   Kernel_formula				   formula,
+											   const Reference_orbit::Settings& settings,
+											   std::stop_token				   stop = {});
+
+	[[nodiscard]] Stats get_stats() const;
+
+  private:
+	std::filesystem::path directory;
+	bool				  enabled = false;
+
+	mutable std::mutex mutex;
+	Stats			   stats;
+
+	struct Key
+	{
+		const Fixed_complex&			 center;
+		Kernel_formula					 formula;
+		const Reference_orbit::Settings& settings;
+	};
+
+	[[nodiscard]] std::filesystem::path entry_path(const Key& key) const;
+
+	// Map a stored orbit, nullptr if there is none or it doesn't match `key`. `last` is set to
+	// the exact iterate at the end of the orbit.
+	static std::shared_ptr<Reference_orbit> load(const std::filesystem::path& path,
+												 const Key&					  key,
+												 Fixed_complex&				  last);
+
+	// Write the orbit up to `max_iter`, continuing from `prefix` whose last iterate is `last`
+	// if there is one. Returns false on failure, with `stopped` set if `stop` was requested.
+	static bool write(const std::filesystem::path& path,
+					  const Key&				   key,
+					  int						   max_iter,
+					  const Reference_orbit*	   prefix,
+					  const Fixed_complex&		   last,
+					  std::stop_token			   stop,
+					  bool&						   stopped);
+};
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+DESCRIPTION:
+High-precision reference orbits for perturbation. Iterates are stored rounded to double or
+float in structure-of-arrays segments, and only the exact state at the start of every segment
+is kept for good. Segments beyond the memory budget are dropped and regenerated from their
+checkpoint when read again, so an orbit of any length fits a bounded amount of memory and can
+be shared by every thread and frame rendering near it. Orbits loaded by Reference_orbit_store
+read their segments from a file mapping instead.
+*/
+
+#pragma once
+
+#include "common-include.hpp"
+#include "fixed-point.hpp"
+#include "mapped-file.hpp"
+
+#include <functional>
+#include <mutex>
+#include <stop_token>
+
+enum class Orbit_encoding
+{
+	Double,	 // 16 bytes per iterate
+	Float	 // 8 bytes per iterate, for previews, orbits lose precision on every rebase
+};
+
+struct Reference_orbit_stats
+{
+	int		 length				  = 0;
+	int		 segment_count		  = 0;
+	int		 resident_segments	  = 0;
+	size_t	 resident_bytes		  = 0;
+	size_t	 checkpoint_bytes	  = 0;
+	size_t	 mapped_bytes		  = 0;	// Size of the backing file, paged in by the OS
+	uint64_t regenerated_segments = 0;
+};
+
+class Reference_orbit
+{
+  private:
+	struct Segment;
+
+  public:
+	struct Settings
+	{
+		Orbit_encoding encoding		  = Orbit_encoding::Double;
+		int			   segment_length = 1 << 16;  // Iterates per segment, and between checkpoints
+		size_t		   memory_budget  = (size_t)256 << 20;	// Bytes of resident segments
+	};
+
+	// Orbit escapes once |Z|^2 reaches this, at least the escape radius of every coloring
+	static constexpr double escape_radius2 = 65536.0;
+
+	// Iterate the orbit of `center` up to `max_iter` or its escape, whichever comes first.
+	// Returns nullptr if `stop` was requested.
+	static std::shared_ptr<Reference_orbit> compute(const Fixed_complex& center,
+													int					 max_iter,
+													const Settings&		 settings,
+													std::stop_token		 stop = {});
+
+	// Sequential reader of the iterates, holding on to the segment it reads so that it isn't
+	// evicted underneath. One per thread.
+	class Cursor
+	{
+	  public:
+		Cursor(const Reference_orbit& orbit) :
+			orbit(orbit)
+		{}
+
+		// Z_n for n in [0, get_length()]
+		glm::dvec2 operator[](int n)
+		{
+			if (n < begin || n >= end) fetch(n);
+
+			const int index = n - begin;
+			if (x_float != nullptr) return {x_float[index], y_float[index]};
+			return {x[index], y[index]};
+		}
+
+	  private:
+		const Reference_orbit&		   orbit;
+		std::shared_ptr<const Segment> segment;
+		int							   begin = 0, end = 0;
+
+		// Values of the current segment, only the pair of the encoding is set
+		const double *x = nullptr, *y = nullptr;
+		const float	 *x_float = nullptr, *y_float = nullptr;
+
+		void fetch(int n);
+	};
+
+	[[nodiscard]] const Fixed_complex& get_center() const { return center; }
+	[[nodiscard]] int				   get_limbs() const { return center.x.get_limbs(); }
+
+	// Index of the last iterate, the escape iteration or `max_iter`
+	[[nodiscard]] int  get_length() const { return length; }
+	[[nodiscard]] int  get_max_iter() const { return max_iter; }
+	[[nodiscard]] bool escaped() const { return length < max_iter; }
+
+	[[nodiscard]] const Settings& get_settings() const { return settings; }
+
+	[[nodiscard]] Reference_orbit_stats get_stats() const;
+
+	// Drop every resident segment, the next reads regenerate them
+	void evict_all() const;
+
+  private:
+	friend class Reference_orbit_store;
+
+	struct Segment
+	{
+		// Only the pair matching the encoding of the orbit is filled
+		std::vector<double> x, y;
+		std::vector<float>	x_float, y_float;
+
+		void push(glm::dvec2 z, Orbit_encoding encoding);
+
+		[[nodiscard]] int	 size() const { return (int)std::max(x.size(), x_float.size()); }
+		[[nodiscard]] size_t bytes() const
+		{
+			return (x.size() + y.size()) * sizeof(double)
+				 + (x_float.size() + y_float.size()) * sizeof(float);
+		}
+	};
+
+	Reference_orbit(const Fixed_complex& center, int max_iter, const Settings& settings);
+
+	Fixed_complex			   center;
+	int						   max_iter;
+	int						   length = 0;
+	Settings				   settings;
+	std::vector<Fixed_complex> checkpoints;	 // Z at the first iterate of every segment
+
+	// Backing file of a stored orbit, holding every segment at `blocks`
+	std::optional<Mapped_file> file;
+	const std::byte*		   blocks = nullptr;
+
+	// Cache of segments, read from every rendering thread
+	mutable std::mutex							 mutex;
+	mutable std::vector<std::shared_ptr<Segment>> segments;
+	mutable std::vector<uint64_t>				 last_use;
+	mutable uint64_t							 use_clock			  = 0;
+	mutable size_t								 resident_bytes		  = 0;
+	mutable uint64_t							 regenerated_segments = 0;
+
+	// Iterate the orbit of `center` from `z`, the iterate at `n`, until it escapes or reaches
+	// `max_iter`. Every iterate is passed to `emit`, and the exact state at the start of every
+	// segment to `checkpoint` beforehand. Returns the last iteration with `z` set to its
+	// iterate, or -1 if `stop` was requested.
+	static int iterate(const Fixed_complex&										  center,
+					   Fixed_complex&											  z,
+					   int														  n,
+					   int														  max_iter,
+					   int														  segment_length,
+					   std::stop_token											  stop,
+					   const std::function<void(int n, glm::dvec2 value)>&		  emit,
+					   const std::function<void(int n, const Fixed_complex& z)>& checkpoint);
+
+	// Bytes of one value of `encoding`
+	static size_t value_size(Orbit_encoding encoding)
+	{
+		return encoding == Orbit_encoding::Float ? sizeof(float) : sizeof(double);
+	}
+
+	std::shared_ptr<const Segment> get_segment(int index) const;
+
+	// Iterate segment `index` again from its checkpoint
+	std::shared_ptr<Segment> generate(int index) const;
+
+	// Make `segment` resident, evicting the least recently used ones beyond the budget.
+	// Called with `mutex` held.
+	void insert(int index, std::shared_ptr<Segment> segment) const;
+};
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "common-include.hpp"
+
+#include <cstddef>
+
+// Per-frame kernel parameters, mirrors the std140 `Render_params` block of generator.frag.
+// The center is a double-double, `center + center_lo`, so that views can be placed finer than
+// the ulp of `center`. Kernels iterating in double or float ignore the trailing part.
+struct Render_params
+{
+	glm::dvec2 center;
+	glm::dvec2 size;
+	int32_t	   max_iter;
+	int32_t	   palette_cycle;
+	int32_t	   padding[2] = {0, 0};	// std140 aligns the dvec2 below to 16 bytes
+	glm::dvec2 julia_c	  = {0.0, 0.0};	// Parameter of Kernel_formula::Julia
+	glm::dvec2 center_lo  = {0.0, 0.0};	// Trailing part of the center, below its ulp
+};
+
+static_assert(offsetof(Render_params, center) == 0);
+static_assert(offsetof(Render_params, size) == 16);
+static_assert(offsetof(Render_params, max_iter) == 32);
+static_assert(offsetof(Render_params, palette_cycle) == 36);
+static_assert(offsetof(Render_params, julia_c) == 48);
+static_assert(offsetof(Render_params, center_lo) == 64);
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "common-include.hpp"
+#include "cpu-renderer.hpp"
+#include "iteration-controller.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+struct Render_request
+{
+	Render_params  params;
+	Kernel_variant variant;
+	int			   width = 0, height = 0;
+
+	// Frame of an ongoing interaction, rendered at reduced scale
+	bool  interactive = false;
+	float scale		  = 1.0f;
+
+	// Cpu_renderer options, applied by the render thread
+	bool use_symmetry	   = true;
+	bool certify_tiles	   = true;
+	bool adaptive_limits   = true;
+	bool perturbation	   = false;
+	bool nucleus_reference = true;
+
+	// Probe with this copy of the controller and render at the limit it picks, the request of
+	// the result holds both
+	std::optional<Iteration_controller> iteration_controller;
+};
+
+struct Render_result
+{
+	Render_request		   request;
+	std::vector<glm::vec2> map;
+	Cpu_render_stats	   stats;
+};
+
+// Runs CPU renders on a dedicated thread, so the UI thread never blocks on them.
+// Only the latest request matters: submitting one cancels the render in progress at its next
+// tile and drops any result not yet collected.
+class Render_service
+{
+  public:
+	Render_service(Cpu_renderer& renderer);
+	~Render_service();
+
+	Render_service(const Render_service&) = delete;
+	Render_service(Render_service&&)	  = delete;
+
+	void submit(const Render_request& request);
+
+	// Result of the last submitted request, once it has finished
+	std::optional<Render_result> poll();
+
+	// A request is queued or being rendered
+	[[nodiscard]] bool busy() const;
+
+	// Renders cancelled by a newer request before they finished
+	[[nodiscard]] uint64_t get_cancelled_count() const;
+
+	// Run task(renderer, stop) on the render thread while no request is queued, for other work
+	// on the renderer. Requests don't cancel tasks, `stop` is requested when the service shuts
+	// down.
+	template <typename F> auto submit_task(F task)
+	{
+		using Result   = std::invoke_result_t<F&, Cpu_renderer&, std::stop_token>;
+		using Packaged = std::packaged_task<Result(Cpu_renderer&, std::stop_token)>;
+
+		// Shared, std::function needs a copyable target
+		auto packaged = std::make_shared<Packaged>(std::move(task));
+		auto future	  = packaged->get_future();
+
+		std::lock_guard lock(mutex);
+		tasks.emplace_back([packaged](Cpu_renderer& renderer, std::stop_token stop)
+						   { (*packaged)(renderer, stop); });
+		wakeup.notify_one();
+
+		return future;
+	}
+
+  private:
+	using Task = std::function<void(Cpu_renderer&, std::stop_token)>;
+
+	Cpu_renderer& renderer;
+
+	mutable std::mutex			mutex;
+	std::condition_variable_any wakeup;
+
+	std::optional<Render_request> pending;
+	std::optional<Render_result>  finished;
+	std::deque<Task>			  tasks;
+	std::stop_source			  job;	// Cancels the render in progress
+	bool						  rendering		  = false;
+	uint64_t					  cancelled_count = 0;
+
+	std::jthread thread;  // Last member, started once everything else is constructed
+
+	void run(std::stop_token stop);
+};
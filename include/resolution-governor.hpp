@@ -0,0 +1,58 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "common-include.hpp"
+
+// Picks the render scale of interactive frames from measured render times, so that dragging
+// and zooming hold a frame-time budget. Render time is taken as proportional to the pixel
+// count, every measured frame refines the estimated cost of a full-resolution frame.
+class Resolution_governor
+{
+  public:
+	float target_ms = 16.0f;
+	float min_scale = 0.125f;
+
+	// Scale of the next frame along each axis, full resolution once interaction has stopped
+	[[nodiscard]] float get_scale(bool interactive) const { return interactive ? scale : 1.0f; }
+
+	// Feed back the time of a frame rendered at `frame_scale`
+	void report(float frame_scale, float time_ms, bool interactive);
+
+	// Scale picked for interactive frames
+	[[nodiscard]] float get_interactive_scale() const { return scale; }
+
+	// Estimated time of a full-resolution frame, 0 before the first report
+	[[nodiscard]] float get_full_cost() const { return full_cost_ms; }
+
+	// Interactive frames that took longer than `target_ms`, out of all interactive frames
+	[[nodiscard]] int get_miss_count() const { return miss_count; }
+	[[nodiscard]] int get_interactive_frame_count() const { return interactive_frame_count; }
+
+  private:
+	// Weight of the newest frame in the running cost estimate
+	static constexpr float smoothing = 0.5f;
+
+	// Fraction of the budget aimed at, leaves room for frame-to-frame noise
+	static constexpr float headroom = 0.9f;
+
+	float scale		   = 1.0f;
+	float full_cost_ms = 0.0f;
+
+	int miss_count				= 0;
+	int interactive_frame_count = 0;
+};
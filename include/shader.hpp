@@ -19,28 +19,237 @@
 #include "common-include.hpp"
 #include "util.hpp"
 
+#include <unordered_map>
+
+// Maps a C++ type to the GL uniform types it may be bound to
+template <typename T> struct Uniform_type;
+
+template <> struct Uniform_type<int>
+{
+	static bool match(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_INT:
+		case GL_BOOL:
+		case GL_SAMPLER_1D:
+		case GL_SAMPLER_2D:
+		case GL_IMAGE_2D:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static void set(GLuint program, GLint location, const int& value)
+	{
+		glProgramUniform1i(program, location, value);
+	}
+};
+
+template <> struct Uniform_type<unsigned int>
+{
+	static bool match(GLenum type) { return type == GL_UNSIGNED_INT; }
+
+	static void set(GLuint program, GLint location, const unsigned int& value)
+	{
+		glProgramUniform1ui(program, location, value);
+	}
+};
+
+template <> struct Uniform_type<float>
+{
+	static bool match(GLenum type) { return type == GL_FLOAT; }
+
+	static void set(GLuint program, GLint location, const float& value)
+	{
+		glProgramUniform1f(program, location, value);
+	}
+};
+
+template <> struct Uniform_type<glm::vec2>
+{
+	static bool match(GLenum type) { return type == GL_FLOAT_VEC2; }
+
+	static void set(GLuint program, GLint location, const glm::vec2& value)
+	{
+		glProgramUniform2f(program, location, value.x, value.y);
+	}
+};
+
+template <> struct Uniform_type<glm::dvec2>
+{
+	static bool match(GLenum type) { return type == GL_DOUBLE_VEC2; }
+
+	static void set(GLuint program, GLint location, const glm::dvec2& value)
+	{
+		glProgramUniform2d(program, location, value.x, value.y);
+	}
+};
+
+template <> struct Uniform_type<glm::ivec2>
+{
+	static bool match(GLenum type) { return type == GL_INT_VEC2; }
+
+	static void set(GLuint program, GLint location, const glm::ivec2& value)
+	{
+		glProgramUniform2i(program, location, value.x, value.y);
+	}
+};
+
+// Typed handle to a uniform in the default block, location resolved once at reflection
+template <typename T> class Uniform
+{
+  public:
+	Uniform() = default;
+
+	void set(const T& value) const
+	{
+		if (location >= 0) Uniform_type<T>::set(program, location, value);
+	}
+
+	[[nodiscard]] bool valid() const { return location >= 0; }
+
+  private:
+	friend class Shader;
+
+	GLuint program	= 0;
+	GLint  location = -1;
+
+	Uniform(GLuint program, GLint location) :
+		program(program),
+		location(location)
+	{}
+};
+
+struct Uniform_info
+{
+	GLint  location;
+	GLenum type;
+	GLint  array_size;
+};
+
+struct Uniform_block_info
+{
+	GLuint index;
+	GLint  data_size;
+	GLint  binding;
+
+	std::unordered_map<std::string, GLint> member_offsets;
+};
+
+// Active uniforms and uniform blocks of a linked program
+struct Shader_reflection
+{
+	std::unordered_map<std::string, Uniform_info>		uniforms;
+	std::unordered_map<std::string, Uniform_block_info> blocks;
+
+	static Shader_reflection reflect(GLuint program);
+};
+
+// Driver-specific serialized form of a linked program
+struct Program_binary
+{
+	GLenum			  format = 0;
+	std::vector<char> data;
+};
+
+struct Shader_stage
+{
+	GLenum		type;
+	std::string source;
+};
+
 class Shader
 {
   public:
 	static Result<Shader, std::string> create_shader(const std::string& vert_src,
 													 const std::string& frag_src);
 
-	GLint operator[](const char* uniform_name) { return glGetUniformLocation(*ptr, uniform_name); }
+	// Compile and link a program from an arbitrary set of stages
+	static Result<Shader, std::string> create_program(const std::vector<Shader_stage>& stages);
+
+	// Recreate a program from a binary, fails if the driver no longer accepts it
+	static Result<Shader, std::string> create_from_binary(const Program_binary& binary);
+
+	[[nodiscard]] std::optional<Program_binary> get_binary() const;
 
-	Shader(const Shader&) = default;
-	Shader(Shader&&)	  = default;
+	// Location of a default-block uniform, -1 if inactive
+	GLint operator[](const char* uniform_name) const
+	{
+		auto find = reflection->uniforms.find(uniform_name);
+		return find == reflection->uniforms.end() ? -1 : find->second.location;
+	}
+
+	// Get a typed handle of a uniform, returns an invalid handle if inactive or mistyped
+	template <typename T> [[nodiscard]] Uniform<T> uniform(const std::string& name) const
+	{
+		auto find = reflection->uniforms.find(name);
+		if (find == reflection->uniforms.end()) return {};
+
+		if (!Uniform_type<T>::match(find->second.type))
+		{
+			logger.log(Logger::Warning,
+					   "Uniform \"{}\" has GL type 0x{:x}, which mismatches the handle type",
+					   name,
+					   find->second.type);
+			return {};
+		}
+
+		return {*ptr, find->second.location};
+	}
+
+	[[nodiscard]] const Uniform_block_info* uniform_block(const std::string& name) const
+	{
+		auto find = reflection->blocks.find(name);
+		return find == reflection->blocks.end() ? nullptr : &find->second;
+	}
+
+	[[nodiscard]] const Shader_reflection& get_reflection() const { return *reflection; }
+
+	Shader(const Shader&)			 = default;
+	Shader(Shader&&)				 = default;
+	Shader& operator=(const Shader&) = default;
+	Shader& operator=(Shader&&)		 = default;
 
 	~Shader()
 	{
-		if (ptr.use_count() == 1) glDeleteShader(*ptr);
+		if (ptr.use_count() == 1) glDeleteProgram(*ptr);
 	}
 
 	void use() const { glUseProgram(*ptr); }
 
   private:
-	std::shared_ptr<GLuint> ptr;
+	std::shared_ptr<GLuint>					 ptr;
+	std::shared_ptr<const Shader_reflection> reflection;
 
 	Shader(GLuint shader) :
-		ptr(new GLuint(shader))
+		ptr(new GLuint(shader)),
+		reflection(std::make_shared<const Shader_reflection>(Shader_reflection::reflect(shader)))
 	{}
-};
\ No newline at end of file
+};
+
+class Program_cache;
+
+// Lazily compiled variants of one shader template, specialised with injected #defines.
+// Each distinct set of defines is compiled once, on first use, and kept for the lifetime of the cache.
+class Shader_variant_cache
+{
+  public:
+	using Defines = std::vector<std::pair<std::string, std::string>>;
+
+	Shader_variant_cache(std::vector<Shader_stage> stages, Program_cache* program_cache = nullptr) :
+		stages(std::move(stages)),
+		program_cache(program_cache)
+	{}
+
+	Result<Shader, std::string> get(const Defines& defines);
+
+	// Insert `#define`s right after the #version directive of `source`
+	static std::string inject_defines(const std::string& source, const Defines& defines);
+
+  private:
+	std::vector<Shader_stage>				stages;
+	Program_cache*							program_cache;
+	std::unordered_map<std::string, Shader> variants;
+};
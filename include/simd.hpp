@@ -0,0 +1,220 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+DESCRIPTION:
+Minimal 4-wide double precision SIMD pack used by the CPU kernels.
+Uses AVX intrinsics when the translation unit is compiled with AVX, otherwise a plain array
+the compiler is free to vectorize.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace simd
+{
+inline constexpr int width = 4;
+
+#if defined(__AVX__)
+
+inline constexpr bool hardware = true;
+
+struct Mask
+{
+	__m256d v;
+
+	friend Mask operator|(Mask a, Mask b) { return {_mm256_or_pd(a.v, b.v)}; }
+	friend Mask operator&(Mask a, Mask b) { return {_mm256_and_pd(a.v, b.v)}; }
+
+	// Lane i is set in bit i
+	[[nodiscard]] int bits() const { return _mm256_movemask_pd(v); }
+	[[nodiscard]] bool any() const { return !_mm256_testz_pd(v, v); }
+};
+
+struct Pack
+{
+	__m256d v;
+
+	static Pack broadcast(double x) { return {_mm256_set1_pd(x)}; }
+	static Pack load(const double* p) { return {_mm256_load_pd(p)}; }
+	void		store(double* p) const { _mm256_store_pd(p, v); }
+
+	friend Pack operator+(Pack a, Pack b) { return {_mm256_add_pd(a.v, b.v)}; }
+	friend Pack operator-(Pack a, Pack b) { return {_mm256_sub_pd(a.v, b.v)}; }
+	friend Pack operator*(Pack a, Pack b) { return {_mm256_mul_pd(a.v, b.v)}; }
+	friend Pack operator-(Pack a) { return {_mm256_xor_pd(a.v, sign_bits())}; }
+
+	friend Pack abs(Pack a) { return {_mm256_andnot_pd(sign_bits(), a.v)}; }
+
+	// `a` negated in the lanes where `s` is negative
+	friend Pack times_sign(Pack a, Pack s)
+	{
+		return {_mm256_xor_pd(a.v, _mm256_and_pd(s.v, sign_bits()))};
+	}
+
+	friend Mask operator<(Pack a, Pack b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ)}; }
+	friend Mask operator>=(Pack a, Pack b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ)}; }
+
+  private:
+	static __m256d sign_bits() { return _mm256_set1_pd(-0.0); }
+};
+
+// Lanes of `b` where `mask` is set, lanes of `a` elsewhere
+inline Pack select(Mask mask, Pack a, Pack b)
+{
+	return {_mm256_blendv_pd(a.v, b.v, mask.v)};
+}
+
+#else
+
+inline constexpr bool hardware = false;
+
+struct Mask
+{
+	bool v[width];
+
+	friend Mask operator|(Mask a, Mask b)
+	{
+		Mask r;
+		for (int i = 0; i < width; i++) r.v[i] = a.v[i] || b.v[i];
+		return r;
+	}
+
+	friend Mask operator&(Mask a, Mask b)
+	{
+		Mask r;
+		for (int i = 0; i < width; i++) r.v[i] = a.v[i] && b.v[i];
+		return r;
+	}
+
+	[[nodiscard]] int bits() const
+	{
+		int r = 0;
+		for (int i = 0; i < width; i++) r |= (int)v[i] << i;
+		return r;
+	}
+
+	[[nodiscard]] bool any() const { return bits() != 0; }
+};
+
+struct Pack
+{
+	double v[width];
+
+	static Pack broadcast(double x)
+	{
+		Pack r;
+		for (int i = 0; i < width; i++) r.v[i] = x;
+		return r;
+	}
+
+	static Pack load(const double* p)
+	{
+		Pack r;
+		for (int i = 0; i < width; i++) r.v[i] = p[i];
+		return r;
+	}
+
+	void store(double* p) const
+	{
+		for (int i = 0; i < width; i++) p[i] = v[i];
+	}
+
+	friend Pack operator+(Pack a, Pack b)
+	{
+		Pack r;
+		for (int i = 0; i < width; i++) r.v[i] = a.v[i] + b.v[i];
+		return r;
+	}
+
+	friend Pack operator-(Pack a, Pack b)
+	{
+		Pack r;
+		for (int i = 0; i < width; i++) r.v[i] = a.v[i] - b.v[i];
+		return r;
+	}
+
+	friend Pack operator*(Pack a, Pack b)
+	{
+		Pack r;
+		for (int i = 0; i < width; i++) r.v[i] = a.v[i] * b.v[i];
+		return r;
+	}
+
+	friend Pack operator-(Pack a)
+	{
+		Pack r;
+		for (int i = 0; i < width; i++) r.v[i] = -a.v[i];
+		return r;
+	}
+
+	friend Pack abs(Pack a)
+	{
+		Pack r;
+		for (int i = 0; i < width; i++) r.v[i] = std::abs(a.v[i]);
+		return r;
+	}
+
+	friend Pack times_sign(Pack a, Pack s)
+	{
+		Pack r;
+		for (int i = 0; i < width; i++) r.v[i] = std::signbit(s.v[i]) ? -a.v[i] : a.v[i];
+		return r;
+	}
+
+	friend Mask operator<(Pack a, Pack b)
+	{
+		Mask r;
+		for (int i = 0; i < width; i++) r.v[i] = a.v[i] < b.v[i];
+		return r;
+	}
+
+	friend Mask operator>=(Pack a, Pack b)
+	{
+		Mask r;
+		for (int i = 0; i < width; i++) r.v[i] = a.v[i] >= b.v[i];
+		return r;
+	}
+};
+
+inline Pack select(Mask mask, Pack a, Pack b)
+{
+	Pack r;
+	for (int i = 0; i < width; i++) r.v[i] = mask.v[i] ? b.v[i] : a.v[i];
+	return r;
+}
+
+#endif
+
+// Storage for one pack that can be accessed lane by lane
+struct alignas(32) Lanes
+{
+	double v[width];
+
+	[[nodiscard]] Pack load() const { return Pack::load(v); }
+	void			   store(Pack p) { p.store(v); }
+
+	double&		  operator[](int i) { return v[i]; }
+	const double& operator[](int i) const { return v[i]; }
+};
+}
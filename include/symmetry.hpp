@@ -0,0 +1,55 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+DESCRIPTION:
+Real-axis symmetry of the rendered region. Formulas with f(conj z, conj c) = conj f(z, c) give
+conjugate points the same iteration value and distance estimate, so rows mirrored across the
+real axis only need to be computed once.
+*/
+
+#pragma once
+
+#include "common-include.hpp"
+#include "render-params.hpp"
+
+// Rows of a region that mirror other rows of the same region across the real axis
+struct Row_symmetry
+{
+	int mirror_sum;	 // Row y samples the conjugate of row `mirror_sum - y`
+	int first, last;  // Mirrored rows, [first, last], filled from their partner rows
+
+	[[nodiscard]] int source(int row) const { return mirror_sum - row; }
+	[[nodiscard]] int count() const { return last - first + 1; }
+};
+
+// Bands of rows, [begin, end) pairs in ascending order
+using Row_bands = std::vector<std::pair<int, int>>;
+
+// Move `center.y` by less than half a row so that the pixel centres of a `height` row region
+// of height `size_y` lie pairwise symmetric to the real axis
+glm::dvec2 snap_center_to_axis(glm::dvec2 center, double size_y, int height);
+
+// Mirrored rows of the region, none if the view does not straddle the real axis or is not
+// snapped with snap_center_to_axis()
+std::optional<Row_symmetry> find_row_symmetry(const Render_params& params, int height);
+
+// Rows of a `height` row region that have to be computed, all but the mirrored ones
+Row_bands get_computed_rows(const std::optional<Row_symmetry>& symmetry, int height);
+
+// Rows of `bands` within [begin, end)
+Row_bands clip_rows(const Row_bands& bands, int begin, int end);
@@ -68,9 +68,74 @@ class Texture2d
 					 GLenum		 data_format  = GL_UNSIGNED_BYTE,
 					 const void* data		  = nullptr) const;
 
+	// Overwrite a region of level 0 without reallocating
+	void update(int			x,
+				int			y,
+				int			width,
+				int			height,
+				GLenum		pixel_format,
+				GLenum		data_format,
+				const void* data) const;
+
 	void set_filter(GLint filter_min, GLint filter_mag) const;
 	void set_wrap(GLint wrap_s, GLint wrap_t) const;
 
+	// Bind level 0 to an image unit for load/store access from shaders
+	void bind_image(unsigned int unit, GLenum access, GLenum format) const
+	{
+		glBindImageTexture(unit, *ptr, 0, GL_FALSE, 0, access, format);
+	}
+
+	GLuint operator*() const { return *ptr; }
+
+  private:
+	std::shared_ptr<GLuint> ptr;
+};
+
+// Array of equally sized 2D layers, sampled and stored to as a whole
+class Texture2d_array
+{
+  public:
+	Texture2d_array(const Texture2d_array&) = delete;
+	Texture2d_array(Texture2d_array&&)		= default;
+	Texture2d_array();
+	~Texture2d_array();
+
+	void bind() const { glBindTexture(GL_TEXTURE_2D_ARRAY, *ptr); }
+	void bind_slot(unsigned int slot) const
+	{
+		glActiveTexture(GL_TEXTURE0 + slot);
+		bind();
+	}
+
+	void stream_data(int		 width,
+					 int		 height,
+					 int		 layers,
+					 GLint		 internal_format,
+					 GLenum		 pixel_format = GL_RGB,
+					 GLenum		 data_format  = GL_UNSIGNED_BYTE,
+					 const void* data		  = nullptr) const;
+
+	// Overwrite a region of `layers` layers from `layer` on, of level 0 without reallocating
+	void update(int			x,
+				int			y,
+				int			layer,
+				int			width,
+				int			height,
+				int			layers,
+				GLenum		pixel_format,
+				GLenum		data_format,
+				const void* data) const;
+
+	void set_filter(GLint filter_min, GLint filter_mag) const;
+	void set_wrap(GLint wrap_s, GLint wrap_t) const;
+
+	// Bind every layer of level 0 to an image unit for load/store access from shaders
+	void bind_image(unsigned int unit, GLenum access, GLenum format) const
+	{
+		glBindImageTexture(unit, *ptr, 0, GL_TRUE, 0, access, format);
+	}
+
 	GLuint operator*() const { return *ptr; }
 
   private:
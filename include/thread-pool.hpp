@@ -0,0 +1,62 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running one batch of indexed tasks at a time.
+// Tasks are pulled from a shared counter, so uneven tasks balance themselves across workers.
+class Thread_pool
+{
+  public:
+	// `thread_count` of 0 uses one worker per hardware thread
+	Thread_pool(unsigned int thread_count = 0);
+	~Thread_pool();
+
+	Thread_pool(const Thread_pool&) = delete;
+	Thread_pool(Thread_pool&&)		= delete;
+
+	// Run task(index, worker) for every index in [0, task_count), returns once all are done.
+	// The calling thread takes part as the last worker.
+	void run(size_t task_count, const std::function<void(size_t task, unsigned int worker)>& task);
+
+	[[nodiscard]] unsigned int get_worker_count() const { return (unsigned int)threads.size() + 1; }
+
+  private:
+	std::vector<std::thread> threads;
+
+	std::mutex				mutex;
+	std::condition_variable start_signal, done_signal;
+
+	const std::function<void(size_t, unsigned int)>* current_task = nullptr;
+
+	size_t				task_count = 0;
+	std::atomic<size_t> next_task  = 0;
+	uint64_t			generation = 0;
+	unsigned int		busy	   = 0;
+	bool				stopping   = false;
+
+	void worker_loop(unsigned int worker);
+	void drain(unsigned int worker);
+};
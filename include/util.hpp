@@ -26,6 +26,7 @@ Provides Result and Logger class
 #include <chrono>
 #include <ctime>
 #include <iomanip>
+#include <mutex>
 
 // Result class representing either a value or an error
 template <typename Val_T, typename Err_T> struct Result
@@ -102,9 +103,11 @@ class Logger
 		log(level, formatted_string);
 	}
 
-	// Log a string
+	// Log a string, safe to call from any thread
 	void log(Log_level level, const std::string& str)
 	{
+		std::lock_guard lock(mutex);
+
 		if (target & Console)
 			std::cout << get_current_time_str() << "  " << log_level_color_start(level)
 					  << log_level_string(level) << str << log_level_color_end()
@@ -117,6 +120,7 @@ class Logger
 
   private:
 	std::ofstream file_stream;
+	std::mutex	  mutex;
 
 	std::chrono::time_point<std::chrono::steady_clock> start_time
 		= std::chrono::steady_clock::now();
@@ -29,7 +29,7 @@ void App::init()
 		init_window();
 		init_imgui();
 
-		logic			   = new Logic_handler(util::get_gui_scale(window));
+		logic			   = new Logic_handler(window, util::get_gui_scale(window));
 		init_success.logic = true;
 	}
 	catch (std::exception e)
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "buffer.hpp"
+
+Buffer::Buffer()
+{
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	ptr = std::make_shared<GLuint>(buffer);
+}
+
+Buffer::~Buffer()
+{
+	if (ptr.use_count() == 1) glDeleteBuffers(1, ptr.get());
+}
+
+void Buffer::stream_data(GLsizeiptr size, GLenum usage, const void* data) const
+{
+	bind(GL_COPY_WRITE_BUFFER);
+	glBufferData(GL_COPY_WRITE_BUFFER, size, data, usage);
+}
+
+void Buffer::update(GLintptr offset, GLsizeiptr size, const void* data) const
+{
+	bind(GL_COPY_WRITE_BUFFER);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+}
+
+void* Buffer::map_storage(GLsizeiptr size, GLbitfield access) const
+{
+	const GLbitfield flags = access | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	bind(GL_COPY_WRITE_BUFFER);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+	return glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+}
@@ -0,0 +1,626 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "cpu-kernel.hpp"
+#include "formula.hpp"
+#include "interval.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+// Same constants as kernel.glsl for PRECISION_FP64
+constexpr double periodicity_epsilon = 1e-24;
+constexpr int	 first_snapshot		 = 16;
+
+double escape_radius2(Kernel_coloring coloring)
+{
+	return coloring == Kernel_coloring::Iteration ? 4.0 : 65536.0;
+}
+
+bool uses_derivative(const Kernel_variant& variant)
+{
+	return variant.derivative || variant.coloring == Kernel_coloring::Distance;
+}
+
+// orbit_output() of kernel.glsl for an escaped orbit, evaluated in float like the shader
+glm::vec2 escaped_output(Kernel_coloring coloring,
+						 int			 power,
+						 int			 iter,
+						 double			 zx,
+						 double			 zy,
+						 double			 dzx,
+						 double			 dzy,
+						 bool			 derivative,
+						 float			 pixel_size)
+{
+	const float z_abs = (float)std::sqrt(zx * zx + zy * zy);
+
+	const float value = coloring == Kernel_coloring::Iteration
+						  ? (float)(iter - 1)
+						  : (float)iter - std::log2(std::log(z_abs)) / std::log2((float)power);
+
+	const float estimate
+		= derivative ? z_abs * std::log(z_abs) / (float)std::sqrt(dzx * dzx + dzy * dzy) / pixel_size
+					 : 0.0f;
+
+	return {value, estimate};
+}
+
+// Exterior distance estimate in units of the plane, |z| log|z| / |dz|
+double point_distance(double zx, double zy, double dzx, double dzy)
+{
+	const double z_abs = std::sqrt(zx * zx + zy * zy);
+	return z_abs * std::log(z_abs) / std::sqrt(dzx * dzx + dzy * dzy);
+}
+
+// One orbit step of a single point, the same operations as the SIMD kernel
+template <typename Formula>
+void scalar_step(double& zx, double& zy, double& dzx, double& dzy, double cx, double cy, bool derivative)
+{
+	if (derivative)
+	{
+		Formula::derivative(zx, zy, dzx, dzy);
+		dzx += 1.0;
+	}
+
+	Formula::step(zx, zy, cx, cy);
+}
+
+// Call `function.template operator()<Formula, Derivative, Periodicity, Interval>()` with the
+// specialisation of the kernel for `variant`
+template <typename Function>
+Lane_stats dispatch_kernel(const Kernel_variant& variant, bool derivative, Function&& function)
+{
+	return formulas::dispatch(
+		variant.formula,
+		[&]<typename Formula>()
+		{
+			const auto specialise = [&]<bool Derivative, bool Periodicity>()
+			{
+				switch (variant.bailout_interval)
+				{
+				case 4:
+					return function.template operator()<Formula, Derivative, Periodicity, 4>();
+				case 8:
+					return function.template operator()<Formula, Derivative, Periodicity, 8>();
+				case 16:
+					return function.template operator()<Formula, Derivative, Periodicity, 16>();
+				default:
+					return function.template operator()<Formula, Derivative, Periodicity, 1>();
+				}
+			};
+
+			if (derivative)
+				return variant.periodicity ? specialise.template operator()<true, true>()
+										   : specialise.template operator()<true, false>();
+			else
+				return variant.periodicity ? specialise.template operator()<false, true>()
+										   : specialise.template operator()<false, false>();
+		});
+}
+
+// Lane-refilling SIMD loop shared by tiles and point lists. `next(cx, cy)` stores the next
+// pending point and returns its index, or -1 once there is none; `finish(index, escaped, iter,
+// zx, zy, dzx, dzy)` receives the final state of every orbit.
+template <typename Formula, bool Derivative, bool Periodicity, int Interval, typename Next, typename Finish>
+Lane_stats iterate_lanes(double radius2, int max_iter, Next&& next, Finish&& finish)
+{
+	using simd::Lanes;
+	using simd::Pack;
+
+	constexpr double idle	   = std::numeric_limits<double>::infinity();
+	constexpr int	 all_lanes = (1 << simd::width) - 1;
+
+	Lanes	zx, zy, dzx, dzy, cx, cy, iter, limit, snapshot_x, snapshot_y, next_snapshot;
+	int64_t lane_index[simd::width];
+
+	// Lane state at the start of the last unchecked block, see below
+	Lanes checkpoint_zx, checkpoint_zy, checkpoint_dzx, checkpoint_dzy, checkpoint_iter;
+
+	int active_lanes = 0;
+
+	// Start the next pending point in `lane`, or park the lane if there is none.
+	// A parked lane iterates c = 0 forever, it never escapes nor reaches its limit.
+	const auto refill = [&](int lane)
+	{
+		zx[lane] = zy[lane] = dzx[lane] = dzy[lane] = iter[lane] = 0.0;
+
+		lane_index[lane] = next(cx[lane], cy[lane]);
+
+		if (lane_index[lane] < 0)
+		{
+			cx[lane] = cy[lane] = 0.0;
+			limit[lane] = snapshot_x[lane] = snapshot_y[lane] = next_snapshot[lane] = idle;
+			return;
+		}
+
+		limit[lane]		 = max_iter;
+		snapshot_x[lane] = snapshot_y[lane] = 0.0;
+		next_snapshot[lane]					= first_snapshot;
+
+		active_lanes++;
+	};
+
+	for (int lane = 0; lane < simd::width; lane++) refill(lane);
+
+	const Pack one = Pack::broadcast(1.0), two = Pack::broadcast(2.0),
+			   radius2_pack = Pack::broadcast(radius2), epsilon = Pack::broadcast(periodicity_epsilon),
+			   interval = Pack::broadcast(Interval);
+
+	Lane_stats stats;
+
+	while (active_lanes > 0)
+	{
+		Pack z_x = zx.load(), z_y = zy.load(), dz_x = dzx.load(), dz_y = dzy.load(),
+			 c_x = cx.load(), c_y = cy.load(), n = iter.load(), lim = limit.load(),
+			 s_x = snapshot_x.load(), s_y = snapshot_y.load(), next_s = next_snapshot.load();
+
+		uint64_t steps	  = 0;
+		int		 finished = 0;
+		int		 replay	  = 0;	// lanes that escaped somewhere inside the last block
+
+		const auto step = [&]
+		{
+			if constexpr (Derivative)
+			{
+				Formula::derivative(z_x, z_y, dz_x, dz_y);
+				dz_x = dz_x + one;
+			}
+
+			Formula::step(z_x, z_y, c_x, c_y);
+			n = n + one;
+		};
+
+		// Brent step of every lane, returns the lanes found periodic
+		const auto check_periodicity = [&]
+		{
+			const Pack d_x = z_x - s_x, d_y = z_y - s_y;
+			const auto periodic = d_x * d_x + d_y * d_y < epsilon;
+
+			const auto take = n >= next_s;
+			s_x				= simd::select(take, s_x, z_x);
+			s_y				= simd::select(take, s_y, z_y);
+			next_s			= simd::select(take, next_s, next_s * two);
+
+			return periodic;
+		};
+
+		// Iterate all lanes in lockstep until at least one of them finishes
+		while (true)
+		{
+			// Unchecked block, only when no lane can pass its limit inside it. A lane that
+			// escaped inside the block is either outside the radius or NaN at its end, and both
+			// fail `norm < radius`; it is replayed from the checkpoint below for the exact result.
+			// A lane that ends the block on its limit is finished like after a single step.
+			if (Interval > 1 && !(lim < n + interval).any())
+			{
+				checkpoint_zx.store(z_x);
+				checkpoint_zy.store(z_y);
+				checkpoint_dzx.store(dz_x);
+				checkpoint_dzy.store(dz_y);
+				checkpoint_iter.store(n);
+
+				for (int i = 0; i < Interval; i++) step();
+				steps += Interval;
+
+				replay = all_lanes & ~(z_x * z_x + z_y * z_y < radius2_pack).bits();
+
+				if constexpr (Periodicity) finished = check_periodicity().bits() & ~replay;
+
+				finished |= replay | (n >= lim).bits();
+				if (finished != 0) break;
+
+				continue;
+			}
+
+			step();
+			steps++;
+
+			auto done = (z_x * z_x + z_y * z_y >= radius2_pack) | (n >= lim);
+			if constexpr (Periodicity) done = done | check_periodicity();
+
+			if (done.any())
+			{
+				finished = done.bits();
+				break;
+			}
+		}
+
+		stats.total_lane_steps += steps * simd::width;
+		stats.active_lane_steps += steps * active_lanes;
+
+		zx.store(z_x);
+		zy.store(z_y);
+		dzx.store(dz_x);
+		dzy.store(dz_y);
+		iter.store(n);
+		snapshot_x.store(s_x);
+		snapshot_y.store(s_y);
+		next_snapshot.store(next_s);
+
+		for (int lane = 0; lane < simd::width; lane++)
+		{
+			if ((finished & (1 << lane)) == 0) continue;
+
+			if (replay & (1 << lane))
+			{
+				zx[lane]   = checkpoint_zx[lane];
+				zy[lane]   = checkpoint_zy[lane];
+				dzx[lane]  = checkpoint_dzx[lane];
+				dzy[lane]  = checkpoint_dzy[lane];
+				iter[lane] = checkpoint_iter[lane];
+
+				// Bounded by the block. This file is built without FMA contraction, so the scalar
+				// steps round exactly like the packed ones and the replay repeats the block.
+				const double end = std::min(checkpoint_iter[lane] + Interval, (double)max_iter);
+				do {
+					scalar_step<Formula>(zx[lane], zy[lane], dzx[lane], dzy[lane], cx[lane], cy[lane], Derivative);
+					iter[lane]++;
+				} while (zx[lane] * zx[lane] + zy[lane] * zy[lane] < radius2 && iter[lane] < end);
+
+				// Steps the lane spent past its escape inside the block did no useful work
+				stats.active_lane_steps -= (uint64_t)(checkpoint_iter[lane] + Interval - iter[lane]);
+
+				// A replay that didn't escape leaves a valid orbit state, the lane resumes from it
+				if (zx[lane] * zx[lane] + zy[lane] * zy[lane] < radius2 && iter[lane] < max_iter) continue;
+			}
+
+			const bool escaped = zx[lane] * zx[lane] + zy[lane] * zy[lane] >= radius2;
+
+			finish(lane_index[lane], escaped, (int)iter[lane], zx[lane], zy[lane], dzx[lane], dzy[lane]);
+
+			active_lanes--;
+			refill(lane);
+		}
+	}
+
+	return stats;
+}
+
+template <typename Formula, bool Derivative, bool Periodicity, int Interval>
+Lane_stats render_tile(const Render_params& params,
+					   Kernel_coloring		coloring,
+					   const Cpu_tile&		tile,
+					   glm::vec2*			output,
+					   int					region_width,
+					   int					region_height,
+					   const uint8_t*		skip)
+{
+	const float pixel_size	= (float)params.size.x / (float)region_width;
+	const int	pixel_count = tile.width * tile.height;
+
+	int next_pixel = 0;
+
+	const auto next = [&](double& cx, double& cy) -> int64_t
+	{
+		if (skip != nullptr)
+			while (next_pixel < pixel_count && skip[next_pixel] != 0) next_pixel++;
+
+		if (next_pixel >= pixel_count) return -1;
+
+		const int x = tile.x + next_pixel % tile.width, y = tile.y + next_pixel / tile.width;
+		const auto c = pixel_to_complex(params, x, y, region_width, region_height);
+
+		cx = c.x;
+		cy = c.y;
+		next_pixel++;
+
+		return (int64_t)y * region_width + x;
+	};
+
+	const auto finish
+		= [&](int64_t index, bool escaped, int iter, double zx, double zy, double dzx, double dzy)
+	{
+		output[index] = escaped
+						  ? escaped_output(coloring, Formula::power, iter, zx, zy, dzx, dzy, Derivative, pixel_size)
+						  : glm::vec2(-1.0f, 0.0f);
+	};
+
+	return iterate_lanes<Formula, Derivative, Periodicity, Interval>(
+		escape_radius2(coloring), params.max_iter, next, finish);
+}
+
+template <typename Formula, bool Derivative, bool Periodicity, int Interval>
+Lane_stats evaluate_points(Kernel_coloring		coloring,
+						   int					max_iter,
+						   const double*		x,
+						   const double*		y,
+						   size_t				count,
+						   const Point_results& results)
+{
+	size_t next_point = 0;
+
+	const auto next = [&](double& cx, double& cy) -> int64_t
+	{
+		if (next_point >= count) return -1;
+
+		cx = x[next_point];
+		cy = y[next_point];
+
+		return (int64_t)next_point++;
+	};
+
+	const auto finish
+		= [&](int64_t index, bool escaped, int iter, double zx, double zy, double dzx, double dzy)
+	{
+		if (results.iterations != nullptr) results.iterations[index] = escaped ? iter : -1;
+		if (results.z_x != nullptr) results.z_x[index] = zx;
+		if (results.z_y != nullptr) results.z_y[index] = zy;
+		if (results.distance != nullptr)
+			results.distance[index] = escaped ? point_distance(zx, zy, dzx, dzy) : 0.0;
+	};
+
+	return iterate_lanes<Formula, Derivative, Periodicity, Interval>(
+		escape_radius2(coloring), max_iter, next, finish);
+}
+}
+
+glm::dvec2 pixel_offset(const Render_params& params,
+						int					 x,
+						int					 y,
+						int					 region_width,
+						int					 region_height)
+{
+	// Same float precision NDC as generator.comp, so both backends sample identical points
+	const glm::vec2 ndc
+		= (glm::vec2(x, y) + 0.5f) / glm::vec2(region_width, region_height) * 2.0f - 1.0f;
+
+	return glm::dvec2(ndc) * params.size / 2.0;
+}
+
+glm::dvec2 pixel_to_complex(const Render_params& params,
+							int					 x,
+							int					 y,
+							int					 region_width,
+							int					 region_height)
+{
+	return pixel_offset(params, x, y, region_width, region_height) + params.center;
+}
+
+Lane_stats cpu_render_tile(const Render_params&	 params,
+						   const Kernel_variant& variant,
+						   const Cpu_tile&		 tile,
+						   glm::vec2*			 output,
+						   int					 region_width,
+						   int					 region_height,
+						   const uint8_t*		 skip)
+{
+	return dispatch_kernel(
+		variant,
+		uses_derivative(variant),
+		[&]<typename Formula, bool Derivative, bool Periodicity, int Interval>()
+		{
+			return render_tile<Formula, Derivative, Periodicity, Interval>(
+				params, variant.coloring, tile, output, region_width, region_height, skip);
+		});
+}
+
+Lane_stats cpu_evaluate_points(const Kernel_variant& variant,
+							   int					 max_iter,
+							   const double*		 x,
+							   const double*		 y,
+							   size_t				 count,
+							   const Point_results&	 results)
+{
+	return dispatch_kernel(
+		variant,
+		uses_derivative(variant) || results.distance != nullptr,
+		[&]<typename Formula, bool Derivative, bool Periodicity, int Interval>()
+		{
+			return evaluate_points<Formula, Derivative, Periodicity, Interval>(
+				variant.coloring, max_iter, x, y, count, results);
+		});
+}
+
+Lane_stats cpu_render_tile_perturbed(const Render_params&	 params,
+									 const Kernel_variant&	 variant,
+									 const Reference_orbit& orbit,
+									 glm::dvec2				 reference_offset,
+									 const Cpu_tile&		 tile,
+									 glm::vec2*				 output,
+									 int					 region_width,
+									 int					 region_height,
+									 const uint8_t*			 skip)
+{
+	const bool	 derivative = uses_derivative(variant);
+	const double radius2	= escape_radius2(variant.coloring);
+	const int	 length		= orbit.get_length();
+
+	// The derivative is scaled by the pixel size, which underflows float in deep views
+	const double pixel_size = params.size.x / region_width;
+
+	Reference_orbit::Cursor reference(orbit);
+	Lane_stats				stats;
+
+	for (int i = 0; i < tile.width * tile.height; i++)
+	{
+		if (skip != nullptr && skip[i] != 0) continue;
+
+		const int x = tile.x + i % tile.width, y = tile.y + i / tile.width;
+		const auto dc = pixel_offset(params, x, y, region_width, region_height) + reference_offset;
+
+		// z = Z_n + d, with d the offset of the pixel from the reference
+		double	   dx = 0, dy = 0, dzx = 0, dzy = 0;
+		glm::dvec2 z_ref(0.0);
+		int		   n = 0, iter = 0;
+		bool	   escaped = false;
+
+		while (iter < params.max_iter)
+		{
+			if (derivative)
+			{
+				const double zx = z_ref.x + dx, zy = z_ref.y + dy;
+				const double new_dzx = 2.0 * (zx * dzx - zy * dzy) + pixel_size;
+				dzy					 = 2.0 * (zx * dzy + zy * dzx);
+				dzx					 = new_dzx;
+			}
+
+			// d' = (2 Z + d) d + dc
+			const double tx = 2.0 * z_ref.x + dx, ty = 2.0 * z_ref.y + dy;
+			const double new_dx = tx * dx - ty * dy + dc.x;
+			dy					= tx * dy + ty * dx + dc.y;
+			dx					= new_dx;
+
+			n++;
+			iter++;
+			z_ref = reference[n];
+
+			const double zx = z_ref.x + dx, zy = z_ref.y + dy, norm2 = zx * zx + zy * zy;
+
+			if (norm2 >= radius2)
+			{
+				output[(ptrdiff_t)y * region_width + x]
+					= escaped_output(variant.coloring, 2, iter, zx, zy, dzx, dzy, derivative, 1.0f);
+				escaped = true;
+				break;
+			}
+
+			if (norm2 < dx * dx + dy * dy || n == length)
+			{
+				dx	  = zx;
+				dy	  = zy;
+				z_ref = glm::dvec2(0.0);
+				n	  = 0;
+				stats.rebases++;
+			}
+		}
+
+		if (!escaped) output[(ptrdiff_t)y * region_width + x] = {-1.0f, 0.0f};
+
+		stats.active_lane_steps += iter;
+		stats.total_lane_steps += iter;
+	}
+
+	return stats;
+}
+
+glm::vec2 cpu_evaluate(const Render_params&	 params,
+					   const Kernel_variant& variant,
+					   glm::dvec2			 c,
+					   float				 pixel_size)
+{
+	return formulas::dispatch(
+		variant.formula,
+		[&]<typename Formula>() -> glm::vec2
+		{
+			const bool	 derivative = uses_derivative(variant);
+			const double radius2	= escape_radius2(variant.coloring);
+
+			double zx = 0, zy = 0, dzx = 0, dzy = 0, snapshot_x = 0, snapshot_y = 0;
+			int	   iter = 0, next_snapshot = first_snapshot;
+
+			while (iter < params.max_iter)
+			{
+				scalar_step<Formula>(zx, zy, dzx, dzy, c.x, c.y, derivative);
+				iter++;
+
+				if (zx * zx + zy * zy >= radius2)
+					return escaped_output(
+						variant.coloring, Formula::power, iter, zx, zy, dzx, dzy, derivative, pixel_size);
+
+				if (variant.periodicity)
+				{
+					const double diff_x = zx - snapshot_x, diff_y = zy - snapshot_y;
+					if (diff_x * diff_x + diff_y * diff_y < periodicity_epsilon) break;
+
+					if (iter >= next_snapshot)
+					{
+						snapshot_x = zx;
+						snapshot_y = zy;
+						next_snapshot *= 2;
+					}
+				}
+			}
+
+			return {-1.0f, 0.0f};
+		});
+}
+
+Tile_certificate cpu_certify_tile(const Render_params&	params,
+								  const Kernel_variant& variant,
+								  const Cpu_tile&		tile,
+								  int					region_width,
+								  int					region_height)
+{
+	// pixel_to_complex() is monotonic, so the corner pixels bound every sampled c
+	const auto c_min = pixel_to_complex(params, tile.x, tile.y, region_width, region_height),
+			   c_max = pixel_to_complex(params,
+										tile.x + tile.width - 1,
+										tile.y + tile.height - 1,
+										region_width,
+										region_height);
+
+	const Complex_interval c{Interval::hull(c_min.x, c_max.x), Interval::hull(c_min.y, c_max.y)};
+
+	const double radius2	  = escape_radius2(variant.coloring);
+	const bool	 prove_escape = variant.coloring == Kernel_coloring::Iteration && !uses_derivative(variant);
+
+	// Formula steps are built from inclusion-monotone operations, the iterate of a rectangle
+	// encloses the iterates of every point in it
+	return formulas::dispatch(
+		variant.formula,
+		[&]<typename Formula>() -> Tile_certificate
+		{
+			Complex_interval z{Interval::point(0), Interval::point(0)};
+			Complex_interval snapshot	   = z;
+			int				 next_snapshot = 1;
+
+			for (int iter = 1; iter <= params.max_iter; iter++)
+			{
+				Formula::step(z.x, z.y, c.x, c.y);
+
+				const auto norm2 = z.norm2();
+
+				if (norm2.lo >= radius2)
+				{
+					if (!prove_escape) return {Tile_certificate::Unknown, iter};
+					return {Tile_certificate::Escaped, iter};
+				}
+
+				// Straddles the radius, or blew up to inf/NaN
+				if (!(norm2.hi < radius2)) return {Tile_certificate::Unknown, iter};
+
+				if (snapshot.contains(z)) return {Tile_certificate::Interior, iter};
+
+				if (iter >= next_snapshot)
+				{
+					snapshot = z;
+					next_snapshot *= 2;
+				}
+			}
+
+			// Every pixel runs into the iteration limit
+			return {Tile_certificate::Interior, params.max_iter};
+		});
+}
+
+void cpu_fill_tile(const Tile_certificate& certificate,
+				   const Cpu_tile&		   tile,
+				   glm::vec2*			   output,
+				   int					   region_width)
+{
+	const glm::vec2 value = certificate.kind == Tile_certificate::Interior
+							  ? glm::vec2(-1.0f, 0.0f)
+							  : glm::vec2((float)(certificate.iter - 1), 0.0f);
+
+	for (int y = tile.y; y < tile.y + tile.height; y++)
+		std::fill_n(output + (ptrdiff_t)y * region_width + tile.x, tile.width, value);
+}
@@ -0,0 +1,465 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "cpu-renderer.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <span>
+
+Cpu_renderer::Cpu_renderer(unsigned int thread_count) :
+	pool(thread_count),
+	worker_stats(pool.get_worker_count())
+{
+}
+
+bool Cpu_renderer::render(const Render_params&	 params,
+						  const Kernel_variant&	 variant,
+						  int					 width,
+						  int					 height,
+						  std::vector<glm::vec2>& output,
+						  std::stop_token		 stop)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	output.resize((size_t)width * height);
+
+	const auto symmetry = use_symmetry && Kernel_variant::is_conjugate_symmetric(variant.formula)
+							? find_row_symmetry(params, height)
+							: std::nullopt;
+
+	if (!render_rows(params, variant, width, height, get_computed_rows(symmetry, height), output, stop))
+		return false;
+
+	if (symmetry.has_value())
+		for (int y = symmetry->first; y <= symmetry->last; y++)
+		{
+			const auto source = output.begin() + (ptrdiff_t)symmetry->source(y) * width;
+			std::copy(source, source + width, output.begin() + (ptrdiff_t)y * width);
+		}
+
+	stats.mirrored_rows = symmetry.has_value() ? symmetry->count() : 0;
+	stats.pixel_count	= (uint64_t)width * height;
+	stats.time_ms
+		= std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	return true;
+}
+
+bool Cpu_renderer::render_rows(const Render_params&	 params,
+							   const Kernel_variant&	 variant,
+							   int					 width,
+							   int					 height,
+							   const Row_bands&		 rows,
+							   std::vector<glm::vec2>& output,
+							   std::stop_token		 stop)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	if (perturbation && Kernel_variant::supports_perturbation(variant.formula))
+	{
+		if (!prepare_reference(params, variant, width, stop)) return false;
+	}
+	else
+		reference.reset();
+
+	const float reference_ms
+		= std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	tiles.clear();
+	uint64_t pixel_count = 0;
+	for (const auto& [begin, end] : rows)
+	{
+		for (int y = begin; y < end; y += tile_size)
+			for (int x = 0; x < width; x += tile_size)
+				tiles.push_back({x, y, std::min(tile_size, width - x), std::min(tile_size, end - y)});
+		pixel_count += (uint64_t)width * (end - begin);
+	}
+
+	std::fill(worker_stats.begin(), worker_stats.end(), Worker_stats());
+
+	pool.run(tiles.size(),
+			 [&](size_t index, unsigned int worker)
+			 {
+				 if (stop.stop_requested()) return;
+				 render_tile(
+					 params, variant, tiles[index], output.data(), width, height, worker_stats[worker]);
+			 });
+
+	if (stop.stop_requested()) return false;
+
+	gather_stats(pixel_count);
+
+	if (reference != nullptr)
+	{
+		stats.reference			 = reference->get_stats();
+		stats.nucleus			 = nucleus;
+		stats.reference_ms		 = reference_ms;
+		stats.reference_distance = glm::length(reference_offset) / (params.size.x / width);
+	}
+
+	stats.time_ms
+		= std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	return true;
+}
+
+bool Cpu_renderer::render_batch(std::span<const Render_params> views,
+								const Kernel_variant&		   variant,
+								int							   width,
+								int							   height,
+								std::vector<glm::vec2>&		   output,
+								std::stop_token				   stop)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	reference.reset();
+
+	const size_t view_pixels = (size_t)width * height;
+	output.resize(view_pixels * views.size());
+
+	// Tiles of every view in one list, `tile_views` holds the view of each
+	tiles.clear();
+	std::vector<int> tile_views;
+	for (int view = 0; view < (int)views.size(); view++)
+		for (int y = 0; y < height; y += tile_size)
+			for (int x = 0; x < width; x += tile_size)
+			{
+				tiles.push_back({x, y, std::min(tile_size, width - x), std::min(tile_size, height - y)});
+				tile_views.push_back(view);
+			}
+
+	std::fill(worker_stats.begin(), worker_stats.end(), Worker_stats());
+
+	pool.run(tiles.size(),
+			 [&](size_t index, unsigned int worker)
+			 {
+				 if (stop.stop_requested()) return;
+
+				 const int view = tile_views[index];
+				 render_tile(views[view],
+							 variant,
+							 tiles[index],
+							 output.data() + view * view_pixels,
+							 width,
+							 height,
+							 worker_stats[worker]);
+			 });
+
+	if (stop.stop_requested()) return false;
+
+	gather_stats(view_pixels * views.size());
+	stats.time_ms
+		= std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	return true;
+}
+
+bool Cpu_renderer::evaluate_points(const Kernel_variant& variant,
+								   int					 max_iter,
+								   const double*		 x,
+								   const double*		 y,
+								   size_t				 count,
+								   const Point_results&	 results,
+								   std::stop_token		 stop)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	tiles.clear();
+	std::fill(worker_stats.begin(), worker_stats.end(), Worker_stats());
+
+	pool.run((count + point_block_size - 1) / point_block_size,
+			 [&](size_t index, unsigned int worker)
+			 {
+				 if (stop.stop_requested()) return;
+
+				 const size_t first = index * point_block_size;
+				 worker_stats[worker].lanes += cpu_evaluate_points(variant,
+																   max_iter,
+																   x + first,
+																   y + first,
+																   std::min(point_block_size, count - first),
+																   results.offset(first));
+			 });
+
+	if (stop.stop_requested()) return false;
+
+	gather_stats(count);
+	stats.time_ms
+		= std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	return true;
+}
+
+void Cpu_renderer::gather_stats(uint64_t pixel_count)
+{
+	stats			  = {};
+	stats.tile_count  = (int)tiles.size();
+	stats.pixel_count = pixel_count;
+	for (const auto& worker : worker_stats)
+	{
+		stats.lanes += worker.lanes;
+		stats.certified_interior_pixels += worker.certified_interior_pixels;
+		stats.certified_escaped_pixels += worker.certified_escaped_pixels;
+		stats.limited_tiles += worker.limited_tiles;
+	}
+}
+
+void Cpu_renderer::render_tile(const Render_params&	 params,
+							   const Kernel_variant& variant,
+							   const Cpu_tile&		 tile,
+							   glm::vec2*			 output,
+							   int					 width,
+							   int					 height,
+							   Worker_stats&		 worker)
+{
+	const bool certify = certify_tiles && reference == nullptr;
+
+	if (!certify && !adaptive_limits)
+	{
+		worker.lanes += evaluate_tile(params, variant, tile, output, width, height, nullptr);
+		return;
+	}
+
+	// Certified and probed pixels are skipped by the kernel, which still sees the tile as a
+	// whole, so lanes stay busy even when only scattered quadrants could be proven
+	uint8_t	 skip[tile_size * tile_size] = {};
+	uint64_t certified					 = 0;
+
+	if (certify)
+		certify_region(params, variant, tile, tile, output, width, height, skip, certified, worker);
+
+	if (certified == (uint64_t)tile.width * tile.height) return;
+
+	if (adaptive_limits)
+	{
+		Render_params tile_params = params;
+		tile_params.max_iter
+			= probe_tile_limit(params, variant, tile, output, width, height, skip, worker);
+
+		if (tile_params.max_iter < params.max_iter)
+		{
+			worker.limited_tiles++;
+			worker.lanes += evaluate_tile(tile_params, variant, tile, output, width, height, skip);
+
+			// Pixels still inside at the tile limit are iterated again up to the full one, so
+			// they end up exactly as without the limit
+			bool unfinished = false;
+			for (int y = 0; y < tile.height; y++)
+				for (int x = 0; x < tile.width; x++)
+				{
+					auto& flag = skip[(ptrdiff_t)y * tile.width + x];
+					if (flag != 0) continue;
+
+					if (output[(ptrdiff_t)(tile.y + y) * width + tile.x + x].x < 0)
+						unfinished = true;
+					else
+						flag = 1;
+				}
+
+			if (!unfinished) return;
+		}
+	}
+
+	worker.lanes += evaluate_tile(params, variant, tile, output, width, height, skip);
+}
+
+Lane_stats Cpu_renderer::evaluate_tile(const Render_params&	 params,
+									   const Kernel_variant& variant,
+									   const Cpu_tile&		 tile,
+									   glm::vec2*			 output,
+									   int					 width,
+									   int					 height,
+									   const uint8_t*		 skip) const
+{
+	if (reference != nullptr)
+		return cpu_render_tile_perturbed(
+			params, variant, *reference, reference_offset, tile, output, width, height, skip);
+
+	return cpu_render_tile(params, variant, tile, output, width, height, skip);
+}
+
+bool Cpu_renderer::prepare_reference(const Render_params&	params,
+									 const Kernel_variant& variant,
+									 int					width,
+									 std::stop_token		stop)
+{
+	const int limbs = Fixed_real::limbs_for_spacing(params.size.x / width);
+
+	if (reference != nullptr && reference->get_limbs() >= limbs
+		&& reference->get_settings().encoding == reference_settings.encoding
+		&& (reference->escaped() || reference->get_max_iter() >= params.max_iter))
+	{
+		const auto center = Fixed_complex::from_double_double(
+			params.center, params.center_lo, reference->get_limbs());
+		const auto offset = Fixed_complex{center.x - reference->get_center().x,
+										  center.y - reference->get_center().y}
+								.to_double();
+
+		if (std::abs(offset.x) <= params.size.x / 2 && std::abs(offset.y) <= params.size.y / 2)
+		{
+			reference_offset = offset;
+			return true;
+		}
+	}
+
+	const auto view_center
+		= Fixed_complex::from_double_double(params.center, params.center_lo, limbs);
+	auto	   center	   = view_center;
+	glm::dvec2 offset(0.0);
+
+	nucleus.reset();
+	if (nucleus_reference)
+	{
+		const auto found
+			= find_nearest_nucleus(view_center, glm::length(params.size) / 2, params.max_iter, stop);
+		if (stop.stop_requested()) return false;
+
+		if (found.has_value())
+		{
+			const auto nucleus_offset
+				= Fixed_complex{view_center.x - found->center.x, view_center.y - found->center.y}
+					  .to_double();
+
+			if (std::abs(nucleus_offset.x) <= params.size.x / 2
+				&& std::abs(nucleus_offset.y) <= params.size.y / 2)
+			{
+				center	= found->center;
+				offset	= nucleus_offset;
+				nucleus = found;
+			}
+		}
+	}
+
+	auto orbit = reference_store != nullptr
+				   ? reference_store->get(center, params.max_iter, variant.formula, reference_settings, stop)
+				   : Reference_orbit::compute(center, params.max_iter, reference_settings, stop);
+	if (orbit == nullptr) return false;
+
+	reference		 = std::move(orbit);
+	reference_offset = offset;
+	return true;
+}
+
+int Cpu_renderer::probe_tile_limit(const Render_params&	 params,
+								   const Kernel_variant& variant,
+								   const Cpu_tile&		 tile,
+								   glm::vec2*			 output,
+								   int					 width,
+								   int					 height,
+								   uint8_t*				 skip,
+								   Worker_stats&		 worker)
+{
+	// Bottom and top rows, then the left and right columns between them
+	Cpu_tile strips[4];
+	int		 strip_count = 0;
+
+	strips[strip_count++] = {tile.x, tile.y, tile.width, 1};
+	if (tile.height > 1) strips[strip_count++] = {tile.x, tile.y + tile.height - 1, tile.width, 1};
+	if (tile.height > 2)
+	{
+		strips[strip_count++] = {tile.x, tile.y + 1, 1, tile.height - 2};
+		if (tile.width > 1)
+			strips[strip_count++] = {tile.x + tile.width - 1, tile.y + 1, 1, tile.height - 2};
+	}
+
+	float border_max = 0;
+
+	for (const auto& strip : std::span(strips, strip_count))
+	{
+		const auto tile_index = [&](int i)
+		{
+			return (ptrdiff_t)(strip.y + i / strip.width - tile.y) * tile.width + strip.x
+				 + i % strip.width - tile.x;
+		};
+
+		// Strips are a single row or column of the tile, at most `tile_size` pixels
+		uint8_t	  strip_skip[tile_size];
+		const int count = strip.width * strip.height;
+		for (int i = 0; i < count; i++) strip_skip[i] = skip[tile_index(i)];
+
+		worker.lanes += evaluate_tile(params, variant, strip, output, width, height, strip_skip);
+
+		for (int i = 0; i < count; i++)
+		{
+			skip[tile_index(i)] = 1;
+
+			// Certified pixels are read as well, an interior one needs the full limit
+			const float value
+				= output[(ptrdiff_t)(strip.y + i / strip.width) * width + strip.x + i % strip.width].x;
+			if (value < 0) return params.max_iter;
+			border_max = std::max(border_max, value);
+		}
+	}
+
+	return std::min(params.max_iter,
+					(int)std::ceil(border_max) * border_limit_factor + border_limit_margin);
+}
+
+void Cpu_renderer::certify_region(const Render_params&	params,
+								  const Kernel_variant& variant,
+								  const Cpu_tile&		tile,
+								  const Cpu_tile&		region,
+								  glm::vec2*			output,
+								  int					width,
+								  int					height,
+								  uint8_t*				skip,
+								  uint64_t&				certified,
+								  Worker_stats&			worker)
+{
+	if (region.width < min_certified_size || region.height < min_certified_size) return;
+
+	const auto certificate = cpu_certify_tile(params, variant, region, width, height);
+
+	if (certificate.kind != Tile_certificate::Unknown)
+	{
+		cpu_fill_tile(certificate, region, output, width);
+
+		for (int y = region.y; y < region.y + region.height; y++)
+			std::fill_n(skip + (ptrdiff_t)(y - tile.y) * tile.width + (region.x - tile.x),
+						region.width,
+						uint8_t(1));
+
+		const auto area = (uint64_t)region.width * region.height;
+		certified += area;
+		if (certificate.kind == Tile_certificate::Interior)
+			worker.certified_interior_pixels += area;
+		else
+			worker.certified_escaped_pixels += area;
+		return;
+	}
+
+	// A smaller rectangle of c values may still be provable, unless the rectangle only
+	// spread out after many iterations, as it does along filaments, where halving it buys
+	// few more iterations
+	if (certificate.iter > max_split_iteration) return;
+
+	const int half_width = region.width / 2, half_height = region.height / 2;
+
+	const Cpu_tile quadrants[] = {
+		{region.x, region.y, half_width, half_height},
+		{region.x + half_width, region.y, region.width - half_width, half_height},
+		{region.x, region.y + half_height, half_width, region.height - half_height},
+		{region.x + half_width,
+		 region.y + half_height,
+		 region.width - half_width,
+		 region.height - half_height},
+	};
+
+	for (const auto& quadrant : quadrants)
+		certify_region(params, variant, tile, quadrant, output, width, height, skip, certified, worker);
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "fixed-point.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+// Full 128-bit product of two limbs
+void multiply_limbs(uint64_t a, uint64_t b, uint64_t& low, uint64_t& high)
+{
+#ifdef _MSC_VER
+	low = _umul128(a, b, &high);
+#else
+	const auto product = (unsigned __int128)a * b;
+	low				   = (uint64_t)product;
+	high			   = (uint64_t)(product >> 64);
+#endif
+}
+
+// Add `value` at `index` of `words`, propagating the carry up to `count`
+void add_at(uint64_t* words, int index, int count, uint64_t value)
+{
+	for (int i = index; i < count && value != 0; i++)
+	{
+		words[i] += value;
+		value = words[i] < value ? 1 : 0;
+	}
+}
+}
+
+Fixed_real::Fixed_real(int limbs) :
+	limbs(std::clamp(limbs, 2, max_limbs))
+{
+}
+
+Fixed_real Fixed_real::from_double(double value, int limbs)
+{
+	Fixed_real result(limbs);
+	if (value == 0 || !std::isfinite(value)) return result;
+
+	int		   exponent;
+	const auto mantissa = (uint64_t)std::ldexp(std::abs(std::frexp(value, &exponent)), 53);
+
+	// |value| = mantissa * 2^(exponent - 53), placed above 64 * (limbs - 1) fraction bits
+	const int shift = exponent - 53 + 64 * (result.limbs - 1);
+
+	if (shift < 0)
+	{
+		if (shift > -64) result.words[0] = mantissa >> -shift;
+	}
+	else
+	{
+		const int index = shift / 64, bit = shift % 64;
+		if (index < result.limbs) result.words[index] = mantissa << bit;
+		if (bit != 0 && index + 1 < result.limbs) result.words[index + 1] = mantissa >> (64 - bit);
+	}
+
+	return value < 0 ? -result : result;
+}
+
+Fixed_real Fixed_real::from_words(const uint64_t* words, int limbs)
+{
+	Fixed_real result(limbs);
+	std::copy_n(words, result.limbs, result.words.begin());
+	return result;
+}
+
+int Fixed_real::limbs_for_spacing(double spacing, int guard_bits)
+{
+	const int bits = std::max(0, -std::ilogb(spacing)) + guard_bits;
+	return std::clamp(1 + (bits + 63) / 64, 2, max_limbs);
+}
+
+double Fixed_real::to_double() const
+{
+	if (is_negative()) return -(-*this).to_double();
+
+	// Limbs below the top two nonzero ones are beyond double precision
+	double result = 0;
+	for (int i = limbs - 1, used = 0; i >= 0 && used < 2; i--)
+	{
+		if (words[i] == 0 && used == 0) continue;
+		result += std::ldexp((double)words[i], 64 * (i - (limbs - 1)));
+		used++;
+	}
+
+	return result;
+}
+
+Fixed_real Fixed_real::with_limbs(int new_limbs) const
+{
+	Fixed_real result(new_limbs);
+
+	// Align the integer limbs, fraction limbs follow downwards
+	for (int i = 0; i < result.limbs; i++)
+	{
+		const int source = i + limbs - result.limbs;
+		if (source >= 0 && source < limbs) result.words[i] = words[source];
+	}
+
+	return result;
+}
+
+Fixed_real operator+(const Fixed_real& a, const Fixed_real& b)
+{
+	Fixed_real result(a.limbs);
+	uint64_t   carry = 0;
+
+	for (int i = 0; i < a.limbs; i++)
+	{
+		const uint64_t sum = a.words[i] + b.words[i];
+		result.words[i]	   = sum + carry;
+		carry			   = (sum < a.words[i]) | (result.words[i] < sum);
+	}
+
+	return result;
+}
+
+Fixed_real operator-(const Fixed_real& a)
+{
+	Fixed_real result(a.limbs);
+	uint64_t   carry = 1;
+
+	for (int i = 0; i < a.limbs; i++)
+	{
+		result.words[i] = ~a.words[i] + carry;
+		carry			= carry && result.words[i] == 0;
+	}
+
+	return result;
+}
+
+Fixed_real operator-(const Fixed_real& a, const Fixed_real& b)
+{
+	return a + -b;
+}
+
+Fixed_real operator*(const Fixed_real& a, const Fixed_real& b)
+{
+	const int  n		= a.limbs;
+	const bool negative = a.is_negative() != b.is_negative();
+
+	const Fixed_real x = a.is_negative() ? -a : a, y = b.is_negative() ? -b : b;
+
+	// Schoolbook product of the magnitudes, 2n limbs with 2 * (n - 1) fraction limbs
+	uint64_t product[2 * Fixed_real::max_limbs] = {};
+
+	for (int i = 0; i < n; i++)
+	{
+		if (x.words[i] == 0) continue;
+
+		for (int j = 0; j < n; j++)
+		{
+			uint64_t low, high;
+			multiply_limbs(x.words[i], y.words[j], low, high);
+			add_at(product, i + j, 2 * n, low);
+			add_at(product, i + j + 1, 2 * n, high);
+		}
+	}
+
+	// Drop the extra n - 1 fraction limbs, truncating the magnitude
+	Fixed_real result(n);
+	std::copy_n(product + n - 1, n, result.words.begin());
+
+	return negative ? -result : result;
+}
+
+Fixed_real Fixed_real::shifted_left(int bits) const
+{
+	Fixed_real result(limbs);
+	if (bits <= 0 || bits >= 64) return bits == 0 ? *this : result;
+
+	for (int i = limbs - 1; i >= 0; i--)
+		result.words[i] = (words[i] << bits) | (i > 0 ? words[i - 1] >> (64 - bits) : 0);
+
+	return result;
+}
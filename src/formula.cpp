@@ -0,0 +1,91 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "formula.hpp"
+
+namespace formulas
+{
+Glsl_value::Glsl_value(Glsl_recording& recording, std::string name) :
+	recording(&recording),
+	name(std::move(name))
+{
+}
+
+Glsl_value Glsl_value::emit(const std::string& expression) const
+{
+	auto temporary = std::format("t{}", recording->temporaries++);
+	recording->code += std::format("T {} = {}; ", temporary, expression);
+	return {*recording, std::move(temporary)};
+}
+
+Glsl_value operator+(const Glsl_value& a, const Glsl_value& b)
+{
+	return a.emit(std::format("f_add({}, {})", a.name, b.name));
+}
+
+Glsl_value operator-(const Glsl_value& a, const Glsl_value& b)
+{
+	return a.emit(std::format("f_sub({}, {})", a.name, b.name));
+}
+
+Glsl_value operator*(const Glsl_value& a, const Glsl_value& b)
+{
+	return a.emit(std::format("f_mul({}, {})", a.name, b.name));
+}
+
+Glsl_value operator-(const Glsl_value& a)
+{
+	return a.emit(std::format("f_negate({})", a.name));
+}
+
+Glsl_value square(const Glsl_value& a)
+{
+	return a.emit(std::format("f_square({})", a.name));
+}
+
+Glsl_value twice(const Glsl_value& a)
+{
+	return a.emit(std::format("f_twice({})", a.name));
+}
+
+Glsl_value abs(const Glsl_value& a)
+{
+	return a.emit(std::format("f_abs({})", a.name));
+}
+
+Glsl_value times_sign(const Glsl_value& a, const Glsl_value& s)
+{
+	return a.emit(std::format("f_times_sign({}, {})", a.name, s.name));
+}
+
+Glsl_value scaled(const Glsl_value& a, double k)
+{
+	// Exact decimal digits, so that the shader multiplies by the same constant
+	return a.emit(std::format("f_mul({}, T({:.17e}))", a.name, k));
+}
+
+std::string glsl_macro_body(const Glsl_recording&								 recording,
+							const std::vector<std::pair<std::string, Glsl_value>>& results)
+{
+	// Results are assigned after every statement, which may still read the parameters
+	std::string body = "{ " + recording.code;
+	for (const auto& [parameter, value] : results)
+		if (value.get_name() != parameter) body += std::format("{} = {}; ", parameter, value.get_name());
+
+	return body + "}";
+}
+}
@@ -0,0 +1,324 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gpu-render-worker.hpp"
+
+#include <chrono>
+#include <numeric>
+
+Gpu_render_worker::Gpu_render_worker(GLFWwindow* share, const Texture1d& palette) :
+	context(
+		[share]
+		{
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+			auto* window = glfwCreateWindow(1, 1, "Render Worker", nullptr, share);
+			glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+			if (window == nullptr)
+			{
+				const char* err_info;
+				glfwGetError(&err_info);
+
+				logger.log(Logger::Error, "Can't create render worker context: {}", err_info);
+				throw std::runtime_error(err_info);
+			}
+
+			return window;
+		}()),
+	palette(palette),
+	thread([this](std::stop_token stop) { run(stop); })
+{
+}
+
+Gpu_render_worker::~Gpu_render_worker()
+{
+	{
+		std::lock_guard lock(mutex);
+		job.request_stop();
+	}
+
+	thread.request_stop();
+	thread.join();
+
+	if (ready.has_value()) glDeleteSync(ready->fence);
+	if (released != nullptr) glDeleteSync(released);
+
+	glfwDestroyWindow(context);
+}
+
+void Gpu_render_worker::submit(const Gpu_render_request& request)
+{
+	std::lock_guard lock(mutex);
+
+	job.request_stop();
+	job = std::stop_source();
+
+	pending = request;
+	wakeup.notify_one();
+}
+
+std::optional<Gpu_render_result> Gpu_render_worker::poll()
+{
+	std::lock_guard lock(mutex);
+
+	if (!ready.has_value()) return std::nullopt;
+
+	const auto status = glClientWaitSync(ready->fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) return std::nullopt;
+
+	glDeleteSync(ready->fence);
+	front = ready->texture;
+
+	// Draws of the old front texture issued so far are the last ones, the worker waits for them
+	// on the GPU before rendering into it
+	released = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+
+	auto result = std::move(ready->result);
+	ready.reset();
+
+	wakeup.notify_one();
+	return result;
+}
+
+bool Gpu_render_worker::busy() const
+{
+	std::lock_guard lock(mutex);
+	return rendering || pending.has_value() || ready.has_value();
+}
+
+void Gpu_render_worker::run(std::stop_token stop)
+{
+	glfwMakeContextCurrent(context);
+
+	{
+		Program_cache program_cache("shader-cache");
+		Gpu_renderer  renderer(program_cache);
+		Query_timer	  timer;
+
+		Texture2d targets[2];
+		glm::ivec2 target_sizes[2] = {};
+		int		   back			   = 0;
+
+		for (const auto& target : targets)
+		{
+			target.set_filter(GL_LINEAR, GL_LINEAR);
+			target.set_wrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+		}
+
+		for (;;)
+		{
+			Gpu_render_result result;
+			GLsync			  wait_for = nullptr;
+			std::stop_token	  cancel;
+			Task			  task;
+
+			{
+				std::unique_lock lock(mutex);
+
+				// The back texture is free again once the previous frame has been swapped in,
+				// tasks run while no frame can start
+				const auto can_render = [this] { return pending.has_value() && !ready.has_value(); };
+				if (!wakeup.wait(lock, stop, [&] { return can_render() || !tasks.empty(); }))
+					break;
+
+				if (can_render())
+				{
+					result.request = *pending;
+					pending.reset();
+
+					std::swap(wait_for, released);
+					cancel	  = job.get_token();
+					rendering = true;
+				}
+				else
+				{
+					task = std::move(tasks.front());
+					tasks.pop_front();
+				}
+			}
+
+			if (task)
+			{
+				task(renderer, stop);
+				util::check_err("Gpu_render_worker task");
+				continue;
+			}
+
+			if (wait_for != nullptr)
+			{
+				glWaitSync(wait_for, 0, GL_TIMEOUT_IGNORED);
+				glDeleteSync(wait_for);
+			}
+
+			auto&		request = result.request;
+			const auto& target	= targets[back];
+
+			// On the CPU of this thread, while the UI keeps running. A newer request cancels the
+			// probe and replaces this one.
+			if (request.iteration_controller.has_value())
+			{
+				request.params.max_iter
+					= request.iteration_controller->update(request.params, request.variant, cancel);
+
+				if (cancel.stop_requested())
+				{
+					std::lock_guard lock(mutex);
+					rendering = false;
+					continue;
+				}
+			}
+
+			const glm::ivec2 target_size{request.target_width, request.target_height};
+			if (target_sizes[back] != target_size)
+			{
+				target.stream_data(target_size.x, target_size.y, GL_RGB8);
+				target_sizes[back] = target_size;
+			}
+
+			renderer.use_symmetry	   = request.use_symmetry;
+			renderer.persistent_groups = request.persistent_groups;
+			renderer.batch_iterations  = request.batch_iterations;
+			renderer.keep_map		   = !request.interactive;
+
+			if (request.hybrid)
+				render_hybrid(renderer, timer, target, result);
+			else
+			{
+				timer.start();
+				renderer.render(request.params,
+								request.variant,
+								request.backend,
+								target,
+								palette,
+								request.width,
+								request.height);
+				timer.end();
+			}
+
+			if (!request.interactive)
+				result.map = renderer.copy_map(request.width, request.height);
+			util::check_err("Gpu_render_worker::run");
+
+			const GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+
+			if (!request.hybrid)
+			{
+				// Waits for the GPU, only this thread, and the history is complete after it
+				result.time_ms = timer.get_ns() / 1e6f;
+				if (request.backend == Gpu_backend::Compaction)
+					result.compaction_history = renderer.read_compaction_history();
+			}
+
+			std::lock_guard lock(mutex);
+			ready	  = Frame{fence, *target, std::move(result)};
+			rendering = false;
+			back ^= 1;
+		}
+
+		if (released != nullptr)
+		{
+			glDeleteSync(released);
+			released = nullptr;
+		}
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
+
+void Gpu_render_worker::render_hybrid(Gpu_renderer&	  renderer,
+									  Query_timer&		  timer,
+									  const Texture2d&	  target,
+									  Gpu_render_result& result)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	const auto& request = result.request;
+	const auto& params	= request.params;
+	const int	width = request.width, height = request.height;
+
+	if (hybrid_cpu == nullptr) hybrid_cpu = std::make_unique<Cpu_renderer>();
+	hybrid_cpu->certify_tiles	= request.certify_tiles;
+	hybrid_cpu->adaptive_limits = request.adaptive_limits;
+
+	// Every frame is swapped in only after its fence has signalled, and this one starts after
+	// that, so the row costs of the last hybrid frame are ready without waiting
+	if (hybrid_report.has_value())
+	{
+		hybrid_scheduler.report(renderer.read_row_costs(),
+								hybrid_report->width,
+								hybrid_report->max_iter,
+								hybrid_report->gpu_rows,
+								hybrid_report->gpu_ms,
+								hybrid_report->cpu_rows,
+								hybrid_report->cpu_ms);
+		hybrid_report.reset();
+	}
+
+	const auto symmetry = request.use_symmetry
+							   && Kernel_variant::is_conjugate_symmetric(request.variant.formula)
+							? find_row_symmetry(params, height)
+							: std::nullopt;
+	const auto rows = get_computed_rows(symmetry, height);
+
+	const auto costs = hybrid_scheduler.predict_row_costs(width, height, params.max_iter, rows);
+	const int  split = hybrid_scheduler.split(costs);
+
+	const auto gpu_rows = clip_rows(rows, 0, split), cpu_rows = clip_rows(rows, split, height);
+
+	// Queue the GPU part first, it runs while this thread computes the CPU part
+	timer.start();
+	renderer.render_map_rows(params, request.variant, width, height, gpu_rows);
+	timer.end();
+	glFlush();
+
+	hybrid_map.resize((size_t)width * height);
+	hybrid_cpu->render_rows(params, request.variant, width, height, cpu_rows, hybrid_map);
+
+	const float cpu_ms = hybrid_cpu->get_stats().time_ms;
+	const float gpu_ms = timer.get_ns() / 1e6f;
+
+	renderer.upload_map_rows(hybrid_map.data(), width, height, cpu_rows);
+	if (symmetry.has_value()) renderer.mirror_map_rows(*symmetry, width, height);
+
+	// The row costs of the complete map predict the cost of the next frame, they are read back
+	// with it instead of waiting for this one
+	renderer.measure_row_costs(width, height);
+	renderer.colorize_map(params, request.variant, target, palette, width, height);
+
+	hybrid_report = Hybrid_report{
+		.width	  = width,
+		.max_iter = params.max_iter,
+		.gpu_rows = gpu_rows,
+		.gpu_ms	  = gpu_ms,
+		.cpu_rows = cpu_rows,
+		.cpu_ms	  = cpu_ms,
+	};
+
+	const double total_cost = std::accumulate(costs.begin(), costs.end(), 0.0),
+				 gpu_cost	= std::accumulate(costs.begin(), costs.begin() + split, 0.0);
+
+	result.hybrid = Hybrid_frame_stats{
+		.split_row = split,
+		.height	   = height,
+		.gpu_share = total_cost > 0 ? float(gpu_cost / total_cost) : 0.0f,
+		.gpu_ms	   = gpu_ms,
+		.cpu_ms	   = cpu_ms,
+	};
+	result.time_ms
+		= std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,780 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "gpu-renderer.hpp"
+#include "resources.hpp"
+
+// Check that the reflected `Render_params` block matches the C++ struct layout
+static void verify_render_params_layout(const Shader& shader)
+{
+	const auto* block = shader.uniform_block("Render_params");
+	if (block == nullptr) throw std::runtime_error("Uniform block Render_params not found");
+
+	const std::pair<const char*, size_t> members[] = {
+		{"center", offsetof(Render_params, center)},
+		{"size", offsetof(Render_params, size)},
+		{"max_iter", offsetof(Render_params, max_iter)},
+		{"palette_cycle", offsetof(Render_params, palette_cycle)},
+		{"julia_c", offsetof(Render_params, julia_c)},
+		{"center_lo", offsetof(Render_params, center_lo)},
+	};
+
+	// std140 blocks keep every member active, a missing one has been renamed or removed
+	for (const auto& [name, offset] : members)
+	{
+		auto find = block->member_offsets.find(name);
+		if (find == block->member_offsets.end())
+		{
+			logger.log(Logger::Error, "Render_params.{} is missing in shader", name);
+			throw std::runtime_error("Render_params layout mismatch");
+		}
+
+		if (find->second != (GLint)offset)
+		{
+			logger.log(Logger::Error,
+					   "Render_params.{} is at offset {} in shader, {} in C++",
+					   name,
+					   find->second,
+					   offset);
+			throw std::runtime_error("Render_params layout mismatch");
+		}
+	}
+}
+
+// Control block of compaction.comp: two dispatch-indirect triples, two counters and the history
+static const GLintptr	compaction_iterate_dispatch = 0;
+static const GLintptr	compaction_scan_dispatch	= 16;
+static const GLintptr	compaction_history_offset	= 32;
+static const GLsizeiptr compaction_control_size
+	= compaction_history_offset + Gpu_renderer::max_compaction_batches * sizeof(uint32_t);
+
+// Batch_view of batch.comp, std430 lays it out like the C++ struct
+struct Batch_view
+{
+	Render_params params;
+};
+
+static_assert(sizeof(Batch_view) == 80);
+
+static const char* const compaction_passes[]
+	= {"PASS_INIT", "PASS_ITERATE", "PASS_SCAN", "PASS_SCAN_BLOCKS", "PASS_SCATTER", "PASS_FINALIZE"};
+
+const char* get_backend_name(Gpu_backend backend)
+{
+	switch (backend)
+	{
+	case Gpu_backend::Fragment:
+		return "Fragment";
+	case Gpu_backend::Compute:
+		return "Compute (Persistent)";
+	case Gpu_backend::Compaction:
+		return "Compute (Compaction)";
+	}
+
+	return "Unknown";
+}
+
+Gpu_renderer::Gpu_renderer(Program_cache& program_cache) :
+	fragment_variants(
+		{{GL_VERTEX_SHADER, resources::to_string(resources::file_shaders_common_vert_)},
+		 {GL_FRAGMENT_SHADER,
+		  compose_kernel_stage(resources::to_string(resources::file_shaders_generator_frag_))}},
+		&program_cache),
+	compute_variants({{GL_COMPUTE_SHADER,
+					   compose_kernel_stage(
+						   resources::to_string(resources::file_shaders_generator_comp_))}},
+					 &program_cache),
+	colorize_variants(
+		{{GL_VERTEX_SHADER, resources::to_string(resources::file_shaders_common_vert_)},
+		 {GL_FRAGMENT_SHADER,
+		  compose_kernel_stage(resources::to_string(resources::file_shaders_colorize_frag_))}},
+		&program_cache),
+	compaction_variants({{GL_COMPUTE_SHADER,
+						  compose_kernel_stage(
+							  resources::to_string(resources::file_shaders_compaction_comp_))}},
+						&program_cache),
+	batch_variants(
+		{{GL_COMPUTE_SHADER,
+		  compose_kernel_stage(resources::to_string(resources::file_shaders_batch_comp_))}},
+		&program_cache),
+	point_variants(
+		{{GL_COMPUTE_SHADER,
+		  compose_kernel_stage(resources::to_string(resources::file_shaders_points_comp_))}},
+		&program_cache),
+	row_cost_variants(
+		{{GL_COMPUTE_SHADER, resources::to_string(resources::file_shaders_row_costs_comp_)}},
+		&program_cache)
+{
+	params_buffer.stream_data(sizeof(Render_params));
+	tile_counter.stream_data(sizeof(GLuint));
+	compaction.control.stream_data(compaction_control_size);
+	compaction.history.stream_data(max_compaction_batches * sizeof(uint32_t), GL_STREAM_READ);
+
+	iteration_map.set_filter(GL_NEAREST, GL_NEAREST);
+	iteration_map.set_wrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+}
+
+bool Gpu_renderer::supports(Kernel_precision precision)
+{
+	if (precision == Kernel_precision::Fixed128) return GLEW_ARB_gpu_shader_int64;
+	return true;
+}
+
+void Gpu_renderer::prepare(const Kernel_variant& variant)
+{
+	for (const auto* pass : compaction_passes)
+	{
+		auto defines = variant.defines();
+		defines.emplace_back(pass, "");
+
+		auto result = compaction_variants.get(defines);
+		if (!result.ok())
+		{
+			logger.log(Logger::Error, "Shader Error:\n{}", result.get_err());
+			throw std::runtime_error("Shader Error: " + result.get_err());
+		}
+	}
+
+	for (auto* cache : {&fragment_variants, &compute_variants, &colorize_variants})
+	{
+		auto result = cache->get(variant.defines());
+		if (!result.ok())
+		{
+			logger.log(Logger::Error, "Shader Error:\n{}", result.get_err());
+			throw std::runtime_error("Shader Error: " + result.get_err());
+		}
+
+		verify_render_params_layout(result.get());
+	}
+}
+
+std::optional<Shader> Gpu_renderer::get_program(Shader_variant_cache&	cache,
+												const Kernel_variant& variant)
+{
+	auto result = cache.get(variant.defines());
+	if (!result.ok())
+	{
+		logger.log(Logger::Error, "Shader Error:\n{}", result.get_err());
+		return std::nullopt;
+	}
+
+	return result.get();
+}
+
+void Gpu_renderer::reserve_iteration_map(int width, int height)
+{
+	if (width <= iteration_map_width && height <= iteration_map_height) return;
+
+	iteration_map_width	 = std::max(width, iteration_map_width);
+	iteration_map_height = std::max(height, iteration_map_height);
+	iteration_map.stream_data(
+		iteration_map_width, iteration_map_height, GL_RG32F, GL_RG, GL_FLOAT, nullptr);
+}
+
+std::optional<Row_symmetry> Gpu_renderer::find_symmetry(const Render_params&  params,
+														 const Kernel_variant& variant,
+														 int				   height) const
+{
+	if (!use_symmetry || !Kernel_variant::is_conjugate_symmetric(variant.formula))
+		return std::nullopt;
+	return find_row_symmetry(params, height);
+}
+
+void Gpu_renderer::render(const Render_params&	params,
+						  const Kernel_variant& variant,
+						  Gpu_backend			backend,
+						  const Texture2d&		target,
+						  const Texture1d&		palette,
+						  int					width,
+						  int					height)
+{
+	params_buffer.update(params);
+	params_buffer.bind_base(GL_UNIFORM_BUFFER, 0);
+	palette.bind_slot(0);
+
+	if (backend == Gpu_backend::Fragment && keep_map)
+	{
+		const auto symmetry = find_symmetry(params, variant, height);
+
+		render_map_rows(params, variant, width, height, get_computed_rows(symmetry, height));
+		if (symmetry.has_value()) mirror_map_rows(*symmetry, width, height);
+		colorize_map(params, variant, target, palette, width, height);
+		return;
+	}
+
+	framebuffer.link(target);
+
+	switch (backend)
+	{
+	case Gpu_backend::Fragment:
+		render_fragment(params, variant, width, height);
+		break;
+	case Gpu_backend::Compute:
+		render_compute(variant, width, height);
+		break;
+	case Gpu_backend::Compaction:
+		render_compaction(params, variant, width, height);
+		break;
+	}
+
+	Framebuffer::unbind();
+}
+
+void Gpu_renderer::present(const Render_params&	 params,
+						   const Kernel_variant& variant,
+						   const glm::vec2*		 map,
+						   const Texture2d&		 target,
+						   const Texture1d&		 palette,
+						   int					 width,
+						   int					 height)
+{
+	reserve_iteration_map(width, height);
+	iteration_map.update(0, 0, width, height, GL_RG, GL_FLOAT, map);
+
+	params_buffer.update(params);
+	params_buffer.bind_base(GL_UNIFORM_BUFFER, 0);
+	palette.bind_slot(0);
+
+	framebuffer.link(target);
+	colorize(variant, width, height);
+	Framebuffer::unbind();
+}
+
+void Gpu_renderer::render_fragment(const Render_params&  params,
+								   const Kernel_variant& variant,
+								   int					 width,
+								   int					 height)
+{
+	auto program = get_program(fragment_variants, variant);
+	if (!program.has_value()) return;
+
+	framebuffer.bind();
+	glViewport(0, 0, width, height);
+
+	program->use();
+
+	const auto symmetry = find_symmetry(params, variant, height);
+	if (!symmetry.has_value())
+	{
+		quad.draw();
+		return;
+	}
+
+	// Draw the rows below and above the mirrored band
+	draw_rows(get_computed_rows(symmetry, height), width);
+	mirror_rows(*symmetry, width);
+}
+
+void Gpu_renderer::draw_rows(const Row_bands& rows, int width)
+{
+	glEnable(GL_SCISSOR_TEST);
+	for (const auto& [begin, end] : rows)
+	{
+		glScissor(0, begin, width, end - begin);
+		quad.draw();
+	}
+	glDisable(GL_SCISSOR_TEST);
+}
+
+void Gpu_renderer::mirror_rows(const Row_symmetry& symmetry, int width)
+{
+	// Source rows are disjoint from the destination rows, so blitting within one framebuffer
+	// is well defined. The swapped source Y bounds flip the rows.
+	glBlitFramebuffer(0,
+					  symmetry.source(symmetry.first) + 1,
+					  width,
+					  symmetry.source(symmetry.last),
+					  0,
+					  symmetry.first,
+					  width,
+					  symmetry.last + 1,
+					  GL_COLOR_BUFFER_BIT,
+					  GL_NEAREST);
+}
+
+void Gpu_renderer::render_map_rows(const Render_params&  params,
+								   const Kernel_variant& variant,
+								   int					 width,
+								   int					 height,
+								   const Row_bands&		 rows)
+{
+	auto defines = variant.defines();
+	defines.emplace_back("OUTPUT_ITERATION_MAP", "");
+
+	auto result = fragment_variants.get(defines);
+	if (!result.ok())
+	{
+		logger.log(Logger::Error, "Shader Error:\n{}", result.get_err());
+		return;
+	}
+
+	reserve_iteration_map(width, height);
+
+	params_buffer.update(params);
+	params_buffer.bind_base(GL_UNIFORM_BUFFER, 0);
+
+	framebuffer.link(iteration_map);
+	glViewport(0, 0, width, height);
+
+	result.get().use();
+	draw_rows(rows, width);
+
+	Framebuffer::unbind();
+}
+
+void Gpu_renderer::upload_map_rows(const glm::vec2* map, int width, int height, const Row_bands& rows)
+{
+	reserve_iteration_map(width, height);
+
+	for (const auto& [begin, end] : rows)
+		iteration_map.update(
+			0, begin, width, end - begin, GL_RG, GL_FLOAT, map + (ptrdiff_t)begin * width);
+}
+
+void Gpu_renderer::mirror_map_rows(const Row_symmetry& symmetry, int width, int height)
+{
+	reserve_iteration_map(width, height);
+
+	framebuffer.link(iteration_map);
+	mirror_rows(symmetry, width);
+	Framebuffer::unbind();
+}
+
+Buffer Gpu_renderer::copy_map(int width, int height)
+{
+	Buffer buffer;
+	buffer.stream_data(GLsizeiptr((size_t)width * height * sizeof(glm::vec2)), GL_STREAM_READ);
+
+	// The compute backends store the map as an image
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+
+	framebuffer.link(iteration_map);
+	buffer.bind(GL_PIXEL_PACK_BUFFER);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_RG, GL_FLOAT, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	Framebuffer::unbind();
+
+	return buffer;
+}
+
+std::vector<glm::vec2> Gpu_renderer::read_map_buffer(const Buffer& buffer, int width, int height)
+{
+	std::vector<glm::vec2> map((size_t)width * height);
+
+	buffer.bind(GL_COPY_READ_BUFFER);
+	glGetBufferSubData(
+		GL_COPY_READ_BUFFER, 0, GLsizeiptr(map.size() * sizeof(glm::vec2)), map.data());
+
+	return map;
+}
+
+void Gpu_renderer::measure_row_costs(int width, int height)
+{
+	auto result = row_cost_variants.get({});
+	if (!result.ok())
+	{
+		logger.log(Logger::Error, "Shader Error:\n{}", result.get_err());
+		return;
+	}
+
+	if (height > row_cost_capacity)
+	{
+		row_costs.stream_data(height * (GLsizeiptr)sizeof(glm::vec2), GL_STREAM_READ);
+		row_cost_capacity = height;
+	}
+
+	const auto& program = result.get();
+	program.uniform<int>("width").set(width);
+
+	iteration_map.bind_slot(0);
+	row_costs.bind_base(GL_SHADER_STORAGE_BUFFER, 0);
+	program.use();
+	glDispatchCompute(height, 1, 1);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	measured_rows = height;
+}
+
+std::vector<glm::vec2> Gpu_renderer::read_row_costs() const
+{
+	std::vector<glm::vec2> costs(measured_rows);
+	if (costs.empty()) return costs;
+
+	row_costs.bind(GL_COPY_READ_BUFFER);
+	glGetBufferSubData(
+		GL_COPY_READ_BUFFER, 0, GLsizeiptr(costs.size() * sizeof(glm::vec2)), costs.data());
+
+	return costs;
+}
+
+void Gpu_renderer::colorize_map(const Render_params&  params,
+								const Kernel_variant& variant,
+								const Texture2d&	  target,
+								const Texture1d&	  palette,
+								int					  width,
+								int					  height)
+{
+	params_buffer.update(params);
+	params_buffer.bind_base(GL_UNIFORM_BUFFER, 0);
+	palette.bind_slot(0);
+
+	framebuffer.link(target);
+	colorize(variant, width, height);
+	Framebuffer::unbind();
+}
+
+int Gpu_renderer::get_max_batch_size()
+{
+	GLint layers = 0, groups = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &layers);
+	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 2, &groups);
+
+	return std::min(layers, groups);
+}
+
+void Gpu_renderer::render_batch(std::span<const Render_params> views,
+								const Kernel_variant&		   variant,
+								const Texture2d_array&		   target,
+								const Texture1d&			   palette,
+								int							   width,
+								int							   height)
+{
+	dispatch_batch(views, variant, false, target, palette, width, height);
+}
+
+void Gpu_renderer::present_batch(std::span<const Render_params> views,
+								 const Kernel_variant&			variant,
+								 const glm::vec2*				maps,
+								 const Texture2d_array&			target,
+								 const Texture1d&				palette,
+								 int							width,
+								 int							height)
+{
+	const int layers = (int)views.size();
+
+	if (width > batch_map_width || height > batch_map_height || layers > batch_map_layers)
+	{
+		batch_map_width	 = std::max(width, batch_map_width);
+		batch_map_height = std::max(height, batch_map_height);
+		batch_map_layers = std::max(layers, batch_map_layers);
+		batch_map.stream_data(
+			batch_map_width, batch_map_height, batch_map_layers, GL_RG32F, GL_RG, GL_FLOAT, nullptr);
+		batch_map.set_filter(GL_NEAREST, GL_NEAREST);
+	}
+
+	batch_map.update(0, 0, 0, width, height, layers, GL_RG, GL_FLOAT, maps);
+
+	dispatch_batch(views, variant, true, target, palette, width, height);
+}
+
+void Gpu_renderer::dispatch_batch(std::span<const Render_params> views,
+								  const Kernel_variant&			 variant,
+								  bool							 from_map,
+								  const Texture2d_array&		 target,
+								  const Texture1d&				 palette,
+								  int							 width,
+								  int							 height)
+{
+	if (views.empty()) return;
+
+	auto defines = variant.defines();
+	defines.emplace_back("BATCH_RENDER", "");
+	if (from_map) defines.emplace_back("BATCH_COLORIZE", "");
+
+	auto result = batch_variants.get(defines);
+	if (!result.ok())
+	{
+		logger.log(Logger::Error, "Shader Error:\n{}", result.get_err());
+		return;
+	}
+
+	std::vector<Batch_view> entries(views.size());
+	for (size_t i = 0; i < views.size(); i++) entries[i].params = views[i];
+
+	batch_views.stream_data(
+		GLsizeiptr(entries.size() * sizeof(Batch_view)), GL_STREAM_DRAW, entries.data());
+	batch_views.bind_base(GL_SHADER_STORAGE_BUFFER, 0);
+
+	palette.bind_slot(0);
+	if (from_map) batch_map.bind_slot(1);
+	target.bind_image(0, GL_WRITE_ONLY, GL_RGBA8);
+
+	const auto& program = result.get();
+	program.uniform<glm::ivec2>("region_size").set({width, height});
+	program.use();
+	glDispatchCompute((width + 7) / 8, (height + 7) / 8, (GLuint)views.size());
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+					| GL_TEXTURE_UPDATE_BARRIER_BIT);
+}
+
+void Gpu_renderer::evaluate_points(const Kernel_variant&	variant,
+								   int						max_iter,
+								   const Buffer&			x,
+								   const Buffer&			y,
+								   size_t					count,
+								   const Gpu_point_results& results)
+{
+	if (count == 0) return;
+
+	// Distances need the derivative whatever the coloring
+	auto point_variant = variant;
+	if (results.distance != nullptr) point_variant.derivative = true;
+
+	auto defines = point_variant.defines();
+	if (results.iterations != nullptr) defines.emplace_back("OUTPUT_ITERATIONS", "");
+	if (results.z_x != nullptr && results.z_y != nullptr) defines.emplace_back("OUTPUT_Z", "");
+	if (results.distance != nullptr) defines.emplace_back("OUTPUT_DISTANCE", "");
+
+	auto result = point_variants.get(defines);
+	if (!result.ok())
+	{
+		logger.log(Logger::Error, "Shader Error:\n{}", result.get_err());
+		return;
+	}
+
+	params_buffer.update(Render_params{
+		.center		   = {0.0, 0.0},
+		.size		   = {0.0, 0.0},
+		.max_iter	   = max_iter,
+		.palette_cycle = 0,
+	});
+	params_buffer.bind_base(GL_UNIFORM_BUFFER, 0);
+
+	x.bind_base(GL_SHADER_STORAGE_BUFFER, 0);
+	y.bind_base(GL_SHADER_STORAGE_BUFFER, 1);
+	if (results.iterations != nullptr) results.iterations->bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+	if (results.z_x != nullptr && results.z_y != nullptr)
+	{
+		results.z_x->bind_base(GL_SHADER_STORAGE_BUFFER, 3);
+		results.z_y->bind_base(GL_SHADER_STORAGE_BUFFER, 4);
+	}
+	if (results.distance != nullptr) results.distance->bind_base(GL_SHADER_STORAGE_BUFFER, 5);
+
+	GLint max_groups;
+	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &max_groups);
+
+	const auto& program = result.get();
+	program.uniform<unsigned int>("point_count").set((unsigned int)count);
+	program.use();
+	glDispatchCompute((GLuint)std::min<size_t>((count + 63) / 64, max_groups), 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT
+					| GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+}
+
+void Gpu_renderer::render_compute(const Kernel_variant& variant, int width, int height)
+{
+	auto program = get_program(compute_variants, variant);
+	if (!program.has_value()) return;
+
+	reserve_iteration_map(width, height);
+
+	const GLuint zero = 0;
+	tile_counter.update(0, sizeof(GLuint), &zero);
+	tile_counter.bind_base(GL_ATOMIC_COUNTER_BUFFER, 0);
+
+	iteration_map.bind_image(0, GL_WRITE_ONLY, GL_RG32F);
+
+	program->uniform<glm::ivec2>("region_size").set({width, height});
+	program->use();
+	glDispatchCompute(persistent_groups, 1, 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	colorize(variant, width, height);
+}
+
+void Gpu_renderer::reserve_compaction(const Kernel_variant& variant, size_t pixel_count)
+{
+	// Pixel_state of compaction.comp: one dvec2 per stored vector plus a 16-byte aligned tail
+	// (double-double keeps a trailing dvec2 next to the orbit and its snapshot, fixed point adds
+	// two 128-bit coordinates to them)
+	int orbit = 1;
+	if (variant.precision == Kernel_precision::Double_double) orbit = 2;
+	if (variant.precision == Kernel_precision::Fixed128) orbit = 3;
+
+	const bool	 derivative = variant.derivative || variant.coloring == Kernel_coloring::Distance;
+	const size_t stride
+		= 16 * (orbit + 1 + (derivative ? 1 : 0) + (variant.periodicity ? orbit : 0));
+
+	if (pixel_count <= compaction.pixel_capacity && stride <= compaction.state_stride) return;
+
+	compaction.pixel_capacity = std::max(pixel_count, compaction.pixel_capacity);
+	compaction.state_stride	  = std::max(stride, compaction.state_stride);
+
+	const auto capacity	   = (GLsizeiptr)compaction.pixel_capacity;
+	const auto block_count = capacity / 512 + 1;
+
+	compaction.states.stream_data(capacity * (GLsizeiptr)compaction.state_stride, GL_DYNAMIC_COPY);
+	compaction.flags.stream_data(capacity * sizeof(uint32_t), GL_DYNAMIC_COPY);
+	compaction.offsets.stream_data(capacity * sizeof(uint32_t), GL_DYNAMIC_COPY);
+	compaction.block_sums.stream_data(block_count * sizeof(uint32_t), GL_DYNAMIC_COPY);
+	for (const auto& list : compaction.lists)
+		list.stream_data(capacity * sizeof(uint32_t), GL_DYNAMIC_COPY);
+}
+
+void Gpu_renderer::render_compaction(const Render_params&  params,
+									 const Kernel_variant& variant,
+									 int				   width,
+									 int				   height)
+{
+	std::vector<Shader> passes;
+	for (const auto* pass : compaction_passes)
+	{
+		auto defines = variant.defines();
+		defines.emplace_back(pass, "");
+
+		auto result = compaction_variants.get(defines);
+		if (!result.ok())
+		{
+			logger.log(Logger::Error, "Shader Error:\n{}", result.get_err());
+			return;
+		}
+		passes.push_back(result.get());
+	}
+
+	const auto &init = passes[0], &iterate = passes[1], &scan = passes[2], &scan_blocks = passes[3],
+			   &scatter = passes[4], &finalize = passes[5];
+
+	const size_t pixel_count = (size_t)width * height;
+	reserve_iteration_map(width, height);
+	reserve_compaction(variant, pixel_count);
+
+	// Spread the iterations over at most `max_compaction_batches` batches
+	const int max_iter	  = std::max(params.max_iter, 1);
+	const int batch_size  = std::max(batch_iterations,
+									 (max_iter + max_compaction_batches - 1) / max_compaction_batches);
+	const int batch_count = (max_iter + batch_size - 1) / batch_size;
+
+	const std::vector<uint32_t> empty_history(max_compaction_batches, 0);
+	compaction.control.update(compaction_history_offset,
+							  max_compaction_batches * sizeof(uint32_t),
+							  empty_history.data());
+
+	compaction.control.bind_base(GL_SHADER_STORAGE_BUFFER, 0);
+	compaction.control.bind(GL_DISPATCH_INDIRECT_BUFFER);
+	compaction.states.bind_base(GL_SHADER_STORAGE_BUFFER, 1);
+	compaction.flags.bind_base(GL_SHADER_STORAGE_BUFFER, 4);
+	compaction.offsets.bind_base(GL_SHADER_STORAGE_BUFFER, 5);
+	compaction.block_sums.bind_base(GL_SHADER_STORAGE_BUFFER, 6);
+	iteration_map.bind_image(0, GL_WRITE_ONLY, GL_RG32F);
+
+	const auto barrier = []
+	{
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	};
+
+	// Every pixel starts active, the list is written through the "next" binding
+	compaction.lists[0].bind_base(GL_SHADER_STORAGE_BUFFER, 3);
+	init.uniform<glm::ivec2>("region_size").set({width, height});
+	init.use();
+	glDispatchCompute(GLuint((pixel_count + 63) / 64), 1, 1);
+	barrier();
+
+	iterate.uniform<glm::ivec2>("region_size").set({width, height});
+	iterate.uniform<int>("batch_iterations").set(batch_size);
+	const auto batch_index = finalize.uniform<int>("batch_index");
+
+	for (int batch = 0; batch < batch_count; batch++)
+	{
+		compaction.lists[batch % 2].bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+		compaction.lists[(batch + 1) % 2].bind_base(GL_SHADER_STORAGE_BUFFER, 3);
+
+		iterate.use();
+		glDispatchComputeIndirect(compaction_iterate_dispatch);
+		barrier();
+
+		scan.use();
+		glDispatchComputeIndirect(compaction_scan_dispatch);
+		barrier();
+
+		scan_blocks.use();
+		glDispatchCompute(1, 1, 1);
+		barrier();
+
+		scatter.use();
+		glDispatchComputeIndirect(compaction_scan_dispatch);
+		barrier();
+
+		batch_index.set(batch);
+		finalize.use();
+		glDispatchCompute(1, 1, 1);
+		barrier();
+	}
+
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	colorize(variant, width, height);
+
+	// Kept on the GPU until read_compaction_history(), reading it here would wait for the render
+	compaction.history_length = std::min(batch_count, max_compaction_batches);
+	compaction.control.bind(GL_COPY_READ_BUFFER);
+	compaction.history.bind(GL_COPY_WRITE_BUFFER);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER,
+						GL_COPY_WRITE_BUFFER,
+						compaction_history_offset,
+						0,
+						GLsizeiptr(compaction.history_length * sizeof(uint32_t)));
+}
+
+std::vector<uint32_t> Gpu_renderer::read_compaction_history() const
+{
+	std::vector<uint32_t> history(compaction.history_length);
+	if (history.empty()) return history;
+
+	compaction.history.bind(GL_COPY_READ_BUFFER);
+	glGetBufferSubData(
+		GL_COPY_READ_BUFFER, 0, GLsizeiptr(history.size() * sizeof(uint32_t)), history.data());
+
+	return history;
+}
+
+void Gpu_renderer::colorize(const Kernel_variant& variant, int width, int height)
+{
+	auto program = get_program(colorize_variants, variant);
+	if (!program.has_value()) return;
+
+	framebuffer.bind();
+	glViewport(0, 0, width, height);
+
+	iteration_map.bind_slot(1);
+	program->use();
+	quad.draw();
+}
+
+float Gpu_renderer::benchmark(const Render_params&	params,
+							  const Kernel_variant& variant,
+							  Gpu_backend			backend,
+							  const Texture2d&		target,
+							  const Texture1d&		palette,
+							  int					width,
+							  int					height,
+							  int					runs)
+{
+	// Warm up, so that lazy compilation doesn't count
+	render(params, variant, backend, target, palette, width, height);
+	glFinish();
+
+	float total_ms = 0;
+	for (int i = 0; i < runs; i++)
+	{
+		timer.start();
+		render(params, variant, backend, target, palette, width, height);
+		timer.end();
+		total_ms += timer.get_ns() / 1e6f;
+	}
+
+	return total_ms / runs;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "hybrid-scheduler.hpp"
+
+#include <numeric>
+
+// Escaped pixels are counted at their iteration value plus one, interior pixels at
+// `max_iter`. The absolute unit does not matter, only that both backends are measured in it.
+
+std::vector<double> Hybrid_scheduler::predict_row_costs(int				 width,
+														int				 height,
+														int				 max_iter,
+														const Row_bands& rows) const
+{
+	std::vector<double> costs(height, 0.0);
+
+	for (const auto& [begin, end] : rows)
+		for (int y = begin; y < end; y++)
+		{
+			if (profile.empty())
+			{
+				costs[y] = width;
+				continue;
+			}
+
+			// Resample the previous frame to the current height
+			const auto& row = profile[std::min((size_t)y * profile.size() / height, profile.size() - 1)];
+			costs[y] = width * (row.escaped_iterations + row.interior_fraction * max_iter);
+		}
+
+	return costs;
+}
+
+int Hybrid_scheduler::split(const std::vector<double>& row_costs) const
+{
+	const double total = std::accumulate(row_costs.begin(), row_costs.end(), 0.0);
+
+	// Equal times when each backend gets cost in proportion to its throughput
+	const double gpu_share = gpu_throughput > 0 && cpu_throughput > 0
+							   ? gpu_throughput / (gpu_throughput + cpu_throughput)
+							   : 0.5;
+	const double target	   = gpu_share * total;
+
+	double prefix = 0;
+	for (int y = 0; y < (int)row_costs.size(); y++)
+	{
+		// Stop at the row boundary closest to the target
+		if (prefix + row_costs[y] / 2 > target) return y;
+		prefix += row_costs[y];
+	}
+
+	return (int)row_costs.size();
+}
+
+double Hybrid_scheduler::measure_cost(const std::vector<glm::vec2>& row_costs,
+									  int							max_iter,
+									  const Row_bands&				rows)
+{
+	double cost = 0;
+	for (const auto& [begin, end] : rows)
+		for (int y = begin; y < end; y++) cost += row_costs[y].x + (double)row_costs[y].y * max_iter;
+
+	return cost;
+}
+
+void Hybrid_scheduler::report(const std::vector<glm::vec2>& row_costs,
+							  int							width,
+							  int							max_iter,
+							  const Row_bands&				gpu_rows,
+							  float							gpu_ms,
+							  const Row_bands&				cpu_rows,
+							  float							cpu_ms)
+{
+	const auto update = [](double& throughput, double cost, float time_ms)
+	{
+		if (cost <= 0 || time_ms <= 0) return;
+
+		const double measured = cost / time_ms;
+		throughput = throughput == 0 ? measured : throughput + (measured - throughput) * smoothing;
+	};
+
+	update(gpu_throughput, measure_cost(row_costs, max_iter, gpu_rows), gpu_ms);
+	update(cpu_throughput, measure_cost(row_costs, max_iter, cpu_rows), cpu_ms);
+
+	profile.resize(row_costs.size());
+	for (size_t y = 0; y < row_costs.size(); y++)
+		profile[y] = {
+			.escaped_iterations = row_costs[y].x / width,
+			.interior_fraction	= row_costs[y].y / width,
+		};
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "iteration-controller.hpp"
+#include "cpu-kernel.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+int Iteration_controller::update(const Render_params&  params,
+								 const Kernel_variant& variant,
+								 std::stop_token	   stop)
+{
+	const int probe_height
+		= std::max(1, (int)std::round(probe_width * params.size.y / params.size.x));
+	const int pixel_count = probe_width * probe_height;
+
+	// Unresolved pixels allowed at the picked limit
+	const auto allowed = (size_t)(target_fraction * pixel_count);
+
+	probe.resize(pixel_count);
+
+	// Only escape counts matter, and periodicity ends interior pixels long before the limit
+	auto probe_variant		  = variant;
+	probe_variant.coloring	  = Kernel_coloring::Iteration;
+	probe_variant.derivative  = false;
+	probe_variant.periodicity = true;
+
+	int limit = max_iter;
+	for (int attempt = 0; attempt < max_probes; attempt++)
+	{
+		if (stop.stop_requested()) return max_iter;
+
+		Render_params probe_params = params;
+		probe_params.max_iter	   = std::min(limit * 2, max_iter_limit);
+
+		cpu_render_tile(probe_params,
+						probe_variant,
+						{0, 0, probe_width, probe_height},
+						probe.data(),
+						probe_width,
+						probe_height);
+
+		escapes.clear();
+		for (const auto& pixel : probe)
+			if (pixel.x >= 0) escapes.push_back(pixel.x);
+
+		// Smallest limit that leaves no more than `allowed` of the escaping pixels behind
+		int needed = min_iter;
+		if (escapes.size() > allowed)
+		{
+			const auto nth = escapes.end() - 1 - allowed;
+			std::nth_element(escapes.begin(), nth, escapes.end());
+			needed = (int)std::ceil(*nth) + 1;
+		}
+
+		limit = std::clamp(needed, min_iter, max_iter_limit);
+
+		// Pixels escaping past the probe limit are unseen, trust the result only when it lies
+		// well below that limit
+		if (limit <= probe_params.max_iter / 2 || probe_params.max_iter == max_iter_limit) break;
+	}
+
+	max_iter = limit;
+
+	const auto unresolved
+		= std::count_if(escapes.begin(), escapes.end(), [this](float value) { return value >= max_iter; });
+	unresolved_fraction = (float)unresolved / pixel_count;
+
+	return max_iter;
+}
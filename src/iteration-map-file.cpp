@@ -0,0 +1,352 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "iteration-map-file.hpp"
+#include "mapped-file.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+
+static const uint32_t file_magic   = 0x4d49424d;  // "MBIM"
+static const uint32_t file_version = 2;
+
+struct File_header
+{
+	uint32_t magic;
+	uint32_t version;
+	int32_t	 width, height;
+	int32_t	 tile_size;
+	uint32_t tile_count;
+
+	// Render_params without the Julia parameter, the main view never renders Julia sets
+	glm::dvec2 center, center_lo, size;
+	int32_t	   max_iter, palette_cycle;
+
+	int32_t precision, formula, coloring;
+	int32_t unroll, bailout_interval;
+	int32_t periodicity, derivative;
+	int32_t reserved;
+};
+
+struct Tile_entry
+{
+	uint64_t offset;
+	uint32_t length;
+	uint32_t reserved;
+};
+
+static_assert(sizeof(File_header) == 112);
+static_assert(sizeof(Tile_entry) == 16);
+
+static void write_varint(std::vector<uint8_t>& out, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(uint8_t(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(uint8_t(value));
+}
+
+// Returns false past the end of the payload or on an overlong encoding
+static bool read_varint(const uint8_t*& in, const uint8_t* end, uint32_t& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		if (in == end) return false;
+
+		const uint8_t byte = *in++;
+		value |= uint32_t(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) return true;
+	}
+	return false;
+}
+
+static uint32_t zigzag(uint32_t delta)
+{
+	return (delta << 1) ^ uint32_t(int32_t(delta) >> 31);
+}
+
+static uint32_t unzigzag(uint32_t value)
+{
+	return (value >> 1) ^ (0u - (value & 1));
+}
+
+// Pixels of a tile of the region, in row-major order
+template <typename F> static void for_each_tile_pixel(const Iteration_map_image& image, int tile, F&& f)
+{
+	const int tiles_x = (image.width + iteration_map_tile_size - 1) / iteration_map_tile_size;
+	const int x0 = tile % tiles_x * iteration_map_tile_size, y0 = tile / tiles_x * iteration_map_tile_size;
+	const int x1 = std::min(x0 + iteration_map_tile_size, image.width),
+			  y1 = std::min(y0 + iteration_map_tile_size, image.height);
+
+	for (int y = y0; y < y1; y++)
+		for (int x = x0; x < x1; x++) f((size_t)y * image.width + x);
+}
+
+static std::vector<uint8_t> encode_tile(const Iteration_map_image& image, int tile)
+{
+	std::vector<uint8_t> out;
+
+	for (int channel = 0; channel < 2; channel++)
+	{
+		uint32_t previous = 0, zero_run = 0;
+
+		for_each_tile_pixel(image,
+							tile,
+							[&](size_t index)
+							{
+								const uint32_t bits = std::bit_cast<uint32_t>(image.map[index][channel]);
+								const uint32_t delta = bits - previous;
+								previous			 = bits;
+
+								if (delta == 0)
+								{
+									zero_run++;
+									return;
+								}
+
+								if (zero_run > 0)
+								{
+									write_varint(out, 0);
+									write_varint(out, zero_run - 1);
+									zero_run = 0;
+								}
+								write_varint(out, zigzag(delta));
+							});
+
+		if (zero_run > 0)
+		{
+			write_varint(out, 0);
+			write_varint(out, zero_run - 1);
+		}
+	}
+
+	return out;
+}
+
+static bool decode_tile(Iteration_map_image& image, int tile, const uint8_t* in, const uint8_t* end)
+{
+	for (int channel = 0; channel < 2; channel++)
+	{
+		uint32_t previous = 0, zero_run = 0;
+		bool	 valid	  = true;
+
+		for_each_tile_pixel(image,
+							tile,
+							[&](size_t index)
+							{
+								if (!valid) return;
+
+								if (zero_run == 0)
+								{
+									uint32_t value;
+									if (!read_varint(in, end, value))
+									{
+										valid = false;
+										return;
+									}
+
+									if (value == 0)
+									{
+										if (!read_varint(in, end, zero_run))
+										{
+											valid = false;
+											return;
+										}
+										zero_run++;
+									}
+									else
+										previous += unzigzag(value);
+								}
+
+								if (zero_run > 0) zero_run--;
+
+								image.map[index][channel] = std::bit_cast<float>(previous);
+							});
+
+		// A run may not spill over into the next channel
+		if (!valid || zero_run != 0) return false;
+	}
+
+	return in == end;
+}
+
+static int get_tile_count(int width, int height)
+{
+	return ((width + iteration_map_tile_size - 1) / iteration_map_tile_size)
+		 * ((height + iteration_map_tile_size - 1) / iteration_map_tile_size);
+}
+
+Result<size_t, std::string> save_iteration_map(const std::filesystem::path& path,
+											   const Iteration_map_image&	image,
+											   Thread_pool&					pool)
+{
+	if (image.width <= 0 || image.height <= 0 || image.map.size() != (size_t)image.width * image.height)
+		return std::string("Iteration map doesn't match its size");
+
+	const int tile_count = get_tile_count(image.width, image.height);
+
+	std::vector<std::vector<uint8_t>> payloads(tile_count);
+	pool.run(tile_count, [&](size_t tile, unsigned int) { payloads[tile] = encode_tile(image, (int)tile); });
+
+	const auto& variant = image.variant;
+
+	const File_header header{
+		.magic			  = file_magic,
+		.version		  = file_version,
+		.width			  = image.width,
+		.height			  = image.height,
+		.tile_size		  = iteration_map_tile_size,
+		.tile_count		  = (uint32_t)tile_count,
+		.center			  = image.params.center,
+		.center_lo		  = image.params.center_lo,
+		.size			  = image.params.size,
+		.max_iter		  = image.params.max_iter,
+		.palette_cycle	  = image.params.palette_cycle,
+		.precision		  = (int32_t)variant.precision,
+		.formula		  = (int32_t)variant.formula,
+		.coloring		  = (int32_t)variant.coloring,
+		.unroll			  = variant.unroll,
+		.bailout_interval = variant.bailout_interval,
+		.periodicity	  = variant.periodicity,
+		.derivative		  = variant.derivative,
+		.reserved		  = 0,
+	};
+
+	std::vector<Tile_entry> entries(tile_count);
+	uint64_t				offset = sizeof(File_header) + sizeof(Tile_entry) * tile_count;
+	for (int tile = 0; tile < tile_count; tile++)
+	{
+		entries[tile] = {offset, (uint32_t)payloads[tile].size(), 0};
+		offset += payloads[tile].size();
+	}
+
+	// Write to a temporary file first, so that a crash never leaves a truncated file behind
+	auto temp_path = path;
+	temp_path += ".tmp";
+
+	bool written;
+
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) return std::format("Can't create {}", temp_path.string());
+
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)entries.data(), (std::streamsize)(entries.size() * sizeof(Tile_entry)));
+		for (const auto& payload : payloads)
+			file.write((const char*)payload.data(), (std::streamsize)payload.size());
+
+		file.close();
+		written = !file.fail();
+	}
+
+	// Don't leave the partial temporary file behind
+	std::error_code err;
+	if (!written)
+	{
+		std::filesystem::remove(temp_path, err);
+		return std::format("Can't write {}", temp_path.string());
+	}
+
+	std::filesystem::rename(temp_path, path, err);
+	if (err)
+	{
+		const auto message = err.message();
+		std::filesystem::remove(temp_path, err);
+		return std::format("Can't replace {}: {}", path.string(), message);
+	}
+
+	return (size_t)offset;
+}
+
+Result<Iteration_map_image, std::string> load_iteration_map(const std::filesystem::path& path,
+															Thread_pool&				 pool)
+{
+	auto mapped = Mapped_file::open(path);
+	if (!mapped.ok()) return mapped.get_err();
+
+	const auto file = mapped.get();
+	const auto* data = (const uint8_t*)file.data();
+
+	File_header header;
+	if (file.size() < sizeof(header)) return std::format("{} is truncated", path.string());
+	std::memcpy(&header, data, sizeof(header));
+
+	if (header.magic != file_magic) return std::format("{} is not an iteration map", path.string());
+	if (header.version != file_version)
+		return std::format("{} has unsupported version {}", path.string(), header.version);
+
+	if (header.width <= 0 || header.height <= 0 || header.tile_size != iteration_map_tile_size
+		|| header.tile_count != (uint32_t)get_tile_count(header.width, header.height))
+		return std::format("{} has an invalid header", path.string());
+
+	// The fields become enums and kernel switches, only the values the settings offer are valid
+	const auto in_range = [](int32_t value, auto first, auto last)
+	{ return value >= (int32_t)first && value <= (int32_t)last; };
+	const auto one_of = [](int32_t value, std::initializer_list<int32_t> values)
+	{ return std::ranges::find(values, value) != values.end(); };
+
+	if (!in_range(header.precision, Kernel_precision::Fp32, Kernel_precision::Fixed128)
+		|| !in_range(header.formula, Kernel_formula::Mandelbrot, Kernel_formula::Multibrot8)
+		|| !in_range(header.coloring, Kernel_coloring::Iteration, Kernel_coloring::Distance)
+		|| !one_of(header.unroll, {1, 2, 4, 8}) || !one_of(header.bailout_interval, {1, 4, 8, 16}))
+		return std::format("{} has an invalid kernel variant", path.string());
+
+	const size_t directory_end = sizeof(File_header) + sizeof(Tile_entry) * header.tile_count;
+	if (file.size() < directory_end) return std::format("{} is truncated", path.string());
+
+	std::vector<Tile_entry> entries(header.tile_count);
+	std::memcpy(entries.data(), data + sizeof(File_header), sizeof(Tile_entry) * header.tile_count);
+
+	for (const auto& entry : entries)
+		if (entry.offset < directory_end || entry.offset > file.size()
+			|| entry.length > file.size() - entry.offset)
+			return std::format("{} is truncated", path.string());
+
+	Iteration_map_image image;
+	image.params					= {.center		  = header.center,
+									   .size		  = header.size,
+									   .max_iter	  = header.max_iter,
+									   .palette_cycle = header.palette_cycle,
+									   .center_lo	  = header.center_lo};
+	image.variant.precision			= (Kernel_precision)header.precision;
+	image.variant.formula			= (Kernel_formula)header.formula;
+	image.variant.coloring			= (Kernel_coloring)header.coloring;
+	image.variant.unroll			= header.unroll;
+	image.variant.bailout_interval	= header.bailout_interval;
+	image.variant.periodicity		= header.periodicity != 0;
+	image.variant.derivative		= header.derivative != 0;
+	image.width						= header.width;
+	image.height					= header.height;
+	image.map.resize((size_t)header.width * header.height);
+
+	std::atomic<bool> corrupt = false;
+	pool.run(entries.size(),
+			 [&](size_t tile, unsigned int)
+			 {
+				 const auto* begin = data + entries[tile].offset;
+				 if (!decode_tile(image, (int)tile, begin, begin + entries[tile].length)) corrupt = true;
+			 });
+
+	if (corrupt) return std::format("{} has a corrupt tile", path.string());
+
+	return image;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "julia-preview.hpp"
+
+Julia_preview::Julia_preview()
+{
+	target.stream_data(size, size, GL_RGB8);
+	target.set_filter(GL_LINEAR, GL_LINEAR);
+	target.set_wrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+}
+
+void Julia_preview::update(Gpu_renderer&		 renderer,
+						   const Kernel_variant& variant,
+						   const Texture1d&		 palette,
+						   int					 palette_cycle,
+						   glm::dvec2			 c)
+{
+	const auto now = std::chrono::steady_clock::now();
+
+	if (region == 0 || c != this->c || variant != this->variant || palette_cycle != this->palette_cycle)
+	{
+		this->c				= c;
+		this->variant		= variant;
+		this->palette_cycle = palette_cycle;
+		moved				= now;
+		refined				= false;
+
+		render(renderer, palette, Kernel_precision::Fp32, size / preview_divisor, preview_iter);
+		return;
+	}
+
+	if (!refined && now - moved >= refine_delay)
+	{
+		refined = true;
+		render(renderer, palette, Kernel_precision::Fp64, size, refined_iter);
+	}
+}
+
+void Julia_preview::render(Gpu_renderer&	renderer,
+						   const Texture1d& palette,
+						   Kernel_precision precision,
+						   int				resolution,
+						   int				max_iter)
+{
+	auto julia		= variant;
+	julia.formula	= Kernel_formula::Julia;
+	julia.precision = precision;
+
+	const Render_params params{
+		.center		   = {0.0, 0.0},
+		.size		   = {extent, extent},
+		.max_iter	   = max_iter,
+		.palette_cycle = palette_cycle,
+		.julia_c	   = c,
+	};
+
+	renderer.render(params, julia, Gpu_backend::Fragment, target, palette, resolution, resolution);
+	region = resolution;
+}
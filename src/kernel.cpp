@@ -0,0 +1,183 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "kernel.hpp"
+#include "formula.hpp"
+#include "resources.hpp"
+
+Shader_variant_cache::Defines Kernel_variant::defines() const
+{
+	Shader_variant_cache::Defines defines;
+
+	switch (precision)
+	{
+	case Kernel_precision::Fp32:
+		defines.emplace_back("PRECISION_FP32", "");
+		break;
+	case Kernel_precision::Fp64:
+		defines.emplace_back("PRECISION_FP64", "");
+		break;
+	case Kernel_precision::Double_double:
+		defines.emplace_back("PRECISION_DD", "");
+		break;
+	case Kernel_precision::Fixed128:
+		defines.emplace_back("PRECISION_FIXED", "");
+		break;
+	}
+
+	switch (formula)
+	{
+	case Kernel_formula::Mandelbrot:
+		defines.emplace_back("FORMULA_MANDELBROT", "");
+		break;
+	case Kernel_formula::Julia:
+		defines.emplace_back("FORMULA_JULIA", "");
+		break;
+	case Kernel_formula::Burning_ship:
+		defines.emplace_back("FORMULA_BURNING_SHIP", "");
+		break;
+	case Kernel_formula::Tricorn:
+		defines.emplace_back("FORMULA_TRICORN", "");
+		break;
+	default:
+		defines.emplace_back("FORMULA_MULTIBROT", "");
+		break;
+	}
+
+	const auto& formula_defines = formulas::dispatch(
+		formula,
+		[]<typename Formula>() -> const Shader_variant_cache::Defines&
+		{
+			return formulas::glsl_defines<Formula>();
+		});
+	defines.insert(defines.end(), formula_defines.begin(), formula_defines.end());
+
+	switch (coloring)
+	{
+	case Kernel_coloring::Iteration:
+		defines.emplace_back("COLORING_ITERATION", "");
+		break;
+	case Kernel_coloring::Smooth:
+		defines.emplace_back("COLORING_SMOOTH", "");
+		break;
+	case Kernel_coloring::Distance:
+		defines.emplace_back("COLORING_DISTANCE", "");
+		break;
+	}
+
+	defines.emplace_back("UNROLL", std::to_string(unroll));
+	defines.emplace_back("BAILOUT_INTERVAL", std::to_string(bailout_interval));
+
+	if (periodicity) defines.emplace_back("FEATURE_PERIODICITY", "");
+	if (derivative || coloring == Kernel_coloring::Distance)
+		defines.emplace_back("FEATURE_DERIVATIVE", "");
+
+	return defines;
+}
+
+const char* Kernel_variant::name(Kernel_precision precision)
+{
+	switch (precision)
+	{
+	case Kernel_precision::Fp32:
+		return "FP32";
+	case Kernel_precision::Fp64:
+		return "FP64";
+	case Kernel_precision::Double_double:
+		return "Double-double";
+	case Kernel_precision::Fixed128:
+		return "Fixed-point 128";
+	}
+
+	return "Unknown";
+}
+
+const char* Kernel_variant::name(Kernel_formula formula)
+{
+	switch (formula)
+	{
+	case Kernel_formula::Mandelbrot:
+		return "Mandelbrot";
+	case Kernel_formula::Julia:
+		return "Julia";
+	case Kernel_formula::Burning_ship:
+		return "Burning Ship";
+	case Kernel_formula::Tricorn:
+		return "Tricorn";
+	case Kernel_formula::Multibrot3:
+		return "Multibrot 3";
+	case Kernel_formula::Multibrot4:
+		return "Multibrot 4";
+	case Kernel_formula::Multibrot5:
+		return "Multibrot 5";
+	case Kernel_formula::Multibrot6:
+		return "Multibrot 6";
+	case Kernel_formula::Multibrot7:
+		return "Multibrot 7";
+	case Kernel_formula::Multibrot8:
+		return "Multibrot 8";
+	}
+
+	return "Unknown";
+}
+
+const char* Kernel_variant::name(Kernel_coloring coloring)
+{
+	switch (coloring)
+	{
+	case Kernel_coloring::Iteration:
+		return "Iteration";
+	case Kernel_coloring::Smooth:
+		return "Smooth";
+	case Kernel_coloring::Distance:
+		return "Distance Estimation";
+	}
+
+	return "Unknown";
+}
+
+bool Kernel_variant::is_conjugate_symmetric(Kernel_formula formula)
+{
+	switch (formula)
+	{
+	case Kernel_formula::Mandelbrot:
+		return true;
+	case Kernel_formula::Julia:
+		return false;  // Symmetric about the origin instead, and about the real axis for real c
+	case Kernel_formula::Burning_ship:
+		return false;  // The fold takes |Im z|, conjugate orbits part after the first step
+	default:
+		return true;  // Tricorn and Multibrot steps commute with conjugation
+	}
+}
+
+bool Kernel_variant::supports_perturbation(Kernel_formula formula)
+{
+	return formula == Kernel_formula::Mandelbrot;
+}
+
+std::string compose_kernel_stage(const std::string& stage_source)
+{
+	const auto version_end = stage_source.find('\n');
+	if (!stage_source.starts_with("#version") || version_end == std::string::npos)
+		throw std::runtime_error("Kernel stage must start with a #version line");
+
+	// Source string 1 is the shared body, 0 the stage itself
+	return stage_source.substr(0, version_end + 1) + "#line 1 1\n"
+		 + resources::to_string(resources::file_shaders_kernel_glsl_) + "\n#line 2 0\n"
+		 + stage_source.substr(version_end + 1);
+}
\ No newline at end of file
@@ -17,112 +17,753 @@
 #include "logic.hpp"
 #include "quad.hpp"
 #include "resources.hpp"
+#include "simd.hpp"
+
+void Mandelbrot_coord::move(glm::dvec2 offset)
+{
+	// Two-sum of the leading parts, its rounding error joins the trailing part and the pair is
+	// normalised again
+	const glm::dvec2 sum	  = center + offset;
+	const glm::dvec2 bits	  = sum - center;
+	const glm::dvec2 error	  = (center - (sum - bits)) + (offset - bits);
+	const glm::dvec2 trailing = center_lo + error;
+
+	center	  = sum + trailing;
+	center_lo = trailing - (center - sum);
+}
+
+void Logic_handler::select_variant(const Kernel_variant& variant)
+{
+	try
+	{
+		gpu_renderer.prepare(variant);
+	}
+	catch (const std::exception&)
+	{
+		return;
+	}
+
+	kernel_variant = variant;
+	update_time	   = std::chrono::steady_clock::now();
+}
+
+void Logic_handler::prepare_neighbour_variants()
+{
+	if (gpu_worker == nullptr || prepared_neighbours == kernel_variant) return;
+	prepared_neighbours = kernel_variant;
+
+	const Kernel_precision precisions[] = {Kernel_precision::Fp32,
+										   Kernel_precision::Fp64,
+										   Kernel_precision::Double_double,
+										   Kernel_precision::Fixed128};
+
+	const int current
+		= (int)(std::ranges::find(precisions, kernel_variant.precision) - std::begin(precisions));
+
+	for (const int neighbour : {current - 1, current + 1})
+	{
+		if (neighbour < 0 || neighbour >= (int)std::size(precisions)) continue;
+		if (!Gpu_renderer::supports(precisions[neighbour])) continue;
+
+		auto variant	  = kernel_variant;
+		variant.precision = precisions[neighbour];
+
+		// One task per variant, frames don't wait for more than one
+		gpu_worker->submit_task(
+			[variant](Gpu_renderer& renderer, std::stop_token stop)
+			{
+				if (stop.stop_requested()) return;
+
+				try
+				{
+					renderer.prepare(variant);
+				}
+				catch (const std::exception&)
+				{
+					// Logged by prepare(), a switch to the variant fails again on the UI thread
+				}
+			});
+	}
+}
+
+void Logic_handler::run_benchmark()
+{
+	const int runs = 10;
+
+	const Render_params params = get_render_params(display_coord, height);
+
+	// The current backend in every precision the context runs, before the backends so that the
+	// frame left on screen is the one of the current variant
+	precision_benchmark_result.clear();
+	for (auto precision : {Kernel_precision::Fp32,
+						   Kernel_precision::Fp64,
+						   Kernel_precision::Double_double,
+						   Kernel_precision::Fixed128})
+	{
+		if (!Gpu_renderer::supports(precision)) continue;
+
+		auto variant	  = kernel_variant;
+		variant.precision = precision;
+
+		try
+		{
+			gpu_renderer.prepare(variant);
+		}
+		catch (const std::exception&)
+		{
+			continue;
+		}
+
+		float time = gpu_renderer.benchmark(params,
+											variant,
+											gpu_backend,
+											mandelbrot_buffer,
+											palette_texture,
+											width,
+											height,
+											runs);
+		precision_benchmark_result.emplace_back(precision, time);
+
+		logger.log(Logger::Info, "Benchmark {}: {:.2f}ms", Kernel_variant::name(precision), time);
+	}
+
+	benchmark_result.clear();
+	for (auto backend : {Gpu_backend::Fragment, Gpu_backend::Compute, Gpu_backend::Compaction})
+	{
+		float time = gpu_renderer.benchmark(params,
+											kernel_variant,
+											backend,
+											mandelbrot_buffer,
+											palette_texture,
+											width,
+											height,
+											runs);
+		benchmark_result.emplace_back(backend, time);
+
+		logger.log(Logger::Info, "Benchmark {}: {:.2f}ms", get_backend_name(backend), time);
+	}
+
+	show_frame(*mandelbrot_buffer, params, {width, height}, {width, height});
+	update_time = std::chrono::steady_clock::now();
+}
+
+void Logic_handler::run_thumbnail_benchmark()
+{
+	const Render_params params = get_render_params(display_coord, height);
+
+	// Square cells of a grid across the view, row by row
+	const int  columns = (int)std::ceil(std::sqrt((double)thumbnail_count));
+	const auto cell	   = params.size.x / columns;
+
+	std::vector<Render_params> views;
+	for (int i = 0; i < thumbnail_count; i++)
+	{
+		const glm::dvec2 position = {i % columns + 0.5, i / columns + 0.5};
+
+		views.push_back({
+			.center		   = params.center - params.size / 2.0 + position * cell,
+			.size		   = {cell, cell},
+			.max_iter	   = params.max_iter,
+			.palette_cycle = params.palette_cycle,
+		});
+	}
+
+	// Batches reuse one array, 128x128 RGBA8 thumbnails take 64kB per layer
+	const int batch_size = std::min(512, Gpu_renderer::get_max_batch_size());
+
+	const auto for_each_batch = [batch_size](std::span<const Render_params> views,
+											 std::stop_token				stop,
+											 const auto&					render)
+	{
+		for (size_t first = 0; first < views.size() && !stop.stop_requested(); first += batch_size)
+			render(views.subspan(first, std::min<size_t>(batch_size, views.size() - first)));
+	};
+
+	const auto& palette = palette_texture;
+	const auto	variant = kernel_variant;
+
+	auto gpu_part = [views, variant, batch_size, for_each_batch, &palette](
+						Gpu_renderer& renderer, std::stop_token stop)
+	{
+		const int size = thumbnail_size;
+
+		Texture2d_array thumbnails;
+		thumbnails.stream_data(size, size, batch_size, GL_RGBA8, GL_RGBA);
+
+		Texture2d thumbnail;
+		thumbnail.stream_data(size, size, GL_RGBA8, GL_RGBA);
+
+		// Wall clock around glFinish(), long batches overflow the 32-bit query result
+		const auto time_ms = [](const auto& run)
+		{
+			glFinish();
+			const auto start = std::chrono::steady_clock::now();
+			run();
+			glFinish();
+			const auto end = std::chrono::steady_clock::now();
+
+			return std::chrono::duration<float, std::milli>(end - start).count();
+		};
+
+		// Warm up, so that lazy compilation doesn't count
+		renderer.render_batch(std::span(views).first(1), variant, thumbnails, palette, size, size);
+
+		const float batch_ms = time_ms(
+			[&]
+			{
+				for_each_batch(views,
+							   stop,
+							   [&](std::span<const Render_params> batch)
+							   {
+								   renderer.render_batch(
+									   batch, variant, thumbnails, palette, size, size);
+							   });
+			});
+
+		// Straight into the thumbnail, not through the iteration map
+		renderer.keep_map = false;
+
+		const float single_ms = time_ms(
+			[&]
+			{
+				for (const auto& view : views)
+				{
+					if (stop.stop_requested()) break;
+
+					renderer.render(
+						view, variant, Gpu_backend::Fragment, thumbnail, palette, size, size);
+				}
+			});
+
+		return Thumbnail_benchmark{
+			.gpu_batch_ms  = batch_ms,
+			.gpu_single_ms = single_ms,
+			.cpu_batch_ms  = 0,
+			.batch_size	   = batch_size,
+		};
+	};
+
+	// The maps only, colorizing them needs a GL context
+	thumbnail_benchmark_cpu_part = [views, variant, for_each_batch](Cpu_renderer&	renderer,
+																	std::stop_token stop)
+	{
+		std::vector<glm::vec2> maps;
+
+		const auto start = std::chrono::steady_clock::now();
+		for_each_batch(views,
+					   stop,
+					   [&](std::span<const Render_params> batch)
+					   {
+						   renderer.render_batch(
+							   batch, variant, thumbnail_size, thumbnail_size, maps, stop);
+					   });
+		const auto end = std::chrono::steady_clock::now();
+
+		return std::chrono::duration<float, std::milli>(end - start).count();
+	};
+
+	if (gpu_worker != nullptr)
+		thumbnail_benchmark_gpu = gpu_worker->submit_task(std::move(gpu_part));
+	else
+	{
+		// No worker context, on the UI thread
+		std::packaged_task<Thumbnail_benchmark(Gpu_renderer&, std::stop_token)> task(
+			std::move(gpu_part));
+		thumbnail_benchmark_gpu = task.get_future();
+		task(gpu_renderer, {});
+	}
+}
+
+void Logic_handler::collect_thumbnail_benchmark()
+{
+	const auto ready = [](const auto& future)
+	{
+		return future.valid()
+			&& future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	};
+
+	if (ready(thumbnail_benchmark_gpu) && thumbnail_benchmark_cpu_part != nullptr)
+	{
+		thumbnail_benchmark_cpu = render_service.submit_task(std::move(thumbnail_benchmark_cpu_part));
+		thumbnail_benchmark_cpu_part = nullptr;
+	}
+
+	if (!ready(thumbnail_benchmark_gpu) || !ready(thumbnail_benchmark_cpu)) return;
+
+	auto result			= thumbnail_benchmark_gpu.get();
+	result.cpu_batch_ms = thumbnail_benchmark_cpu.get();
+
+	thumbnail_benchmark_result = result;
+
+	logger.log(Logger::Info,
+			   "Thumbnail benchmark, {} of {}x{}: GPU batches {:.1f}ms, one by one {:.1f}ms, CPU "
+			   "batches {:.1f}ms",
+			   thumbnail_count,
+			   thumbnail_size,
+			   thumbnail_size,
+			   result.gpu_batch_ms,
+			   result.gpu_single_ms,
+			   result.cpu_batch_ms);
+}
+
+void Logic_handler::zoom_to_nucleus()
+{
+	const auto	 params		= get_render_params(manipulate_coord, height);
+	const int	 max_period = params.max_iter;
+	const double radius		= glm::length(params.size) / 2;
+	const int	 limbs		= Fixed_real::limbs_for_spacing(params.size.x / width);
+	const auto	 center
+		= Fixed_complex::from_double_double(params.center, params.center_lo, limbs);
+
+	std::promise<Nucleus_search> promise;
+	nucleus_search = promise.get_future();
+
+	nucleus_search_thread = std::jthread(
+		[promise = std::move(promise), center, radius, max_period](std::stop_token stop) mutable
+		{
+			const auto start   = std::chrono::steady_clock::now();
+			auto	   nucleus = find_nearest_nucleus(center, radius, max_period, stop);
+			const auto end	   = std::chrono::steady_clock::now();
+
+			promise.set_value({
+				.nucleus	= std::move(nucleus),
+				.max_period = max_period,
+				.time_ms	= std::chrono::duration<float, std::milli>(end - start).count(),
+			});
+		});
+}
+
+void Logic_handler::collect_nucleus_search()
+{
+	if (!nucleus_search.valid()
+		|| nucleus_search.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return;
+
+	const auto search = nucleus_search.get();
+
+	zoom_nucleus	= search.nucleus;
+	zoom_nucleus_ms = search.time_ms;
+
+	if (!zoom_nucleus.has_value())
+	{
+		logger.log(Logger::Warning, "No nucleus found in view within {} iterations", search.max_period);
+		return;
+	}
+
+	logger.log(Logger::Info,
+			   "Nucleus of period {} after {} Newton steps, {:.1f}ms",
+			   zoom_nucleus->period,
+			   zoom_nucleus->newton_steps,
+			   zoom_nucleus_ms);
+
+	const auto [center, center_lo] = zoom_nucleus->center.to_double_double();
+
+	// The double-double center is off the nucleus by about 2^-106 of its magnitude, minibrots
+	// smaller than that are framed at the depth where they stay in view
+	const double resolution = std::ldexp(std::max(std::abs(center.x), std::abs(center.y)), -96);
+
+	manipulate_coord.center	   = center;
+	manipulate_coord.center_lo = center_lo;
+	manipulate_coord.width	   = std::max(zoom_nucleus->size * 3, resolution);
+	update_time				   = std::chrono::steady_clock::now();
+}
 
 void Logic_handler::update_view()
 {
 	using namespace std::chrono_literals;
 	auto& io = ImGui::GetIO();
 
+	interacting = false;
+
 	if (!io.WantCaptureMouse)
 	{
 		auto drag = ImGui::GetMouseDragDelta(0);
 
 		if (drag.x != 0 || drag.y != 0)
 		{
+			// Consumed every frame, the view is re-rendered while dragging
+			ImGui::ResetMouseDragDelta(0);
+
 			update_time = std::chrono::steady_clock::now() + 200ms;
+			interacting = true;
 
 			double aspect_ratio = (double)width / height;
-			double delta_x		= display_coord.width * drag.x / width,
-				   delta_y		= display_coord.width / aspect_ratio * drag.y / height;
+			double delta_x		= manipulate_coord.width * drag.x / width,
+				   delta_y		= manipulate_coord.width / aspect_ratio * drag.y / height;
 
-			manipulate_coord
-				= {{display_coord.center.x - delta_x, display_coord.center.y - delta_y},
-				   display_coord.width};
+			manipulate_coord.move(-glm::dvec2(delta_x, delta_y));
 		}
 		else if (io.MouseWheel != 0.0)
 		{
 			update_time = std::chrono::steady_clock::now() + 200ms;
+			interacting = true;
 
 			float step
 				= ImGui::IsKeyDown(ImGuiKey_ModCtrl) ? small_step_multiplier : big_step_multiplier;
 
 			float mul = pow(0.8f, step * io.MouseWheel);
 
-			auto [mouse_x, mouse_y] = io.MousePos;
-
-			mouse_x = (mouse_x - width * 0.5) / width;
-			mouse_y = (mouse_y - height * 0.5) / width;
-
-			glm::dvec2 mouse_center
-				= manipulate_coord.center + glm::dvec2(mouse_x, mouse_y) * manipulate_coord.width;
+			// Keep the point under the mouse in place
+			const glm::dvec2 mouse_offset = screen_to_offset(manipulate_coord, io.MousePos);
 
 			manipulate_coord.width *= mul;
-			manipulate_coord.center
-				= mouse_center + (manipulate_coord.center - mouse_center) * (double)mul;
+			manipulate_coord.move(mouse_offset * (1.0 - mul));
 		}
 
-		manipulate_coord.center
+		// A clamped coordinate drops its trailing part, which was relative to the old one
+		const auto clamped
 			= glm::clamp(manipulate_coord.center, glm::dvec2(-2.0, -1.5), glm::dvec2(0.5, 1.5));
-		manipulate_coord.width = glm::clamp(manipulate_coord.width, 0.0, 5.0);
+		for (int i = 0; i < 2; i++)
+			if (clamped[i] != manipulate_coord.center[i]) manipulate_coord.center_lo[i] = 0;
+
+		manipulate_coord.center = clamped;
+		manipulate_coord.width	= glm::clamp(manipulate_coord.width, 0.0, 5.0);
 	}
 }
 
-void Logic_handler::render_view()
+glm::dvec2 Logic_handler::screen_to_complex(const Mandelbrot_coord& coord, ImVec2 position) const
+{
+	return coord.center + screen_to_offset(coord, position);
+}
+
+glm::dvec2 Logic_handler::screen_to_offset(const Mandelbrot_coord& coord, ImVec2 position) const
+{
+	const glm::dvec2 offset = {(position.x - width * 0.5) / width, (position.y - height * 0.5) / width};
+	return offset * coord.width;
+}
+
+void Logic_handler::update_julia_preview()
+{
+	if (!julia_preview_enabled || kernel_variant.formula != Kernel_formula::Mandelbrot || width == 0
+		|| height == 0)
+		return;
+
+	// Over a window the preview holds the last point, and refines it
+	const auto& io = ImGui::GetIO();
+	const auto	c  = io.WantCaptureMouse || !ImGui::IsMousePosValid()
+					   ? julia_preview.get_c()
+					   : screen_to_complex(manipulate_coord, io.MousePos);
+
+	julia_preview.update(gpu_renderer, kernel_variant, palette_texture, palette_cycle, c);
+}
+
+Render_params Logic_handler::get_render_params(const Mandelbrot_coord& coord,
+											   int					   region_height) const
+{
+	const int iteration = manual_iter_enabled ? manual_max_iter : iteration_controller.get_max_iter();
+
+	glm::dvec2 center	 = coord.center;
+	glm::dvec2 center_lo = coord.center_lo;
+	glm::dvec2 size		 = {coord.width, coord.width * height / width};
+
+	// Only views around the axis have rows to mirror, their snapped center is exact in double
+	if (real_axis_symmetry && std::abs(center.y) < size.y)
+	{
+		center		= snap_center_to_axis(center, size.y, region_height);
+		center_lo.y = 0;
+	}
+
+	return {
+		.center		   = center,
+		.size		   = size,
+		.max_iter	   = iteration,
+		.palette_cycle = palette_cycle,
+		.center_lo	   = center_lo,
+	};
+}
+
+Precision_tier Logic_handler::select_precision(const Render_params& params, int region_width)
 {
-	if (update_time.has_value())
+	const bool can_perturb = Kernel_variant::supports_perturbation(kernel_variant.formula);
+
+	if (!automatic_precision)
+		return cpu_render ? (perturbation && can_perturb ? Precision_tier::Perturbation : Precision_tier::Fp64)
+						  : get_precision_tier(kernel_variant.precision);
+
+	// The CPU engine iterates in double, perturbation is its only deeper tier
+	std::vector<Precision_tier> tiers = {Precision_tier::Fp64};
+	if (!cpu_render)
+	{
+		tiers = {Precision_tier::Fp32, Precision_tier::Fp64, Precision_tier::Double_double};
+		if (Gpu_renderer::supports(Kernel_precision::Fixed128)) tiers.push_back(Precision_tier::Fixed128);
+	}
+	if (can_perturb) tiers.push_back(Precision_tier::Perturbation);
+
+	const auto tier = precision_selector.select(params, region_width, tiers);
+
+	auto variant	  = kernel_variant;
+	variant.precision = get_kernel_precision(tier);
+
+	if (variant != kernel_variant)
 	{
-		if (std::chrono::steady_clock::now() > update_time)
+		try
 		{
-			update_time = std::nullopt;
+			gpu_renderer.prepare(variant);
+			kernel_variant = variant;
+		}
+		catch (const std::exception&)
+		{
+			// Logged by prepare(), the current precision stays
+			return get_precision_tier(kernel_variant.precision);
+		}
+	}
+
+	return tier;
+}
+
+void Logic_handler::request_render(bool interactive)
+{
+	const float scale		  = governor.get_scale(interactive);
+	const int	region_width  = std::max(1, (int)std::round(width * scale));
+	const int	region_height = std::max(1, (int)std::round(height * scale));
+
+	precision_tier = select_precision(get_render_params(manipulate_coord, region_height), region_width);
+	prepare_neighbour_variants();
+
+	auto params = get_render_params(manipulate_coord, region_height);
+
+	// Settled frames probe for their limit on the render thread. Interactive frames keep the
+	// limit of the last settled view, probing every frame would make the limit, and with it the
+	// colors, flicker while dragging. The probe iterates in double, past FP64 all of its pixels
+	// fall on the same points, so deeper views keep the last limit too.
+	std::optional<Iteration_controller> probe;
+	if (!interactive && !manual_iter_enabled
+		&& (precision_tier == Precision_tier::Fp32 || precision_tier == Precision_tier::Fp64))
+		probe = iteration_controller;
+
+	if (!interactive)
+	{
+		if (probe.has_value())
+			logger.log(Logger::Info, "Repainting, probing the iteration limit");
+		else
+			logger.log(Logger::Info, "Repainting, iteration={}", params.max_iter);
+	}
 
-			timer.start();
+	if (cpu_render || precision_tier == Precision_tier::Perturbation)
+	{
+		cpu_request = {
+			.params				  = params,
+			.variant			  = kernel_variant,
+			.width				  = region_width,
+			.height				  = region_height,
+			.interactive		  = interactive,
+			.scale				  = scale,
+			.use_symmetry		  = real_axis_symmetry,
+			.certify_tiles		  = certify_tiles,
+			.adaptive_limits	  = adaptive_limits,
+			.perturbation		  = precision_tier == Precision_tier::Perturbation,
+			.nucleus_reference	  = nucleus_reference,
+			.iteration_controller = probe,
+		};
 
-			display_coord = manipulate_coord;
+		render_service.submit(cpu_request);
+		return;
+	}
 
-			framebuffer.link(mandelbrot_buffer);
-			framebuffer.bind();
+	if (gpu_worker != nullptr)
+	{
+		gpu_worker->submit({
+			.params				  = params,
+			.variant			  = kernel_variant,
+			.backend			  = gpu_backend,
+			.width				  = region_width,
+			.height				  = region_height,
+			.target_width		  = width,
+			.target_height		  = height,
+			.interactive		  = interactive,
+			.scale				  = scale,
+			.use_symmetry		  = real_axis_symmetry,
+			.persistent_groups	  = gpu_renderer.persistent_groups,
+			.batch_iterations	  = gpu_renderer.batch_iterations,
+			// The CPU rows of a hybrid frame are iterated in double, splitting FP32 frames would
+			// leave a seam at the split, and the GPU outruns the CPU by far at FP32 anyway
+			.hybrid				  = hybrid_render && precision_tier == Precision_tier::Fp64,
+			.certify_tiles		  = certify_tiles,
+			.adaptive_limits	  = adaptive_limits,
+			.iteration_controller = probe,
+		});
+		return;
+	}
 
-			glViewport(0, 0, width / display_ratio, height / display_ratio);
+	// No worker context, render on the UI thread
+	if (probe.has_value()) params.max_iter = iteration_controller.update(params, kernel_variant);
+	gpu_renderer.use_symmetry = real_axis_symmetry;
+	gpu_renderer.keep_map	  = !interactive;
 
-			mandelbrot_shader.use();
-			palette_texture.bind_slot(0);
+	timer.start();
+	gpu_renderer.render(params,
+						kernel_variant,
+						gpu_backend,
+						mandelbrot_buffer,
+						palette_texture,
+						region_width,
+						region_height);
+	util::check_err("render_view");
+	timer.end();
 
-			// compute max iteration, special thanks to devs at mandelbrot.silversky.dev
-			// const w_45 = widthInUnits / 4.5;
-			// const depth = Math.min(180 - 50 * Math.log(w_45) / Math.log(2), 2000);
+	// The Julia preview renders with the same renderer
+	gpu_renderer.keep_map = false;
 
-			double w_45		 = display_coord.width / 4.5;
-			int	   iteration = manual_iter_enabled
-								 ? manual_max_iter	// Use manual iteration count
-								 : (int)glm::clamp(180 - 50 * log(w_45) / log(2),
-												   4.0,
-												   2000.0);	 // use auto iteration count
+	if (!interactive)
+	{
+		settled_map = Iteration_map_image{
+			.params	 = params,
+			.variant = kernel_variant,
+			.width	 = region_width,
+			.height	 = region_height,
+			.map	 = {},
+		};
+		settled_map_buffer = gpu_renderer.copy_map(region_width, region_height);
+	}
 
-			// setup uniforms
-			glUniform1i(mandelbrot_shader["palette"], 0);
-			glUniform1i(mandelbrot_shader["palette_cycle"], palette_cycle);
-			glUniform2d(
-				mandelbrot_shader["center"], display_coord.center.x, display_coord.center.y);
-			glUniform2d(mandelbrot_shader["size"],
-						display_coord.width,
-						display_coord.width * height / width);
-			glUniform1i(mandelbrot_shader["max_iter"], iteration);
+	glFlush();
+	prev_time_elapsed = timer.get_ns() / 1e6f;
 
-			logger.log(Logger::Info, "Repainting, iteration={}", iteration);
+	show_frame(*mandelbrot_buffer, params, {region_width, region_height}, {width, height});
+	if (gpu_backend == Gpu_backend::Compaction)
+		compaction_history = gpu_renderer.read_compaction_history();
 
-			Quad_mesh().draw();
-			util::check_err("5");
-			Framebuffer::unbind();
-			timer.end();
+	governor.report(scale, prev_time_elapsed, interactive);
+	precision_selector.report(precision_tier, prev_time_elapsed, region_width * region_height);
+}
 
-			glFlush();
-			prev_time_elapsed = timer.get_ns() / 1e6f;
+void Logic_handler::collect_gpu_render()
+{
+	auto result = gpu_worker->poll();
+	if (!result.has_value()) return;
+
+	const auto& request = result->request;
+
+	if (request.iteration_controller.has_value())
+		iteration_controller.take_result(*request.iteration_controller);
+
+	show_frame(gpu_worker->get_front(),
+			   request.params,
+			   {request.width, request.height},
+			   {request.target_width, request.target_height});
+
+	prev_time_elapsed  = result->time_ms;
+	compaction_history = std::move(result->compaction_history);
+	hybrid_stats	   = result->hybrid;
+
+	if (result->map.has_value())
+	{
+		settled_map = Iteration_map_image{
+			.params	 = request.params,
+			.variant = request.variant,
+			.width	 = request.width,
+			.height	 = request.height,
+			.map	 = {},
+		};
+		settled_map_buffer = std::move(result->map);
+	}
+
+	governor.report(request.scale, prev_time_elapsed, request.interactive);
+	if (!request.hybrid)
+		precision_selector.report(get_precision_tier(request.variant.precision),
+								  prev_time_elapsed,
+								  request.width * request.height);
+}
+
+void Logic_handler::show_frame(GLuint				  texture,
+							   const Render_params& params,
+							   glm::ivec2			  region_size,
+							   glm::ivec2			  target_size)
+{
+	display_texture		= texture;
+	display_coord		= {params.center, params.center_lo, params.size.x};
+	render_width		= region_size.x;
+	render_height		= region_size.y;
+	display_target_size = target_size;
+}
+
+void Logic_handler::collect_cpu_render()
+{
+	auto result = render_service.poll();
+	if (!result.has_value()) return;
+
+	const auto& request = result->request;
+
+	if (request.iteration_controller.has_value())
+		iteration_controller.take_result(*request.iteration_controller);
+
+	gpu_renderer.present(request.params,
+						 request.variant,
+						 result->map.data(),
+						 mandelbrot_buffer,
+						 palette_texture,
+						 request.width,
+						 request.height);
+	util::check_err("collect_cpu_render");
+
+	show_frame(*mandelbrot_buffer,
+			   request.params,
+			   {request.width, request.height},
+			   {width, height});
+
+	cpu_stats		  = result->stats;
+	prev_time_elapsed = cpu_stats.time_ms;
+
+	governor.report(request.scale, prev_time_elapsed, request.interactive);
+	if (request.perturbation)
+		precision_selector.report(Precision_tier::Perturbation,
+								  prev_time_elapsed,
+								  request.width * request.height);
+
+	if (!request.interactive)
+	{
+		logger.log(Logger::Info,
+				   "CPU render: {:.1f}ms, lane utilisation {:.1f}%",
+				   prev_time_elapsed,
+				   cpu_stats.lanes.utilisation() * 100);
+
+		settled_map = Iteration_map_image{
+			.params	 = request.params,
+			.variant = request.variant,
+			.width	 = request.width,
+			.height	 = request.height,
+			.map	 = std::move(result->map),
+		};
+		settled_map_buffer.reset();
+	}
+}
+
+void Logic_handler::render_view()
+{
+	// Interactive frames are rendered right away at the governed scale, the full-resolution
+	// frame follows once input has been idle until `update_time`
+	const bool settled = update_time.has_value() && std::chrono::steady_clock::now() > update_time;
+
+	// Engine of the last request
+	const bool cpu_engine = cpu_render || precision_tier == Precision_tier::Perturbation;
+
+	// Before submitting anything, which would drop a finished result
+	if (cpu_engine)
+		collect_cpu_render();
+	else if (gpu_worker != nullptr)
+		collect_gpu_render();
+
+	if (width != 0 && height != 0 && (interacting || settled))
+	{
+		// Any newer view cancels a render still in progress on the CPU, except that a preview is
+		// left to finish before the next one, or previews slower than the frame interval would
+		// never show up while dragging
+		const bool wait_for_preview
+			= cpu_engine && interacting && cpu_request.interactive && render_service.busy();
+
+		if (!wait_for_preview)
+		{
+			if (settled) update_time = std::nullopt;
+			request_render(interacting);
 		}
 	}
 
+	// Relative to the manipulated center, deep centers only differ below the ulp of double
+	const glm::dvec2 display_offset = (display_coord.center - manipulate_coord.center)
+									+ (display_coord.center_lo - manipulate_coord.center_lo);
+
 	glm::dmat4 forward_matrix(1.0);
 
-	forward_matrix = glm::translate(forward_matrix, glm::dvec3(manipulate_coord.center, 0.0));
 	forward_matrix = glm::scale(forward_matrix, glm::dvec3(manipulate_coord.width / 2));
 	forward_matrix = glm::scale(forward_matrix, glm::dvec3(2.0 / width, 2.0 / width, 1));
 	forward_matrix = glm::translate(forward_matrix, glm::dvec3(-width / 2, -height / 2, 0));
@@ -130,22 +771,27 @@ void Logic_handler::render_view()
 	glm::dmat4 inverse_matrix = glm::inverse(forward_matrix);
 
 	glm::dvec4 top_left = inverse_matrix
-						* glm::dvec4(display_coord.center
+						* glm::dvec4(display_offset
 										 - glm::dvec2(display_coord.width / 2,
 													  display_coord.width * height / width / 2),
 									 0,
 									 1);
 	glm::dvec4 bottom_right = inverse_matrix
-							* glm::dvec4(display_coord.center
+							* glm::dvec4(display_offset
 											 + glm::dvec2(display_coord.width / 2,
 														  display_coord.width * height / width / 2),
 										 0,
 										 1);
 
+	if (display_texture == 0) return;
+
 	auto* draw_list = ImGui::GetBackgroundDrawList();
-	draw_list->AddImage(reinterpret_cast<ImTextureID>(*mandelbrot_buffer),
+	draw_list->AddImage(reinterpret_cast<ImTextureID>(display_texture),
 						{(float)top_left.x, (float)top_left.y},
-						{(float)bottom_right.x, (float)bottom_right.y});
+						{(float)bottom_right.x, (float)bottom_right.y},
+						{0.0f, 0.0f},
+						{(float)render_width / display_target_size.x,
+						 (float)render_height / display_target_size.y});
 }
 
 void Logic_handler::render_imgui()
@@ -165,11 +811,360 @@ void Logic_handler::render_imgui()
 	{
 		ImGui::Text("Zoom %.3ex", 2.0 / manipulate_coord.width);
 		ImGui::SameLine(0.0, 50.0);
-		ImGui::Text(
-			"%.1fms (%.2fms/MP)", prev_time_elapsed, prev_time_elapsed / width / height * 1e6);
+		ImGui::Text("%d iterations%s",
+					manual_iter_enabled ? manual_max_iter : iteration_controller.get_max_iter(),
+					manual_iter_enabled ? "" : " (auto)");
+		ImGui::SameLine(0.0, 50.0);
+		{
+			const double headroom = Precision_selector::get_headroom(precision_tier,
+																	 get_render_params(manipulate_coord, height),
+																	 width);
+			const float	 cost	  = precision_selector.get_cost(precision_tier);
+
+			if (headroom < Precision_selector::guard_bits)
+				ImGui::TextColored({1.0f, 0.6f, 0.2f, 1.0f},
+								   "%s%s, precision exhausted (%.1f bits)",
+								   get_tier_name(precision_tier),
+								   automatic_precision ? " (auto)" : "",
+								   headroom);
+			else if (cost > 0)
+				ImGui::Text("%s%s, %.1f bits spare, %.2fms/MP",
+							get_tier_name(precision_tier),
+							automatic_precision ? " (auto)" : "",
+							headroom,
+							cost);
+			else
+				ImGui::Text("%s%s, %.1f bits spare",
+							get_tier_name(precision_tier),
+							automatic_precision ? " (auto)" : "",
+							headroom);
+		}
+		ImGui::SameLine(0.0, 50.0);
+		ImGui::Text("%.1fms (%.2fms/MP)",
+					prev_time_elapsed,
+					prev_time_elapsed / render_width / render_height * 1e6);
+		ImGui::SameLine(0.0, 50.0);
+		ImGui::Text("Budget %.0fms, scale %.0f%% (%dx%d), %d/%d missed",
+					governor.target_ms,
+					governor.get_interactive_scale() * 100,
+					render_width,
+					render_height,
+					governor.get_miss_count(),
+					governor.get_interactive_frame_count());
+
+		if (hybrid_render && !cpu_render && hybrid_stats.has_value())
+		{
+			ImGui::SameLine(0.0, 50.0);
+			ImGui::Text("Split GPU %.0f%% / CPU %.0f%%",
+						hybrid_stats->gpu_share * 100,
+						(1 - hybrid_stats->gpu_share) * 100);
+		}
 	}
 	ImGui::End();
 	ImGui::PopStyleVar(2);
+
+	// Kernel Settings
+	if (ImGui::Begin("Kernel"))
+	{
+		auto variant = kernel_variant;
+
+		auto enum_combo = [](const char* label, auto& value, auto... options)
+		{
+			if (ImGui::BeginCombo(label, Kernel_variant::name(value)))
+			{
+				for (auto option : {options...})
+					if (ImGui::Selectable(Kernel_variant::name(option), option == value))
+						value = option;
+				ImGui::EndCombo();
+			}
+		};
+
+		if (ImGui::Checkbox("Automatic Precision", &automatic_precision))
+			update_time = std::chrono::steady_clock::now();
+
+		ImGui::BeginDisabled(automatic_precision);
+		if (Gpu_renderer::supports(Kernel_precision::Fixed128))
+			enum_combo("Precision",
+					   variant.precision,
+					   Kernel_precision::Fp32,
+					   Kernel_precision::Fp64,
+					   Kernel_precision::Double_double,
+					   Kernel_precision::Fixed128);
+		else
+			enum_combo("Precision",
+					   variant.precision,
+					   Kernel_precision::Fp32,
+					   Kernel_precision::Fp64,
+					   Kernel_precision::Double_double);
+		ImGui::EndDisabled();
+		enum_combo("Formula",
+				   variant.formula,
+				   Kernel_formula::Mandelbrot,
+				   Kernel_formula::Burning_ship,
+				   Kernel_formula::Tricorn,
+				   Kernel_formula::Multibrot3,
+				   Kernel_formula::Multibrot4,
+				   Kernel_formula::Multibrot5,
+				   Kernel_formula::Multibrot6,
+				   Kernel_formula::Multibrot7,
+				   Kernel_formula::Multibrot8);
+		enum_combo("Coloring",
+				   variant.coloring,
+				   Kernel_coloring::Iteration,
+				   Kernel_coloring::Smooth,
+				   Kernel_coloring::Distance);
+
+		if (ImGui::BeginCombo("Unroll", std::to_string(variant.unroll).c_str()))
+		{
+			for (int unroll : {1, 2, 4, 8})
+				if (ImGui::Selectable(std::to_string(unroll).c_str(), unroll == variant.unroll))
+					variant.unroll = unroll;
+			ImGui::EndCombo();
+		}
+
+		if (ImGui::BeginCombo("Bailout Interval", std::to_string(variant.bailout_interval).c_str()))
+		{
+			for (int interval : {1, 4, 8, 16})
+				if (ImGui::Selectable(std::to_string(interval).c_str(),
+									  interval == variant.bailout_interval))
+					variant.bailout_interval = interval;
+			ImGui::EndCombo();
+		}
+
+		ImGui::Checkbox("Periodicity Checking", &variant.periodicity);
+		ImGui::Checkbox("Derivatives", &variant.derivative);
+
+		if (variant != kernel_variant) select_variant(variant);
+
+		ImGui::SeparatorText("Iterations");
+
+		if (ImGui::Checkbox("Manual Iterations", &manual_iter_enabled))
+			update_time = std::chrono::steady_clock::now();
+
+		if (manual_iter_enabled)
+		{
+			if (ImGui::InputInt("Max Iterations", &manual_max_iter, 64, 1024))
+			{
+				manual_max_iter = glm::clamp(manual_max_iter, 1, iteration_controller.max_iter_limit);
+				update_time		= std::chrono::steady_clock::now();
+			}
+		}
+		else
+		{
+			if (ImGui::SliderFloat("Unresolved Target",
+								   &iteration_controller.target_fraction,
+								   0.0005f,
+								   0.05f,
+								   "%.4f",
+								   ImGuiSliderFlags_Logarithmic))
+				update_time = std::chrono::steady_clock::now();
+
+			ImGui::Text("Unresolved boundary: %.2f%%", iteration_controller.get_unresolved_fraction() * 100);
+		}
+
+		ImGui::SeparatorText("Navigation");
+
+		// Nuclei and Julia sets are those of z^2 + c
+		ImGui::BeginDisabled(kernel_variant.formula != Kernel_formula::Mandelbrot);
+		if (ImGui::Button("Zoom to Nearest Minibrot")) zoom_to_nucleus();
+		if (nucleus_search.valid())
+		{
+			ImGui::SameLine();
+			if (ImGui::Button("Cancel"))
+			{
+				nucleus_search_thread.request_stop();
+				nucleus_search = {};
+			}
+			else
+				ImGui::TextUnformatted("Searching...");
+		}
+		else if (zoom_nucleus.has_value())
+			ImGui::Text("Period %d, %d Newton steps, %.1fms",
+						zoom_nucleus->period,
+						zoom_nucleus->newton_steps,
+						zoom_nucleus_ms);
+
+		ImGui::Checkbox("Julia Preview", &julia_preview_enabled);
+		ImGui::EndDisabled();
+
+		ImGui::SeparatorText("Backend");
+
+		if (ImGui::BeginCombo("GPU Backend", get_backend_name(gpu_backend)))
+		{
+			for (auto backend : {Gpu_backend::Fragment, Gpu_backend::Compute, Gpu_backend::Compaction})
+				if (ImGui::Selectable(get_backend_name(backend), backend == gpu_backend))
+				{
+					gpu_backend = backend;
+					update_time = std::chrono::steady_clock::now();
+				}
+			ImGui::EndCombo();
+		}
+
+		if (gpu_backend == Gpu_backend::Compute
+			&& ImGui::SliderInt("Persistent Groups", &gpu_renderer.persistent_groups, 16, 1024))
+			update_time = std::chrono::steady_clock::now();
+
+		if (gpu_backend == Gpu_backend::Compaction)
+		{
+			if (ImGui::SliderInt("Batch Iterations", &gpu_renderer.batch_iterations, 8, 1024))
+				update_time = std::chrono::steady_clock::now();
+
+			if (!compaction_history.empty())
+			{
+				std::vector<float> active(compaction_history.begin(), compaction_history.end());
+				ImGui::PlotHistogram("Active Pixels",
+									 active.data(),
+									 (int)active.size(),
+									 0,
+									 nullptr,
+									 0.0f,
+									 FLT_MAX,
+									 ImVec2(0, 60));
+			}
+		}
+
+		if (ImGui::Checkbox("Real-axis Symmetry", &real_axis_symmetry))
+			update_time = std::chrono::steady_clock::now();
+
+		ImGui::SliderFloat("Frame Budget", &governor.target_ms, 4.0f, 100.0f, "%.0fms");
+
+		if (ImGui::Button("Benchmark")) run_benchmark();
+		for (const auto& [backend, time] : benchmark_result)
+			ImGui::Text("%s: %.2fms", get_backend_name(backend), time);
+		for (const auto& [precision, time] : precision_benchmark_result)
+			ImGui::Text("%s: %.2fms", Kernel_variant::name(precision), time);
+
+		const bool thumbnail_benchmark_running
+			= thumbnail_benchmark_gpu.valid() || thumbnail_benchmark_cpu.valid();
+
+		ImGui::BeginDisabled(thumbnail_benchmark_running);
+		if (ImGui::Button("Thumbnail Benchmark")) run_thumbnail_benchmark();
+		ImGui::EndDisabled();
+
+		if (thumbnail_benchmark_running)
+		{
+			ImGui::SameLine();
+			ImGui::TextUnformatted("Running...");
+		}
+		else if (thumbnail_benchmark_result.has_value())
+		{
+			const auto& result = *thumbnail_benchmark_result;
+			ImGui::Text("%d thumbnails of %dx%d, batches of %d",
+						thumbnail_count,
+						thumbnail_size,
+						thumbnail_size,
+						result.batch_size);
+			ImGui::Text("GPU batches: %.0fms, %.0f/s",
+						result.gpu_batch_ms,
+						thumbnail_count * 1000.0 / result.gpu_batch_ms);
+			ImGui::Text("GPU one by one: %.0fms, %.0f/s",
+						result.gpu_single_ms,
+						thumbnail_count * 1000.0 / result.gpu_single_ms);
+			ImGui::Text("CPU batches: %.0fms, %.0f/s",
+						result.cpu_batch_ms,
+						thumbnail_count * 1000.0 / result.cpu_batch_ms);
+		}
+
+		ImGui::SeparatorText("CPU");
+
+		if (ImGui::Checkbox("Render on CPU", &cpu_render))
+			update_time = std::chrono::steady_clock::now();
+
+		if (gpu_worker != nullptr && !cpu_render)
+		{
+			if (ImGui::Checkbox("Hybrid CPU+GPU (FP64)", &hybrid_render))
+				update_time = std::chrono::steady_clock::now();
+
+			if (hybrid_render && hybrid_stats.has_value())
+				ImGui::Text("Split at row %d/%d, GPU %.1fms, CPU %.1fms",
+							hybrid_stats->split_row,
+							hybrid_stats->height,
+							hybrid_stats->gpu_ms,
+							hybrid_stats->cpu_ms);
+		}
+
+		ImGui::Text("%u threads, %d-wide %s lanes",
+					cpu_renderer.get_thread_count(),
+					simd::width,
+					simd::hardware ? "AVX" : "scalar");
+		ImGui::Text("Lane utilisation: %.1f%%", cpu_stats.lanes.utilisation() * 100);
+		ImGui::Text("%d tiles, %d mirrored rows", cpu_stats.tile_count, cpu_stats.mirrored_rows);
+
+		ImGui::Text("%llu renders cancelled", (unsigned long long)render_service.get_cancelled_count());
+
+		if (ImGui::Checkbox("Certify Tiles", &certify_tiles))
+			update_time = std::chrono::steady_clock::now();
+		ImGui::Text("Certified area: %.1f%% (interior %.1f%%, escaped %.1f%%)",
+					cpu_stats.certified_fraction() * 100,
+					cpu_stats.pixel_count ? 100.0 * cpu_stats.certified_interior_pixels / cpu_stats.pixel_count
+										  : 0.0,
+					cpu_stats.pixel_count ? 100.0 * cpu_stats.certified_escaped_pixels / cpu_stats.pixel_count
+										  : 0.0);
+
+		if (ImGui::Checkbox("Adaptive Tile Limits", &adaptive_limits))
+			update_time = std::chrono::steady_clock::now();
+		ImGui::Text("%d of %d tiles with reduced limits", cpu_stats.limited_tiles, cpu_stats.tile_count);
+
+		ImGui::BeginDisabled(automatic_precision || !Kernel_variant::supports_perturbation(kernel_variant.formula));
+		if (ImGui::Checkbox("Perturbation", &perturbation)) update_time = std::chrono::steady_clock::now();
+		ImGui::EndDisabled();
+
+		if (ImGui::Checkbox("Nucleus Reference", &nucleus_reference))
+			update_time = std::chrono::steady_clock::now();
+
+		if (precision_tier == Precision_tier::Perturbation && cpu_stats.reference.has_value())
+		{
+			const auto& reference = *cpu_stats.reference;
+			ImGui::Text("Reference: %d iterations, %.1fms", reference.length, cpu_stats.reference_ms);
+			if (cpu_stats.nucleus.has_value())
+				ImGui::Text("Nucleus of period %d, %d Newton steps, %.1fpx from the center",
+							cpu_stats.nucleus->period,
+							cpu_stats.nucleus->newton_steps,
+							cpu_stats.reference_distance);
+			else
+				ImGui::Text("No nucleus, %.1fpx from the center", cpu_stats.reference_distance);
+			ImGui::Text("Rebases: %.3f per pixel",
+						cpu_stats.pixel_count ? (double)cpu_stats.lanes.rebases / cpu_stats.pixel_count : 0.0);
+			if (reference.mapped_bytes != 0)
+				ImGui::Text("Mapped from the store, %.1fMB", reference.mapped_bytes / 1048576.0);
+			else
+				ImGui::Text("Segments: %d/%d resident, %.1fMB, %llu regenerated",
+							reference.resident_segments,
+							reference.segment_count,
+							reference.resident_bytes / 1048576.0,
+							(unsigned long long)reference.regenerated_segments);
+
+			const auto store = reference_store.get_stats();
+			ImGui::Text("Store: %llu hits, %llu extended, %llu computed",
+						(unsigned long long)store.hits,
+						(unsigned long long)store.extensions,
+						(unsigned long long)store.misses);
+		}
+	}
+	ImGui::End();
+
+	if (julia_preview_enabled && kernel_variant.formula == Kernel_formula::Mandelbrot)
+	{
+		if (ImGui::Begin("Julia Preview", &julia_preview_enabled, ImGuiWindowFlags_AlwaysAutoResize))
+		{
+			const float image_size = Julia_preview::size * content_scale;
+			const auto	uv		   = julia_preview.get_uv_extent();
+			const auto	c		   = julia_preview.get_c();
+
+			if (julia_preview.get_texture() != 0)
+				ImGui::Image(reinterpret_cast<ImTextureID>(julia_preview.get_texture()),
+							 {image_size, image_size},
+							 {0.0f, 0.0f},
+							 {uv.x, uv.y});
+
+			ImGui::Text("c = %.8f %+.8fi", c.x, c.y);
+			ImGui::Text("%dx%d, %s",
+						julia_preview.get_resolution(),
+						julia_preview.get_resolution(),
+						julia_preview.is_refined() ? "FP64" : "FP32 preview");
+		}
+		ImGui::End();
+	}
 }
 
 void Logic_handler::update(int width, int height)
@@ -179,33 +1174,28 @@ void Logic_handler::update(int width, int height)
 		this->width	 = width;
 		this->height = height;
 
-		if (width != 0 && height != 0)
-			mandelbrot_buffer.stream_data(width / display_ratio, height / display_ratio, GL_RGB8);
+		if (width != 0 && height != 0) mandelbrot_buffer.stream_data(width, height, GL_RGB8);
 
-		update_time = std::chrono::steady_clock::now();
+		// A restored view of the same size needs no render
+		if (restored_size == glm::ivec2(width, height))
+			update_time = std::nullopt;
+		else
+			update_time = std::chrono::steady_clock::now();
+		restored_size.reset();
 
-		logger.log(
-			Logger::Info, "Resized buffer: {}x{}px", width / display_ratio, height / display_ratio);
+		logger.log(Logger::Info, "Resized buffer: {}x{}px", width, height);
 	}
 
+	collect_nucleus_search();
+	collect_thumbnail_benchmark();
 	update_view();
 	render_view();
+	update_julia_preview();
 	render_imgui();
 }
 
-Logic_handler::Logic_handler(float content_scale) :
-	mandelbrot_shader([]() -> Shader {
-		auto result
-			= Shader::create_shader(resources::to_string(resources::file_shaders_common_vert_),
-									resources::to_string(resources::file_shaders_generator_frag_));
-		if (!result.ok())
-		{
-			logger.log(Logger::Error, "Shader Error:\n{}", result.get_err());
-			throw std::runtime_error("Shader Error: " + result.get_err());
-		}
-
-		return result.get();
-	}()),
+Logic_handler::Logic_handler(GLFWwindow* window, float content_scale) :
+	gpu_renderer(program_cache),
 	content_scale(content_scale)
 {
 	mandelbrot_buffer.set_filter(GL_LINEAR, GL_LINEAR);
@@ -215,4 +1205,111 @@ Logic_handler::Logic_handler(float content_scale) :
 	palette_texture.set_wrap(GL_CLAMP_TO_EDGE);
 
 	set_palette(palette_list[0]);
+
+	cpu_renderer.reference_store = &reference_store;
+
+	const auto start = std::chrono::steady_clock::now();
+	gpu_renderer.prepare(kernel_variant);
+	logger.log(Logger::Info,
+			   "Kernel programs ready in {:.1f}ms",
+			   std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start)
+				   .count());
+
+	// The worker samples the palette from its own context, make sure it is complete
+	glFinish();
+
+	try
+	{
+		gpu_worker = std::make_unique<Gpu_render_worker>(window, palette_texture);
+	}
+	catch (const std::exception&)
+	{
+		logger.log(Logger::Warning, "GPU backends render on the UI thread");
+	}
+
+	restore_session();
+}
+
+Logic_handler::~Logic_handler()
+{
+	save_session();
+}
+
+void Logic_handler::restore_session()
+{
+	if (!std::filesystem::exists(session_path)) return;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	Thread_pool pool;
+	auto		loaded = load_iteration_map(session_path, pool);
+	if (!loaded.ok())
+	{
+		logger.log(Logger::Warning, "Can't restore session: {}", loaded.get_err());
+		return;
+	}
+
+	const auto image = loaded.get();
+
+	select_variant(image.variant);
+	if (kernel_variant != image.variant) return;
+
+	manipulate_coord = {image.params.center, image.params.center_lo, image.params.size.x};
+	iteration_controller.set_max_iter(image.params.max_iter);
+	palette_cycle = image.params.palette_cycle;
+
+	restored_texture.set_filter(GL_LINEAR, GL_LINEAR);
+	restored_texture.set_wrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+	restored_texture.stream_data(image.width, image.height, GL_RGB8);
+
+	gpu_renderer.present(image.params,
+						 image.variant,
+						 image.map.data(),
+						 restored_texture,
+						 palette_texture,
+						 image.width,
+						 image.height);
+	util::check_err("restore_session");
+
+	show_frame(*restored_texture,
+			   image.params,
+			   {image.width, image.height},
+			   {image.width, image.height});
+	restored_size = {image.width, image.height};
+
+	logger.log(Logger::Info,
+			   "Restored {}x{} session in {:.1f}ms",
+			   image.width,
+			   image.height,
+			   std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start)
+				   .count());
+}
+
+void Logic_handler::save_session()
+{
+	if (!settled_map.has_value())
+	{
+		logger.log(Logger::Info, "No settled frame, session not saved");
+		return;
+	}
+
+	auto& image = *settled_map;
+	if (settled_map_buffer.has_value())
+	{
+		// Worker frames are collected once their fence has signalled, the read waits for frames
+		// of this context
+		image.map = Gpu_renderer::read_map_buffer(*settled_map_buffer, image.width, image.height);
+		settled_map_buffer.reset();
+		util::check_err("save_session");
+	}
+
+	Thread_pool pool;
+	auto		saved = save_iteration_map(session_path, image, pool);
+	if (!saved.ok())
+	{
+		logger.log(Logger::Warning, "Can't save session: {}", saved.get_err());
+		return;
+	}
+
+	logger.log(Logger::Info, "Saved session, {} bytes", saved.get());
 }
\ No newline at end of file
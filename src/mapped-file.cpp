@@ -0,0 +1,130 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mapped-file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+#include <utility>
+
+Result<Mapped_file, std::string> Mapped_file::open(const std::filesystem::path& path)
+{
+	Mapped_file file;
+
+#ifdef _WIN32
+	file.file_handle = CreateFileW(path.c_str(),
+								   GENERIC_READ,
+								   FILE_SHARE_READ,
+								   nullptr,
+								   OPEN_EXISTING,
+								   FILE_ATTRIBUTE_NORMAL,
+								   nullptr);
+	if (file.file_handle == INVALID_HANDLE_VALUE)
+	{
+		file.file_handle = nullptr;
+		return std::format("Can't open {}", path.string());
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file.file_handle, &size)) return std::format("Can't stat {}", path.string());
+	file.length = (size_t)size.QuadPart;
+	if (file.length == 0) return file;
+
+	file.mapping_handle = CreateFileMappingW(file.file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (file.mapping_handle == nullptr) return std::format("Can't map {}", path.string());
+
+	file.view = (const std::byte*)MapViewOfFile(file.mapping_handle, FILE_MAP_READ, 0, 0, 0);
+	if (file.view == nullptr) return std::format("Can't map {}", path.string());
+#else
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return std::format("Can't open {}: {}", path.string(), std::strerror(errno));
+
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		::close(fd);
+		return std::format("Can't stat {}: {}", path.string(), std::strerror(errno));
+	}
+
+	file.length = (size_t)info.st_size;
+	if (file.length == 0)
+	{
+		::close(fd);
+		return file;
+	}
+
+	// The mapping keeps its own reference to the file
+	void* view = mmap(nullptr, file.length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+
+	if (view == MAP_FAILED) return std::format("Can't map {}: {}", path.string(), std::strerror(errno));
+	file.view = (const std::byte*)view;
+#endif
+
+	return file;
+}
+
+Mapped_file::Mapped_file(Mapped_file&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+Mapped_file& Mapped_file::operator=(Mapped_file&& other) noexcept
+{
+	if (this == &other) return *this;
+
+	close();
+
+	view   = std::exchange(other.view, nullptr);
+	length = std::exchange(other.length, 0);
+#ifdef _WIN32
+	file_handle	   = std::exchange(other.file_handle, nullptr);
+	mapping_handle = std::exchange(other.mapping_handle, nullptr);
+#endif
+
+	return *this;
+}
+
+Mapped_file::~Mapped_file()
+{
+	close();
+}
+
+void Mapped_file::close()
+{
+#ifdef _WIN32
+	if (view != nullptr) UnmapViewOfFile(view);
+	if (mapping_handle != nullptr) CloseHandle(mapping_handle);
+	if (file_handle != nullptr) CloseHandle(file_handle);
+	mapping_handle = file_handle = nullptr;
+#else
+	if (view != nullptr) munmap((void*)view, length);
+#endif
+
+	view   = nullptr;
+	length = 0;
+}
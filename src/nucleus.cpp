@@ -0,0 +1,130 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include "nucleus.hpp"
+#include "reference-orbit.hpp"
+
+#include <cmath>
+
+namespace
+{
+glm::dvec2 complex_mul(glm::dvec2 a, glm::dvec2 b)
+{
+	return {a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x};
+}
+
+glm::dvec2 complex_div(glm::dvec2 a, glm::dvec2 b)
+{
+	return complex_mul(a, {b.x, -b.y}) / glm::dot(b, b);
+}
+
+bool is_finite(glm::dvec2 value)
+{
+	return std::isfinite(value.x) && std::isfinite(value.y);
+}
+}
+
+std::optional<int> find_period(const Fixed_complex& center,
+							   double				radius,
+							   int					max_period,
+							   std::stop_token		stop)
+{
+	Fixed_complex z{Fixed_real(center.x.get_limbs()), Fixed_real(center.x.get_limbs())};
+	glm::dvec2	  dz(0.0);
+
+	for (int n = 1; n <= max_period; n++)
+	{
+		if (n % 1024 == 0 && stop.stop_requested()) return std::nullopt;
+
+		dz = 2.0 * complex_mul(z.to_double(), dz) + glm::dvec2(1.0, 0.0);
+		z  = z.step(center);
+
+		const auto value = z.to_double();
+		const auto norm2 = glm::dot(value, value);
+
+		if (norm2 >= Reference_orbit::escape_radius2 || !is_finite(dz)) return std::nullopt;
+		if (norm2 < radius * radius * glm::dot(dz, dz)) return n;
+	}
+
+	return std::nullopt;
+}
+
+std::optional<Nucleus> find_nucleus(const Fixed_complex& guess,
+									int					 period,
+									int					 max_steps,
+									std::stop_token		 stop)
+{
+	const int limbs = guess.x.get_limbs();
+
+	// Truncation in every product moves the step by up to about `period` units of the last
+	// fraction bit, steps below that only follow the noise
+	const double noise = std::ldexp((double)period, -64 * (limbs - 1)) * 4;
+
+	Nucleus nucleus{.center = guess, .period = period};
+
+	for (int step = 1; step <= max_steps; step++)
+	{
+		if (stop.stop_requested()) return std::nullopt;
+
+		// dz/dc of the iterates, and the size estimate terms of their product along the orbit
+		Fixed_complex z{Fixed_real(limbs), Fixed_real(limbs)};
+		glm::dvec2	  dz(0.0), product(1.0, 0.0), reciprocals(1.0, 0.0);
+
+		for (int n = 0; n < period; n++)
+		{
+			const auto value = z.to_double();
+			if (glm::dot(value, value) >= Reference_orbit::escape_radius2) return std::nullopt;
+
+			if (n > 0)
+			{
+				product		= 2.0 * complex_mul(value, product);
+				reciprocals += complex_div({1.0, 0.0}, product);
+			}
+
+			dz = 2.0 * complex_mul(value, dz) + glm::dvec2(1.0, 0.0);
+			z  = z.step(nucleus.center);
+		}
+
+		if (!is_finite(dz) || glm::dot(dz, dz) == 0) return std::nullopt;
+
+		const auto delta = complex_div(z.to_double(), dz);
+
+		nucleus.center		 = {nucleus.center.x - Fixed_real::from_double(delta.x, limbs),
+								nucleus.center.y - Fixed_real::from_double(delta.y, limbs)};
+		nucleus.newton_steps = step;
+		nucleus.size		 = 1.0 / glm::length(reciprocals) / glm::dot(product, product);
+
+		// An iterate before `period` at zero leaves the size undefined, the orbit has a
+		// shorter period dividing `period`
+		if (glm::length(delta) <= noise)
+			return std::isfinite(nucleus.size) ? std::optional(nucleus) : std::nullopt;
+	}
+
+	return std::nullopt;
+}
+
+std::optional<Nucleus> find_nearest_nucleus(const Fixed_complex& center,
+											double				 radius,
+											int					 max_period,
+											std::stop_token		 stop)
+{
+	const auto period = find_period(center, radius, max_period, stop);
+	if (!period.has_value()) return std::nullopt;
+
+	return find_nucleus(center, *period, 64, stop);
+}
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "point-stream.hpp"
+
+#include <stdexcept>
+
+namespace
+{
+// Buffers of one chunk streamed through the GPU, and their host views: the persistent mappings
+// when available, else host arrays copied to and from the buffers
+class Gpu_chunk
+{
+  public:
+	Gpu_chunk(size_t capacity, const Point_outputs& outputs);
+	Gpu_chunk(const Gpu_chunk&) = delete;
+	~Gpu_chunk();
+
+	double*		  x = nullptr;
+	double*		  y = nullptr;
+	Point_results results;
+
+	uint64_t first = 0;
+	size_t	 count = 0;
+
+	// Evaluate the `count` points written to `x` and `y`
+	void submit(Gpu_renderer& renderer, const Kernel_variant& variant, int max_iter);
+
+	// Wait for the GPU, making the results readable through `results`
+	void wait();
+
+  private:
+	Buffer			  x_buffer, y_buffer, iterations_buffer, z_x_buffer, z_y_buffer, distance_buffer;
+	Gpu_point_results buffers;
+	bool			  mapped = false;
+	GLsync			  fence	 = nullptr;
+
+	std::vector<double>	 host_x, host_y, host_z_x, host_z_y, host_distance;
+	std::vector<int32_t> host_iterations;
+};
+
+Gpu_chunk::Gpu_chunk(size_t capacity, const Point_outputs& outputs) :
+	mapped(GLEW_ARB_buffer_storage)
+{
+	// Attach `buffer` to the host array `data` of `capacity` elements
+	const auto attach = [&]<typename T>(const Buffer& buffer, T*& data, std::vector<T>& host, GLbitfield access)
+	{
+		const auto size = GLsizeiptr(capacity * sizeof(T));
+
+		if (mapped)
+		{
+			data = (T*)buffer.map_storage(size, access);
+			if (data == nullptr) throw std::runtime_error("Failed to map point buffer");
+		}
+		else
+		{
+			buffer.stream_data(size, access == GL_MAP_WRITE_BIT ? GL_STREAM_DRAW : GL_STREAM_READ);
+			host.resize(capacity);
+			data = host.data();
+		}
+	};
+
+	attach(x_buffer, x, host_x, GL_MAP_WRITE_BIT);
+	attach(y_buffer, y, host_y, GL_MAP_WRITE_BIT);
+
+	if (outputs.iterations)
+	{
+		attach(iterations_buffer, results.iterations, host_iterations, GL_MAP_READ_BIT);
+		buffers.iterations = &iterations_buffer;
+	}
+
+	if (outputs.z)
+	{
+		attach(z_x_buffer, results.z_x, host_z_x, GL_MAP_READ_BIT);
+		attach(z_y_buffer, results.z_y, host_z_y, GL_MAP_READ_BIT);
+		buffers.z_x = &z_x_buffer;
+		buffers.z_y = &z_y_buffer;
+	}
+
+	if (outputs.distance)
+	{
+		attach(distance_buffer, results.distance, host_distance, GL_MAP_READ_BIT);
+		buffers.distance = &distance_buffer;
+	}
+}
+
+Gpu_chunk::~Gpu_chunk()
+{
+	if (fence != nullptr) glDeleteSync(fence);
+}
+
+void Gpu_chunk::submit(Gpu_renderer& renderer, const Kernel_variant& variant, int max_iter)
+{
+	if (!mapped)
+	{
+		x_buffer.update(0, GLsizeiptr(count * sizeof(double)), x);
+		y_buffer.update(0, GLsizeiptr(count * sizeof(double)), y);
+	}
+
+	renderer.evaluate_points(variant, max_iter, x_buffer, y_buffer, count, buffers);
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+}
+
+void Gpu_chunk::wait()
+{
+	while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+	glDeleteSync(fence);
+	fence = nullptr;
+
+	if (mapped) return;
+
+	// Read back a result array, skipped if it wasn't requested
+	const auto read_back = [this]<typename T>(const Buffer& buffer, T* data)
+	{
+		if (data == nullptr) return;
+		buffer.bind(GL_COPY_READ_BUFFER);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, GLsizeiptr(count * sizeof(T)), data);
+	};
+
+	read_back(iterations_buffer, results.iterations);
+	read_back(z_x_buffer, results.z_x);
+	read_back(z_y_buffer, results.z_y);
+	read_back(distance_buffer, results.distance);
+}
+}
+
+uint64_t stream_points(Cpu_renderer&		 renderer,
+					   const Kernel_variant& variant,
+					   int					 max_iter,
+					   const Point_outputs&	 outputs,
+					   size_t				 chunk_size,
+					   const Point_reader&	 read,
+					   const Point_writer&	 write,
+					   std::stop_token		 stop)
+{
+	std::vector<double>	 x(chunk_size), y(chunk_size);
+	std::vector<int32_t> iterations(outputs.iterations ? chunk_size : 0);
+	std::vector<double>	 z_x(outputs.z ? chunk_size : 0), z_y(outputs.z ? chunk_size : 0),
+		distance(outputs.distance ? chunk_size : 0);
+
+	const Point_results results{
+		.iterations = outputs.iterations ? iterations.data() : nullptr,
+		.z_x		= outputs.z ? z_x.data() : nullptr,
+		.z_y		= outputs.z ? z_y.data() : nullptr,
+		.distance	= outputs.distance ? distance.data() : nullptr,
+	};
+
+	uint64_t evaluated = 0;
+
+	while (!stop.stop_requested())
+	{
+		const size_t count = read(x.data(), y.data(), chunk_size);
+		if (count == 0) break;
+
+		if (!renderer.evaluate_points(variant, max_iter, x.data(), y.data(), count, results, stop))
+			break;
+
+		write(evaluated, count, results);
+		evaluated += count;
+	}
+
+	return evaluated;
+}
+
+uint64_t stream_points(Gpu_renderer&		 renderer,
+					   const Kernel_variant& variant,
+					   int					 max_iter,
+					   const Point_outputs&	 outputs,
+					   size_t				 chunk_size,
+					   const Point_reader&	 read,
+					   const Point_writer&	 write,
+					   std::stop_token		 stop)
+{
+	Gpu_chunk chunks[2] = {{chunk_size, outputs}, {chunk_size, outputs}};
+
+	uint64_t read_count = 0, evaluated = 0;
+
+	// Read the next chunk into `chunk` and submit it, returns false if there is none
+	const auto submit = [&](Gpu_chunk& chunk)
+	{
+		if (stop.stop_requested()) return false;
+
+		chunk.count = read(chunk.x, chunk.y, chunk_size);
+		if (chunk.count == 0) return false;
+
+		chunk.first = read_count;
+		read_count += chunk.count;
+		chunk.submit(renderer, variant, max_iter);
+
+		return true;
+	};
+
+	bool pending = submit(chunks[0]);
+
+	for (int current = 0; pending; current ^= 1)
+	{
+		pending = submit(chunks[current ^ 1]);
+
+		auto& chunk = chunks[current];
+		chunk.wait();
+		write(chunk.first, chunk.count, chunk.results);
+		evaluated += chunk.count;
+	}
+
+	return evaluated;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "precision-selector.hpp"
+
+#include <cmath>
+
+namespace
+{
+// Significand bits of a tier run by a generated kernel
+int get_significand_bits(Precision_tier tier)
+{
+	switch (tier)
+	{
+	case Precision_tier::Fp32:
+		return 24;
+	case Precision_tier::Fp64:
+		return 53;
+	case Precision_tier::Double_double:
+		return 106;
+	default:
+		return 53;
+	}
+}
+}
+
+const char* get_tier_name(Precision_tier tier)
+{
+	switch (tier)
+	{
+	case Precision_tier::Fp32:
+		return "FP32";
+	case Precision_tier::Fp64:
+		return "FP64";
+	case Precision_tier::Double_double:
+		return "Double-double";
+	case Precision_tier::Fixed128:
+		return "Fixed-point 128";
+	case Precision_tier::Perturbation:
+		return "Perturbation";
+	}
+
+	return "Unknown";
+}
+
+Kernel_precision get_kernel_precision(Precision_tier tier)
+{
+	switch (tier)
+	{
+	case Precision_tier::Fp32:
+		return Kernel_precision::Fp32;
+	case Precision_tier::Double_double:
+		return Kernel_precision::Double_double;
+	case Precision_tier::Fixed128:
+		return Kernel_precision::Fixed128;
+	default:
+		return Kernel_precision::Fp64;
+	}
+}
+
+Precision_tier get_precision_tier(Kernel_precision precision)
+{
+	switch (precision)
+	{
+	case Kernel_precision::Fp32:
+		return Precision_tier::Fp32;
+	case Kernel_precision::Double_double:
+		return Precision_tier::Double_double;
+	case Kernel_precision::Fixed128:
+		return Precision_tier::Fixed128;
+	default:
+		return Precision_tier::Fp64;
+	}
+}
+
+double Precision_selector::get_headroom(Precision_tier tier,
+										const Render_params& params,
+										int					 region_width)
+{
+	// Reference orbits are sized to the view with the default guard of limbs_for_spacing()
+	if (tier == Precision_tier::Perturbation) return 64;
+
+	const double spacing = params.size.x / region_width;
+
+	// Fixed point resolves 2^-124 everywhere, its ulp doesn't grow with the center
+	if (tier == Precision_tier::Fixed128) return std::log2(spacing) + 124;
+
+	// Orbits of boundary points pass through magnitudes around 1 even when the center is
+	// near zero, so the center is never taken as smaller than the cusp of the cardioid
+	const double magnitude
+		= std::max({std::abs(params.center.x), std::abs(params.center.y), 0.25});
+
+	// log2(spacing / ulp), ulp = 2^(exponent - significand_bits + 1)
+	return std::log2(spacing) - (std::ilogb(magnitude) - get_significand_bits(tier) + 1);
+}
+
+Precision_tier Precision_selector::select(const Render_params&			  params,
+										  int							  region_width,
+										  std::span<const Precision_tier> available)
+{
+	if (available.empty()) return tier;
+
+	// Last resort if nothing resolves the view
+	Precision_tier selected = available.back();
+
+	for (const auto candidate : available)
+	{
+		const double margin = guard_bits + (candidate < tier ? hysteresis_bits : 0);
+		if (get_headroom(candidate, params, region_width) >= margin)
+		{
+			selected = candidate;
+			break;
+		}
+	}
+
+	tier	 = selected;
+	headroom = get_headroom(tier, params, region_width);
+
+	return tier;
+}
+
+void Precision_selector::report(Precision_tier tier, float time_ms, int pixel_count)
+{
+	if (time_ms <= 0 || pixel_count <= 0) return;
+
+	const float sample = time_ms / pixel_count * 1e6f;
+	float&		value  = cost[(int)tier];
+
+	value = value == 0 ? sample : value + (sample - value) * smoothing;
+}
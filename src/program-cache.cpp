@@ -0,0 +1,179 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "program-cache.hpp"
+
+#include <random>
+
+static const uint32_t cache_magic	= 0x4350424d;  // "MBPC"
+static const uint32_t cache_version = 1;
+
+struct Cache_header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;
+	uint32_t length;
+};
+
+// 64-bit FNV-1a
+static uint64_t fnv1a(uint64_t hash, std::string_view data)
+{
+	for (unsigned char c : data)
+	{
+		hash ^= c;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static std::string get_gl_string(GLenum name)
+{
+	const auto* str = (const char*)glGetString(name);
+	return str == nullptr ? "" : str;
+}
+
+Program_cache::Program_cache(std::filesystem::path directory) :
+	directory(std::move(directory))
+{
+	GLint format_count = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+
+	if (format_count <= 0)
+	{
+		logger.log(Logger::Warning, "Driver supports no program binary format, cache disabled");
+		return;
+	}
+
+	driver_id = get_gl_string(GL_VENDOR) + '\n' + get_gl_string(GL_RENDERER) + '\n'
+			  + get_gl_string(GL_VERSION);
+
+	std::error_code err;
+	std::filesystem::create_directories(this->directory, err);
+	if (err)
+	{
+		logger.log(Logger::Warning,
+				   "Can't create shader cache directory {}: {}",
+				   this->directory.string(),
+				   err.message());
+		return;
+	}
+
+	enabled = true;
+}
+
+uint64_t Program_cache::hash_key(const std::vector<std::string_view>& sources) const
+{
+	uint64_t hash = fnv1a(0xcbf29ce484222325ull, driver_id);
+	for (const auto& source : sources)
+	{
+		// Hash the length too, so that moving text across stage boundaries changes the key
+		hash = fnv1a(hash, std::to_string(source.size()));
+		hash = fnv1a(hash, source);
+	}
+	return hash;
+}
+
+std::filesystem::path Program_cache::entry_path(uint64_t key) const
+{
+	return directory / std::format("{:016x}.bin", key);
+}
+
+std::optional<Program_binary> Program_cache::load(uint64_t key) const
+{
+	std::ifstream file(entry_path(key), std::ios::binary);
+	if (!file.is_open()) return std::nullopt;
+
+	Cache_header header;
+	if (!file.read((char*)&header, sizeof(header))) return std::nullopt;
+
+	if (header.magic != cache_magic || header.version != cache_version || header.key != key)
+		return std::nullopt;
+
+	Program_binary binary;
+	binary.format = header.format;
+	binary.data.resize(header.length);
+	if (!file.read(binary.data.data(), header.length)) return std::nullopt;
+
+	return binary;
+}
+
+void Program_cache::store(uint64_t key, const Program_binary& binary) const
+{
+	// Write to a temporary file first, so that a concurrent reader never sees a partial entry.
+	// Unique per writer, the UI and the worker context may store the same program at once.
+	const auto path		 = entry_path(key);
+	auto	   temp_path = path;
+	temp_path += std::format(".{:08x}.tmp", std::random_device()());
+
+	bool written;
+
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) return;
+
+		const Cache_header header{
+			cache_magic, cache_version, key, binary.format, (uint32_t)binary.data.size()};
+		file.write((const char*)&header, sizeof(header));
+		file.write(binary.data.data(), (std::streamsize)binary.data.size());
+
+		file.close();
+		written = !file.fail();
+	}
+
+	// Don't leave the partial or orphaned temporary file behind
+	std::error_code err;
+	if (!written)
+	{
+		logger.log(Logger::Warning, "Can't write shader cache entry {:016x}", key);
+		std::filesystem::remove(temp_path, err);
+		return;
+	}
+
+	std::filesystem::rename(temp_path, path, err);
+	if (err)
+	{
+		logger.log(Logger::Warning, "Can't store shader cache entry: {}", err.message());
+		std::filesystem::remove(temp_path, err);
+	}
+}
+
+Result<Shader, std::string> Program_cache::get(
+	const std::vector<std::string_view>&				sources,
+	const std::function<Result<Shader, std::string>()>& compile)
+{
+	if (!enabled) return compile();
+
+	const auto key = hash_key(sources);
+
+	if (auto binary = load(key); binary.has_value())
+	{
+		auto result = Shader::create_from_binary(*binary);
+		if (result.ok()) return result;
+
+		logger.log(Logger::Warning, "Cached program {:016x} rejected, recompiling", key);
+	}
+
+	auto result = compile();
+	if (!result.ok()) return result;
+
+	auto shader = result.get();
+	if (auto binary = shader.get_binary(); binary.has_value()) store(key, *binary);
+
+	return shader;
+}
@@ -18,8 +18,8 @@
 
 /* STATIC MEMBERS */
 
-size_t						   Quad_mesh::use_count	 = 0;
-GLuint						   Quad_mesh::shared_vao = 0, Quad_mesh::shared_vbo = 0;
+thread_local size_t			   Quad_mesh::use_count	 = 0;
+thread_local GLuint			   Quad_mesh::shared_vao = 0, Quad_mesh::shared_vbo = 0;
 const std::array<glm::vec2, 4> Quad_mesh::quad_data
 	= {glm::vec2{-1.0, -1.0}, glm::vec2{1.0, -1.0}, glm::vec2{1.0, 1.0}, glm::vec2{-1.0, 1.0}};
 
@@ -0,0 +1,348 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "reference-orbit-store.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <random>
+
+static const uint32_t orbit_magic	= 0x4f52424d;  // "MBRO"
+static const uint32_t orbit_version = 1;
+
+// File layout: header, center, last iterate, segment blocks from `block_offset` and checkpoints
+// from `checkpoint_offset`. A block holds `segment_length` x values followed by as many y
+// values in the encoding of the orbit, the last one padded with zeros. Fixed-point numbers
+// are stored as their limbs.
+struct Orbit_file_header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t formula;
+	uint32_t encoding;
+	int32_t	 limbs;
+	int32_t	 segment_length;
+	int32_t	 length;
+	int32_t	 max_iter;
+	uint64_t block_offset;
+	uint64_t checkpoint_offset;
+};
+
+static_assert(sizeof(Orbit_file_header) == 48);
+
+static constexpr size_t block_alignment = 64;
+
+// 64-bit FNV-1a
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= ((const unsigned char*)data)[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static size_t complex_bytes(int limbs)
+{
+	return 2 * limbs * sizeof(uint64_t);
+}
+
+static void write_complex(std::ofstream& file, const Fixed_complex& z)
+{
+	const int limbs = z.x.get_limbs();
+	file.write((const char*)z.x.get_words(), (std::streamsize)(limbs * sizeof(uint64_t)));
+	file.write((const char*)z.y.get_words(), (std::streamsize)(limbs * sizeof(uint64_t)));
+}
+
+static Fixed_complex read_complex(const std::byte* data, int limbs)
+{
+	return {Fixed_real::from_words((const uint64_t*)data, limbs),
+			Fixed_real::from_words((const uint64_t*)data + limbs, limbs)};
+}
+
+Reference_orbit_store::Reference_orbit_store(std::filesystem::path directory) :
+	directory(std::move(directory))
+{
+	std::error_code err;
+	std::filesystem::create_directories(this->directory, err);
+	if (err)
+	{
+		logger.log(Logger::Warning,
+				   "Can't create reference orbit directory {}: {}",
+				   this->directory.string(),
+				   err.message());
+		return;
+	}
+
+	enabled = true;
+}
+
+std::filesystem::path Reference_orbit_store::entry_path(const Key& key) const
+{
+	const int limbs = key.center.x.get_limbs();
+
+	uint64_t hash = 0xcbf29ce484222325ull;
+	hash		  = fnv1a(hash, key.center.x.get_words(), limbs * sizeof(uint64_t));
+	hash		  = fnv1a(hash, key.center.y.get_words(), limbs * sizeof(uint64_t));
+
+	const int32_t fields[] = {limbs,
+							  (int32_t)key.formula,
+							  (int32_t)key.settings.encoding,
+							  key.settings.segment_length};
+	hash = fnv1a(hash, fields, sizeof(fields));
+
+	return directory / std::format("{:016x}.orbit", hash);
+}
+
+std::shared_ptr<Reference_orbit> Reference_orbit_store::load(const std::filesystem::path& path,
+															 const Key&					  key,
+															 Fixed_complex&				  last)
+{
+	if (!std::filesystem::exists(path)) return nullptr;
+
+	auto mapped = Mapped_file::open(path);
+	if (!mapped.ok())
+	{
+		logger.log(Logger::Warning, "Can't map reference orbit {}: {}", path.string(), mapped.get_err());
+		return nullptr;
+	}
+	auto file = mapped.get();
+
+	const int limbs = key.center.x.get_limbs();
+
+	Orbit_file_header header;
+	if (file.size() < sizeof(header) + 2 * complex_bytes(limbs)) return nullptr;
+	std::memcpy(&header, file.data(), sizeof(header));
+
+	if (header.magic != orbit_magic || header.version != orbit_version
+		|| header.formula != (uint32_t)key.formula
+		|| header.encoding != (uint32_t)key.settings.encoding || header.limbs != limbs
+		|| header.segment_length != key.settings.segment_length || header.length < 0
+		|| header.length > header.max_iter)
+		return nullptr;
+
+	// The hash of the file name may collide
+	if (read_complex(file.data() + sizeof(header), limbs) != key.center) return nullptr;
+
+	const size_t segment_count = header.length / header.segment_length + 1,
+				 block_bytes   = 2 * (size_t)header.segment_length
+							 * Reference_orbit::value_size(key.settings.encoding);
+
+	if (header.block_offset % block_alignment != 0
+		|| header.block_offset < sizeof(header) + 2 * complex_bytes(limbs)
+		|| header.checkpoint_offset < header.block_offset + segment_count * block_bytes
+		|| header.checkpoint_offset + segment_count * complex_bytes(limbs) > file.size())
+		return nullptr;
+
+	last = read_complex(file.data() + sizeof(header) + complex_bytes(limbs), limbs);
+
+	std::shared_ptr<Reference_orbit> orbit(
+		new Reference_orbit(key.center, header.max_iter, key.settings));
+	orbit->length = header.length;
+
+	for (size_t i = 0; i < segment_count; i++)
+		orbit->checkpoints.push_back(
+			read_complex(file.data() + header.checkpoint_offset + i * complex_bytes(limbs), limbs));
+
+	orbit->blocks = file.data() + header.block_offset;
+	orbit->file	  = std::move(file);
+
+	return orbit;
+}
+
+bool Reference_orbit_store::write(const std::filesystem::path& path,
+								  const Key&				   key,
+								  int						   max_iter,
+								  const Reference_orbit*	   prefix,
+								  const Fixed_complex&		   last,
+								  std::stop_token			   stop,
+								  bool&						   stopped)
+{
+	const auto& center		   = key.center;
+	const int	limbs		   = center.x.get_limbs();
+	const int	segment_length = key.settings.segment_length;
+	const auto	encoding	   = key.settings.encoding;
+	const auto	value_size	   = Reference_orbit::value_size(encoding);
+
+	// Unique per writer, processes extending the same entry at once each rename a whole file
+	auto temp_path = path;
+	temp_path += std::format(".{:08x}.tmp", std::random_device()());
+
+	std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) return false;
+
+	Orbit_file_header header{
+		.magic			   = orbit_magic,
+		.version		   = orbit_version,
+		.formula		   = (uint32_t)key.formula,
+		.encoding		   = (uint32_t)encoding,
+		.limbs			   = limbs,
+		.segment_length	   = segment_length,
+		.length			   = 0,
+		.max_iter		   = max_iter,
+		.block_offset	   = (sizeof(header) + 2 * complex_bytes(limbs) + block_alignment - 1)
+						 / block_alignment * block_alignment,
+		.checkpoint_offset = 0,
+	};
+
+	// Header and last iterate are rewritten once known
+	file.write((const char*)&header, sizeof(header));
+	write_complex(file, center);
+	write_complex(file, last);
+	file.seekp((std::streamoff)header.block_offset);
+
+	std::vector<std::byte>	   block(2 * segment_length * value_size);
+	std::vector<Fixed_complex> checkpoints;
+	int						   first = 0;
+
+	if (prefix != nullptr)
+	{
+		// Whole blocks are copied as they are, the values of a partial last block seed the
+		// first new one
+		const int	 stored		 = prefix->length + 1;
+		const size_t full_blocks = stored / segment_length;
+
+		file.write((const char*)prefix->blocks, (std::streamsize)(full_blocks * block.size()));
+		if (stored % segment_length != 0)
+			std::memcpy(block.data(), prefix->blocks + full_blocks * block.size(), block.size());
+
+		checkpoints = prefix->checkpoints;
+		first		= stored;
+	}
+
+	const auto store_value = [&](std::byte* destination, double value)
+	{
+		if (encoding == Orbit_encoding::Float)
+		{
+			const auto narrow = (float)value;
+			std::memcpy(destination, &narrow, sizeof(narrow));
+		}
+		else
+			std::memcpy(destination, &value, sizeof(value));
+	};
+
+	Fixed_complex z = prefix != nullptr ? last.step(center) : last;
+
+	const int end = Reference_orbit::iterate(
+		center,
+		z,
+		first,
+		max_iter,
+		segment_length,
+		stop,
+		[&](int n, glm::dvec2 value)
+		{
+			const int index = n % segment_length;
+			store_value(block.data() + index * value_size, value.x);
+			store_value(block.data() + (segment_length + index) * value_size, value.y);
+
+			if (index == segment_length - 1)
+			{
+				file.write((const char*)block.data(), (std::streamsize)block.size());
+				std::fill(block.begin(), block.end(), std::byte(0));
+			}
+		},
+		[&](int, const Fixed_complex& state) { checkpoints.push_back(state); });
+
+	if (end < 0)
+	{
+		stopped = true;
+		file.close();
+		std::filesystem::remove(temp_path);
+		return false;
+	}
+
+	if ((end + 1) % segment_length != 0)
+		file.write((const char*)block.data(), (std::streamsize)block.size());
+
+	header.length			 = end;
+	header.checkpoint_offset = (uint64_t)file.tellp();
+	for (const auto& checkpoint : checkpoints) write_complex(file, checkpoint);
+
+	file.seekp(0);
+	file.write((const char*)&header, sizeof(header));
+	write_complex(file, center);
+	write_complex(file, z);
+
+	file.close();
+	if (!file)
+	{
+		std::filesystem::remove(temp_path);
+		return false;
+	}
+
+	// Mappings of the replaced file stay valid, readers switch over on their next lookup
+	std::error_code err;
+	std::filesystem::rename(temp_path, path, err);
+	if (err)
+	{
+		logger.log(Logger::Warning, "Can't store reference orbit: {}", err.message());
+		std::filesystem::remove(temp_path);
+		return false;
+	}
+
+	return true;
+}
+
+std::shared_ptr<const Reference_orbit> Reference_orbit_store::get(
+	const Fixed_complex&			 center,
+	int								 max_iter,
+	Kernel_formula					 formula,
+	const Reference_orbit::Settings& settings,
+	std::stop_token					 stop)
+{
+	if (!enabled) return Reference_orbit::compute(center, max_iter, settings, stop);
+
+	Reference_orbit::Settings key_settings = settings;
+	key_settings.segment_length			   = std::max(key_settings.segment_length, 1);
+
+	const Key  key{center, formula, key_settings};
+	const auto path = entry_path(key);
+
+	Fixed_complex last{Fixed_real(center.x.get_limbs()), Fixed_real(center.x.get_limbs())};
+	auto		  prefix = load(path, key, last);
+
+	if (prefix != nullptr && (prefix->escaped() || prefix->max_iter >= max_iter))
+	{
+		std::lock_guard lock(mutex);
+		stats.hits++;
+		return prefix;
+	}
+
+	bool stopped = false;
+	if (write(path, key, max_iter, prefix.get(), last, stop, stopped))
+	{
+		{
+			std::lock_guard lock(mutex);
+			(prefix != nullptr ? stats.extensions : stats.misses)++;
+		}
+
+		if (auto orbit = load(path, key, last); orbit != nullptr) return orbit;
+	}
+
+	if (stopped) return nullptr;
+
+	logger.log(Logger::Warning, "Reference orbit not stored, computing it in memory");
+	return Reference_orbit::compute(center, max_iter, settings, stop);
+}
+
+Reference_orbit_store::Stats Reference_orbit_store::get_stats() const
+{
+	std::lock_guard lock(mutex);
+	return stats;
+}
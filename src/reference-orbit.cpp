@@ -0,0 +1,241 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "reference-orbit.hpp"
+
+#include <algorithm>
+
+void Reference_orbit::Segment::push(glm::dvec2 z, Orbit_encoding encoding)
+{
+	if (encoding == Orbit_encoding::Float)
+	{
+		x_float.push_back((float)z.x);
+		y_float.push_back((float)z.y);
+	}
+	else
+	{
+		x.push_back(z.x);
+		y.push_back(z.y);
+	}
+}
+
+void Reference_orbit::Cursor::fetch(int n)
+{
+	const auto& settings = orbit.settings;
+	const int	index	 = n / settings.segment_length;
+
+	begin = index * settings.segment_length;
+	end	  = std::min(begin + settings.segment_length, orbit.length + 1);
+
+	if (orbit.file.has_value())
+	{
+		// Blocks of `segment_length` x values followed by as many y values
+		const size_t value_size = Reference_orbit::value_size(settings.encoding);
+		const auto*	 block		= orbit.blocks + (size_t)index * 2 * settings.segment_length * value_size;
+		const auto*	 block_y	= block + settings.segment_length * value_size;
+
+		if (settings.encoding == Orbit_encoding::Float)
+		{
+			x_float = (const float*)block;
+			y_float = (const float*)block_y;
+		}
+		else
+		{
+			x = (const double*)block;
+			y = (const double*)block_y;
+		}
+		return;
+	}
+
+	segment = orbit.get_segment(index);
+
+	if (settings.encoding == Orbit_encoding::Float)
+	{
+		x_float = segment->x_float.data();
+		y_float = segment->y_float.data();
+	}
+	else
+	{
+		x = segment->x.data();
+		y = segment->y.data();
+	}
+}
+
+Reference_orbit::Reference_orbit(const Fixed_complex& center, int max_iter, const Settings& settings) :
+	center(center),
+	max_iter(max_iter),
+	settings(settings)
+{
+	this->settings.segment_length = std::max(this->settings.segment_length, 1);
+}
+
+int Reference_orbit::iterate(const Fixed_complex&										 center,
+							 Fixed_complex&												 z,
+							 int														 n,
+							 int														 max_iter,
+							 int														 segment_length,
+							 std::stop_token											 stop,
+							 const std::function<void(int n, glm::dvec2 value)>&		 emit,
+							 const std::function<void(int n, const Fixed_complex& z)>& checkpoint)
+{
+	for (;; n++)
+	{
+		if (n % segment_length == 0)
+		{
+			if (stop.stop_requested()) return -1;
+			checkpoint(n, z);
+		}
+
+		const auto value = z.to_double();
+		emit(n, value);
+
+		if (n >= max_iter || value.x * value.x + value.y * value.y >= escape_radius2) return n;
+
+		z = z.step(center);
+	}
+}
+
+std::shared_ptr<Reference_orbit> Reference_orbit::compute(const Fixed_complex& center,
+														  int				   max_iter,
+														  const Settings&	   settings,
+														  std::stop_token	   stop)
+{
+	std::shared_ptr<Reference_orbit> orbit(new Reference_orbit(center, max_iter, settings));
+
+	Fixed_complex			 z{Fixed_real(center.x.get_limbs()), Fixed_real(center.x.get_limbs())};
+	std::shared_ptr<Segment> segment;
+
+	// Segments are inserted once complete, evicting older ones beyond the budget already
+	const auto finish_segment = [&]
+	{
+		if (segment == nullptr) return;
+
+		std::lock_guard lock(orbit->mutex);
+		orbit->insert((int)orbit->segments.size() - 1, std::move(segment));
+	};
+
+	const int last = iterate(
+		center,
+		z,
+		0,
+		max_iter,
+		orbit->settings.segment_length,
+		stop,
+		[&](int, glm::dvec2 value) { segment->push(value, orbit->settings.encoding); },
+		[&](int, const Fixed_complex& state)
+		{
+			finish_segment();
+			orbit->checkpoints.push_back(state);
+			orbit->segments.emplace_back();
+			orbit->last_use.push_back(0);
+			segment = std::make_shared<Segment>();
+		});
+
+	if (last < 0) return nullptr;
+
+	orbit->length = last;
+	finish_segment();
+
+	return orbit;
+}
+
+std::shared_ptr<const Reference_orbit::Segment> Reference_orbit::get_segment(int index) const
+{
+	{
+		std::lock_guard lock(mutex);
+		last_use[index] = ++use_clock;
+		if (segments[index] != nullptr) return segments[index];
+	}
+
+	// Regenerated outside the lock so other threads keep reading resident segments. Two
+	// threads may regenerate the same segment, both produce identical values.
+	auto segment = generate(index);
+
+	std::lock_guard lock(mutex);
+	regenerated_segments++;
+	if (segments[index] == nullptr) insert(index, std::move(segment));
+
+	return segments[index];
+}
+
+std::shared_ptr<Reference_orbit::Segment> Reference_orbit::generate(int index) const
+{
+	const int begin = index * settings.segment_length,
+			  end	= std::min(begin + settings.segment_length, length + 1);
+
+	auto segment = std::make_shared<Segment>();
+	auto z		 = checkpoints[index];
+
+	// Same operations as compute(), so the iterates are bitwise identical
+	iterate(
+		center,
+		z,
+		begin,
+		end - 1,
+		settings.segment_length,
+		{},
+		[&](int, glm::dvec2 value) { segment->push(value, settings.encoding); },
+		[](int, const Fixed_complex&) {});
+
+	return segment;
+}
+
+void Reference_orbit::insert(int index, std::shared_ptr<Segment> segment) const
+{
+	resident_bytes += segment->bytes();
+	segments[index] = std::move(segment);
+	last_use[index] = ++use_clock;
+
+	while (resident_bytes > settings.memory_budget)
+	{
+		// Never evicts the segment just inserted, the budget holds at least one
+		int victim = -1;
+		for (int i = 0; i < (int)segments.size(); i++)
+			if (i != index && segments[i] != nullptr && (victim < 0 || last_use[i] < last_use[victim]))
+				victim = i;
+
+		if (victim < 0) break;
+
+		resident_bytes -= segments[victim]->bytes();
+		segments[victim].reset();
+	}
+}
+
+void Reference_orbit::evict_all() const
+{
+	std::lock_guard lock(mutex);
+	for (auto& segment : segments) segment.reset();
+	resident_bytes = 0;
+}
+
+Reference_orbit_stats Reference_orbit::get_stats() const
+{
+	std::lock_guard lock(mutex);
+
+	Reference_orbit_stats stats;
+	stats.length			   = length;
+	stats.segment_count		   = length / settings.segment_length + 1;
+	stats.resident_segments	   = (int)std::count_if(segments.begin(),
+												segments.end(),
+												[](const auto& segment) { return segment != nullptr; });
+	stats.resident_bytes	   = resident_bytes;
+	stats.checkpoint_bytes	   = checkpoints.size() * sizeof(Fixed_complex);
+	stats.regenerated_segments = regenerated_segments;
+	stats.mapped_bytes		   = file.has_value() ? file->size() : 0;
+
+	return stats;
+}
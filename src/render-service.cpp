@@ -0,0 +1,129 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render-service.hpp"
+
+Render_service::Render_service(Cpu_renderer& renderer) :
+	renderer(renderer),
+	thread([this](std::stop_token stop) { run(stop); })
+{
+}
+
+Render_service::~Render_service()
+{
+	{
+		std::lock_guard lock(mutex);
+		job.request_stop();
+	}
+
+	thread.request_stop();
+}
+
+void Render_service::submit(const Render_request& request)
+{
+	std::lock_guard lock(mutex);
+
+	if (rendering) cancelled_count++;
+
+	job.request_stop();
+	job = std::stop_source();
+
+	pending = request;
+	finished.reset();
+
+	wakeup.notify_one();
+}
+
+std::optional<Render_result> Render_service::poll()
+{
+	std::lock_guard lock(mutex);
+
+	auto result = std::move(finished);
+	finished.reset();
+	return result;
+}
+
+bool Render_service::busy() const
+{
+	std::lock_guard lock(mutex);
+	return rendering || pending.has_value();
+}
+
+uint64_t Render_service::get_cancelled_count() const
+{
+	std::lock_guard lock(mutex);
+	return cancelled_count;
+}
+
+void Render_service::run(std::stop_token stop)
+{
+	for (;;)
+	{
+		Render_result	result;
+		std::stop_token cancel;
+		Task			task;
+
+		{
+			std::unique_lock lock(mutex);
+			if (!wakeup.wait(lock, stop, [this] { return pending.has_value() || !tasks.empty(); }))
+				return;
+
+			if (pending.has_value())
+			{
+				result.request = *pending;
+				pending.reset();
+
+				cancel	  = job.get_token();
+				rendering = true;
+			}
+			else
+			{
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+		}
+
+		if (task)
+		{
+			task(renderer, stop);
+			continue;
+		}
+
+		auto& request = result.request;
+
+		if (request.iteration_controller.has_value())
+			request.params.max_iter
+				= request.iteration_controller->update(request.params, request.variant, cancel);
+
+		renderer.use_symmetry	   = request.use_symmetry;
+		renderer.certify_tiles	   = request.certify_tiles;
+		renderer.adaptive_limits   = request.adaptive_limits;
+		renderer.perturbation	   = request.perturbation;
+		renderer.nucleus_reference = request.nucleus_reference;
+
+		const bool completed = renderer.render(
+			request.params, request.variant, request.width, request.height, result.map, cancel);
+
+		std::lock_guard lock(mutex);
+		rendering = false;
+
+		// A newer request may have arrived after the last tile was checked
+		if (!completed || cancel.stop_requested()) continue;
+
+		result.stats = renderer.get_stats();
+		finished	 = std::move(result);
+	}
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "resolution-governor.hpp"
+
+void Resolution_governor::report(float frame_scale, float time_ms, bool interactive)
+{
+	if (frame_scale <= 0.0f || time_ms <= 0.0f) return;
+
+	if (interactive)
+	{
+		interactive_frame_count++;
+		if (time_ms > target_ms) miss_count++;
+	}
+
+	const float cost = time_ms / (frame_scale * frame_scale);
+	full_cost_ms	 = full_cost_ms == 0.0f ? cost : full_cost_ms + (cost - full_cost_ms) * smoothing;
+
+	scale = glm::clamp(std::sqrt(target_ms * headroom / full_cost_ms), min_scale, 1.0f);
+}
@@ -15,50 +15,201 @@
  */
 
 #include "shader.hpp"
+#include "program-cache.hpp"
+
+#include <algorithm>
 
 Result<Shader, std::string> Shader::create_shader(const std::string& vert, const std::string& frag)
 {
-	GLuint vertex_shader   = glCreateShader(GL_VERTEX_SHADER);
-	GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+	return create_program({{GL_VERTEX_SHADER, vert}, {GL_FRAGMENT_SHADER, frag}});
+}
 
-	const char* vertex_cstr	  = vert.c_str();
-	const char* fragment_cstr = frag.c_str();
+Result<Shader, std::string> Shader::create_program(const std::vector<Shader_stage>& stages)
+{
+	std::vector<GLuint> shaders;
 
-	glShaderSource(vertex_shader, 1, &vertex_cstr, nullptr);
-	glCompileShader(vertex_shader);
+	auto delete_shaders = [&]
+	{
+		for (auto shader : shaders) glDeleteShader(shader);
+	};
 
-	GLint success;
-	glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
-	if (!success)
+	for (const auto& [type, source] : stages)
 	{
-		GLchar info_log[512];
-		glGetShaderInfoLog(vertex_shader, 512, nullptr, info_log);
-		return std::string(info_log);
+		GLuint		shader = glCreateShader(type);
+		const char* cstr   = source.c_str();
+		shaders.push_back(shader);
+
+		glShaderSource(shader, 1, &cstr, nullptr);
+		glCompileShader(shader);
+
+		GLint success;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			GLchar info_log[512];
+			glGetShaderInfoLog(shader, 512, nullptr, info_log);
+			delete_shaders();
+			return std::string(info_log);
+		}
 	}
 
-	glShaderSource(fragment_shader, 1, &fragment_cstr, nullptr);
-	glCompileShader(fragment_shader);
+	GLuint program = glCreateProgram();
+	for (auto shader : shaders) glAttachShader(program, shader);
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(program);
+
+	delete_shaders();
 
-	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
+	GLint success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
 	if (!success)
 	{
 		GLchar info_log[512];
-		glGetShaderInfoLog(fragment_shader, 512, nullptr, info_log);
+		glGetProgramInfoLog(program, 512, nullptr, info_log);
+		glDeleteProgram(program);
 		return std::string(info_log);
 	}
 
+	return Shader(program);
+}
+
+Result<Shader, std::string> Shader::create_from_binary(const Program_binary& binary)
+{
 	GLuint program = glCreateProgram();
-	glAttachShader(program, vertex_shader);
-	glAttachShader(program, fragment_shader);
-	glLinkProgram(program);
+	glProgramBinary(program, binary.format, binary.data.data(), (GLsizei)binary.data.size());
 
+	// Drivers reject binaries from other driver builds or hardware with a failed link status
+	GLint success;
 	glGetProgramiv(program, GL_LINK_STATUS, &success);
 	if (!success)
 	{
-		GLchar info_log[512];
-		glGetProgramInfoLog(program, 512, nullptr, info_log);
-		return std::string(info_log);
+		glDeleteProgram(program);
+		return std::string("Program binary rejected by driver");
 	}
 
 	return Shader(program);
+}
+
+std::optional<Program_binary> Shader::get_binary() const
+{
+	GLint length = 0;
+	glGetProgramiv(*ptr, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return std::nullopt;
+
+	Program_binary binary;
+	binary.data.resize(length);
+	glGetProgramBinary(*ptr, length, nullptr, &binary.format, binary.data.data());
+
+	return binary;
+}
+
+Shader_reflection Shader_reflection::reflect(GLuint program)
+{
+	Shader_reflection reflection;
+
+	GLint uniform_count = 0, block_count = 0, max_name_length = 0;
+	glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniform_count);
+	glGetProgramInterfaceiv(program, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &block_count);
+	glGetProgramInterfaceiv(program, GL_UNIFORM, GL_MAX_NAME_LENGTH, &max_name_length);
+
+	std::string name_buffer(std::max(max_name_length, 1), '\0');
+
+	auto get_name = [&](GLenum interface, GLuint index) -> std::string
+	{
+		GLsizei length = 0;
+		glGetProgramResourceName(
+			program, interface, index, (GLsizei)name_buffer.size(), &length, name_buffer.data());
+		return name_buffer.substr(0, length);
+	};
+
+	// Blocks first, so that block members can be attached to them
+	GLint max_block_name_length = 0;
+	glGetProgramInterfaceiv(program, GL_UNIFORM_BLOCK, GL_MAX_NAME_LENGTH, &max_block_name_length);
+	if (max_block_name_length > max_name_length) name_buffer.resize(max_block_name_length);
+
+	std::vector<std::string> block_names(block_count);
+	for (GLint i = 0; i < block_count; i++)
+	{
+		const GLenum props[] = {GL_BUFFER_DATA_SIZE, GL_BUFFER_BINDING};
+		GLint		 values[2];
+		glGetProgramResourceiv(program, GL_UNIFORM_BLOCK, i, 2, props, 2, nullptr, values);
+
+		block_names[i] = get_name(GL_UNIFORM_BLOCK, i);
+		reflection.blocks.emplace(block_names[i],
+								  Uniform_block_info{(GLuint)i, values[0], values[1], {}});
+	}
+
+	for (GLint i = 0; i < uniform_count; i++)
+	{
+		const GLenum props[] = {GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE, GL_BLOCK_INDEX, GL_OFFSET};
+		GLint		 values[5];
+		glGetProgramResourceiv(program, GL_UNIFORM, i, 5, props, 5, nullptr, values);
+
+		auto name = get_name(GL_UNIFORM, i);
+
+		if (values[3] >= 0)
+			reflection.blocks[block_names[values[3]]].member_offsets.emplace(name, values[4]);
+		else
+			reflection.uniforms.emplace(name, Uniform_info{values[0], (GLenum)values[1], values[2]});
+	}
+
+	return reflection;
+}
+
+
+std::string Shader_variant_cache::inject_defines(const std::string& source, const Defines& defines)
+{
+	// #version must stay the first directive, so the defines go right after it
+	size_t insert_pos = 0;
+	if (source.starts_with("#version"))
+	{
+		insert_pos = source.find('\n');
+		insert_pos = insert_pos == std::string::npos ? source.size() : insert_pos + 1;
+	}
+
+	std::string define_block;
+	for (const auto& [name, value] : defines)
+		define_block += value.empty() ? std::format("#define {}\n", name)
+									  : std::format("#define {} {}\n", name, value);
+
+	// Keep the line numbers of compile errors pointing into the template
+	const auto template_line = std::count(source.begin(), source.begin() + insert_pos, '\n') + 1;
+	define_block += std::format("#line {}\n", template_line);
+
+	auto result = source;
+	result.insert(insert_pos, define_block);
+	return result;
+}
+
+Result<Shader, std::string> Shader_variant_cache::get(const Defines& defines)
+{
+	std::string key;
+	for (const auto& [name, value] : defines) key += name + '=' + value + ';';
+
+	if (auto find = variants.find(key); find != variants.end()) return Shader(find->second);
+
+	std::vector<Shader_stage> variant_stages;
+	for (const auto& [type, source] : stages)
+		variant_stages.push_back({type, inject_defines(source, defines)});
+
+	auto compile = [&]
+	{
+		return Shader::create_program(variant_stages);
+	};
+
+	std::vector<std::string_view> sources;
+	for (const auto& stage : variant_stages) sources.push_back(stage.source);
+
+	auto result = program_cache != nullptr ? program_cache->get(sources, compile) : compile();
+	if (!result.ok())
+	{
+		logger.log(Logger::Error, "Failed to compile shader variant {}", key);
+		return result;
+	}
+
+	logger.log(Logger::Info, "Loaded shader variant {}", key);
+
+	auto shader = result.get();
+	variants.emplace(key, shader);
+	return shader;
 }
\ No newline at end of file
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "symmetry.hpp"
+
+#include <cmath>
+
+// Row y samples c.y = center.y + (y + 0.5 - height / 2) * dy, so rows y and y' mirror
+// exactly when y + y' = height - 1 - 2 * center.y / dy, an integer once center.y is a
+// multiple of dy / 2.
+
+glm::dvec2 snap_center_to_axis(glm::dvec2 center, double size_y, int height)
+{
+	if (height <= 0 || size_y <= 0) return center;
+
+	const double half_row = size_y / height / 2;
+	return {center.x, std::round(center.y / half_row) * half_row};
+}
+
+std::optional<Row_symmetry> find_row_symmetry(const Render_params& params, int height)
+{
+	if (height <= 0 || params.size.y <= 0) return std::nullopt;
+
+	const double dy	 = params.size.y / height;
+	const double sum = height - 1 - 2 * params.center.y / dy;
+
+	const double rounded = std::round(sum);
+	if (std::abs(sum - rounded) > 1e-6 || rounded < 1 || rounded > 2.0 * height - 3)
+		return std::nullopt;
+
+	// Mirror the rows above the axis onto the ones below it, the axis row itself is computed
+	const int mirror_sum = (int)rounded;
+	const int first		 = std::max(mirror_sum / 2 + 1, mirror_sum - height + 1),
+			  last		 = std::min(mirror_sum, height - 1);
+
+	if (first > last) return std::nullopt;
+
+	return Row_symmetry{mirror_sum, first, last};
+}
+
+Row_bands get_computed_rows(const std::optional<Row_symmetry>& symmetry, int height)
+{
+	if (!symmetry.has_value()) return {{0, height}};
+	return {{0, symmetry->first}, {symmetry->last + 1, height}};
+}
+
+Row_bands clip_rows(const Row_bands& bands, int begin, int end)
+{
+	Row_bands clipped;
+	for (const auto& [band_begin, band_end] : bands)
+	{
+		const int clipped_begin = std::max(band_begin, begin), clipped_end = std::min(band_end, end);
+		if (clipped_begin < clipped_end) clipped.emplace_back(clipped_begin, clipped_end);
+	}
+	return clipped;
+}
@@ -42,6 +42,18 @@ void Texture2d::stream_data(int			width,
 		GL_TEXTURE_2D, 0, internal_format, width, height, 0, pixel_format, data_format, data);
 }
 
+void Texture2d::update(int			x,
+					   int			y,
+					   int			width,
+					   int			height,
+					   GLenum		pixel_format,
+					   GLenum		data_format,
+					   const void* data) const
+{
+	bind();
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, pixel_format, data_format, data);
+}
+
 void Texture1d::stream_data(int			width,
 							GLint		internal_format,
 							GLenum		pixel_format,
@@ -85,6 +97,68 @@ Texture2d::~Texture2d()
 }
 
 Texture1d::~Texture1d()
+{
+	if (ptr.use_count() == 1) glDeleteTextures(1, ptr.get());
+}
+
+Texture2d_array::Texture2d_array()
+{
+	GLuint texture;
+	glGenTextures(1, &texture);
+	ptr = std::make_shared<GLuint>(texture);
+}
+
+void Texture2d_array::stream_data(int		  width,
+								  int		  height,
+								  int		  layers,
+								  GLint		  internal_format,
+								  GLenum	  pixel_format,
+								  GLenum	  data_format,
+								  const void* data) const
+{
+	bind();
+	glTexImage3D(GL_TEXTURE_2D_ARRAY,
+				 0,
+				 internal_format,
+				 width,
+				 height,
+				 layers,
+				 0,
+				 pixel_format,
+				 data_format,
+				 data);
+}
+
+void Texture2d_array::update(int		 x,
+							 int		 y,
+							 int		 layer,
+							 int		 width,
+							 int		 height,
+							 int		 layers,
+							 GLenum		 pixel_format,
+							 GLenum		 data_format,
+							 const void* data) const
+{
+	bind();
+	glTexSubImage3D(
+		GL_TEXTURE_2D_ARRAY, 0, x, y, layer, width, height, layers, pixel_format, data_format, data);
+}
+
+void Texture2d_array::set_filter(GLint filter_min, GLint filter_mag) const
+{
+	bind();
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, filter_min);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filter_mag);
+}
+
+void Texture2d_array::set_wrap(GLint wrap_s, GLint wrap_t) const
+{
+	bind();
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrap_s);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrap_t);
+}
+
+Texture2d_array::~Texture2d_array()
 {
 	if (ptr.use_count() == 1) glDeleteTextures(1, ptr.get());
 }
\ No newline at end of file
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2024 Hsin-chieh Liu
+ *
+ * Licensed under a modification version of the MIT License (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://github.com/Stehsaer/mandelbrot-viewer/blob/main/LICENSE
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "thread-pool.hpp"
+
+Thread_pool::Thread_pool(unsigned int thread_count)
+{
+	if (thread_count == 0) thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+	for (unsigned int i = 0; i + 1 < thread_count; i++)
+		threads.emplace_back([this, i] { worker_loop(i); });
+}
+
+Thread_pool::~Thread_pool()
+{
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+	}
+	start_signal.notify_all();
+
+	for (auto& thread : threads) thread.join();
+}
+
+void Thread_pool::drain(unsigned int worker)
+{
+	for (size_t index = next_task++; index < task_count; index = next_task++)
+		(*current_task)(index, worker);
+}
+
+void Thread_pool::worker_loop(unsigned int worker)
+{
+	uint64_t seen_generation = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock lock(mutex);
+			start_signal.wait(lock, [&] { return stopping || generation != seen_generation; });
+			if (stopping) return;
+
+			seen_generation = generation;
+		}
+
+		drain(worker);
+
+		{
+			std::lock_guard lock(mutex);
+			busy--;
+		}
+		done_signal.notify_one();
+	}
+}
+
+void Thread_pool::run(size_t task_count, const std::function<void(size_t, unsigned int)>& task)
+{
+	if (task_count == 0) return;
+
+	{
+		std::lock_guard lock(mutex);
+		current_task	 = &task;
+		this->task_count = task_count;
+		next_task		 = 0;
+		busy			 = (unsigned int)threads.size();
+		generation++;
+	}
+	start_signal.notify_all();
+
+	drain((unsigned int)threads.size());
+
+	std::unique_lock lock(mutex);
+	done_signal.wait(lock, [this] { return busy == 0; });
+	current_task = nullptr;
+}
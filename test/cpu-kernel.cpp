@@ -0,0 +1,131 @@
+#include <cpu-kernel.hpp>
+#include <cpu-renderer.hpp>
+
+#include <cstring>
+
+// Checks the lane-refilling SIMD kernel against the scalar reference, pixel by pixel,
+// with and without deferred bailout, for every formula the CPU renders. The overviews also
+// cover interval-certified tiles.
+int main()
+{
+	const int width = 256, height = 192;
+
+	struct View
+	{
+		Kernel_formula formula;
+		Render_params  params;
+	};
+
+	const Render_params mandelbrot_views[] = {
+		{.center = {-0.7435, 0.1314}, .size = {0.004, 0.003}, .max_iter = 1000, .palette_cycle = 256},
+		{.center = {-0.5, 0.0}, .size = {3.0, 2.25}, .max_iter = 1000, .palette_cycle = 256},
+
+		// Small islands inside tiles whose border escapes early
+		{.center = {-0.1011, 0.9563}, .size = {0.1, 0.075}, .max_iter = 5000, .palette_cycle = 256},
+
+		// Limits on and next to multiples of the bailout intervals, where unchecked blocks end
+		// right at the limit
+		{.center = {-0.5, 0.0}, .size = {3.0, 2.25}, .max_iter = 95, .palette_cycle = 256},
+		{.center = {-0.5, 0.0}, .size = {3.0, 2.25}, .max_iter = 96, .palette_cycle = 256},
+		{.center = {-0.5, 0.0}, .size = {3.0, 2.25}, .max_iter = 97, .palette_cycle = 256},
+		{.center = {-0.5, 0.0}, .size = {3.0, 2.25}, .max_iter = 111, .palette_cycle = 256},
+		{.center = {-0.5, 0.0}, .size = {3.0, 2.25}, .max_iter = 112, .palette_cycle = 256},
+	};
+
+	std::vector<View> views;
+	for (const auto& params : mandelbrot_views)
+		views.push_back({Kernel_formula::Mandelbrot, params});
+
+	// The other formulas over the whole set, and the Burning Ship also around its namesake
+	views.push_back(
+		{Kernel_formula::Burning_ship,
+		 {.center = {-0.4, -0.5}, .size = {3.6, 2.7}, .max_iter = 1000, .palette_cycle = 256}});
+	views.push_back(
+		{Kernel_formula::Burning_ship,
+		 {.center = {-1.755, -0.03}, .size = {0.08, 0.06}, .max_iter = 1000, .palette_cycle = 256}});
+	views.push_back(
+		{Kernel_formula::Tricorn,
+		 {.center = {-0.3, 0.0}, .size = {3.6, 2.7}, .max_iter = 1000, .palette_cycle = 256}});
+
+	for (auto formula :
+		 {Kernel_formula::Multibrot3,
+		  Kernel_formula::Multibrot4,
+		  Kernel_formula::Multibrot5,
+		  Kernel_formula::Multibrot6,
+		  Kernel_formula::Multibrot7,
+		  Kernel_formula::Multibrot8})
+		views.push_back(
+			{formula,
+			 {.center = {0.0, 0.0}, .size = {3.0, 2.25}, .max_iter = 1000, .palette_cycle = 256}});
+
+	// Mirrored rows sample the conjugate of c rounded differently, they are not bit-exact
+	Cpu_renderer renderer;
+	renderer.use_symmetry	 = false;
+	renderer.adaptive_limits = false;
+
+	// Tile limits are only an early-out, every pixel must keep its value
+	Cpu_renderer adaptive;
+	adaptive.use_symmetry = false;
+
+	int failures = 0;
+
+	for (const auto& [formula, params] : views)
+		for (auto coloring :
+			 {Kernel_coloring::Iteration, Kernel_coloring::Smooth, Kernel_coloring::Distance})
+			for (bool periodicity : {false, true})
+				for (int interval : {1, 8, 16})
+				{
+					Kernel_variant variant;
+					variant.formula			 = formula;
+					variant.coloring		 = coloring;
+					variant.periodicity		 = periodicity;
+					variant.bailout_interval = interval;
+
+					std::vector<glm::vec2> map;
+					renderer.render(params, variant, width, height, map);
+
+					const float pixel_size = (float)params.size.x / width;
+
+					int mismatches = 0;
+					for (int y = 0; y < height; y++)
+						for (int x = 0; x < width; x++)
+						{
+							const auto c		= pixel_to_complex(params, x, y, width, height);
+							const auto expected = cpu_evaluate(params, variant, c, pixel_size);
+							const auto actual	= map[y * width + x];
+
+							if (std::memcmp(&expected, &actual, sizeof(glm::vec2)) != 0)
+								mismatches++;
+						}
+
+					std::vector<glm::vec2> adaptive_map;
+					adaptive.render(params, variant, width, height, adaptive_map);
+
+					int cut_off = 0;
+					for (size_t i = 0; i < map.size(); i++)
+						if (std::memcmp(&map[i], &adaptive_map[i], sizeof(glm::vec2)) != 0)
+						{
+							if (adaptive_map[i].x < 0 && map[i].x >= 0) cut_off++;
+							mismatches++;
+						}
+
+					const auto& stats = renderer.get_stats();
+					std::printf(
+						"%-12s %-20s periodicity=%d interval=%-2d: %d mismatches, %.1fms, lane "
+						"utilisation %.1f%%, certified %.1f%%, adaptive %.1fms with %d pixels cut off\n",
+						Kernel_variant::name(formula),
+						Kernel_variant::name(coloring),
+						periodicity,
+						interval,
+						mismatches,
+						stats.time_ms,
+						stats.lanes.utilisation() * 100,
+						stats.certified_fraction() * 100,
+						adaptive.get_stats().time_ms,
+						cut_off);
+
+					failures += mismatches;
+				}
+
+	return failures == 0 ? 0 : 1;
+}
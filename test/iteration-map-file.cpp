@@ -0,0 +1,74 @@
+#include <cpu-renderer.hpp>
+#include <iteration-map-file.hpp>
+
+#include <cstdio>
+#include <cstring>
+
+// Round-trips rendered maps through the container bit for bit, and makes sure damaged files
+// are rejected instead of decoded into garbage
+int main()
+{
+	const int width = 300, height = 200;  // Partial tiles on both edges
+
+	const Render_params views[] = {
+		{.center = {-0.7435, 0.1314}, .size = {0.004, 0.003}, .max_iter = 1000, .palette_cycle = 256},
+		{.center = {-0.5, 0.0}, .size = {3.0, 2.0}, .max_iter = 1000, .palette_cycle = 256},
+	};
+
+	Cpu_renderer renderer;
+	Thread_pool	 pool;
+
+	const auto path = std::filesystem::temp_directory_path() / "iteration-map-test.mbim";
+
+	int failures = 0;
+
+	for (const auto& params : views)
+		for (auto coloring : {Kernel_coloring::Iteration, Kernel_coloring::Smooth, Kernel_coloring::Distance})
+		{
+			Iteration_map_image image{.params = params, .width = width, .height = height};
+			image.variant.coloring	  = coloring;
+			image.variant.periodicity = true;
+			renderer.render(image.params, image.variant, width, height, image.map);
+
+			auto saved = save_iteration_map(path, image, pool);
+			if (!saved.ok())
+			{
+				std::printf("save failed: %s\n", saved.get_err().c_str());
+				return 1;
+			}
+			const size_t file_size = saved.get();
+
+			auto loaded = load_iteration_map(path, pool);
+			if (!loaded.ok())
+			{
+				std::printf("load failed: %s\n", loaded.get_err().c_str());
+				return 1;
+			}
+			const auto restored = loaded.get();
+
+			const bool equal
+				= restored.width == width && restored.height == height && restored.variant == image.variant
+			   && std::memcmp(&restored.params, &image.params, sizeof(Render_params)) == 0
+			   && std::memcmp(restored.map.data(), image.map.data(), image.map.size() * sizeof(glm::vec2)) == 0;
+
+			std::printf("%-20s: %s, %zu bytes, %.1f%% of raw\n",
+						Kernel_variant::name(coloring),
+						equal ? "identical" : "MISMATCH",
+						file_size,
+						100.0 * file_size / (image.map.size() * sizeof(glm::vec2)));
+
+			if (!equal) failures++;
+		}
+
+	// Truncate the last save, which must now fail to load
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+	if (load_iteration_map(path, pool).ok())
+	{
+		std::printf("truncated file was accepted\n");
+		failures++;
+	}
+
+	std::filesystem::remove(path);
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+#include <cpu-renderer.hpp>
+#include <nucleus.hpp>
+
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+// |z_period| at `nucleus`, iterated in its own precision
+double residual(const Nucleus& nucleus)
+{
+	const int	  limbs = nucleus.center.x.get_limbs();
+	Fixed_complex z{Fixed_real(limbs), Fixed_real(limbs)};
+
+	for (int n = 0; n < nucleus.period; n++) z = z.step(nucleus.center);
+
+	return glm::length(z.to_double());
+}
+}
+
+// Nuclei must be found with the expected period and land on the root to the precision of the
+// search, and a reference orbit centered at one must need fewer rebases than one at the view
+// center while rendering the same pixels
+int main()
+{
+	int failures = 0;
+
+	{
+		// Largest period 3 minibrot, on the real axis
+		const auto nucleus
+			= find_nearest_nucleus(Fixed_complex::from_double({-1.75, 0.0}, 2), 0.01, 1000);
+
+		const bool found = nucleus.has_value() && nucleus->period == 3
+						&& std::abs(nucleus->center.to_double().x + 1.7548776662466927) < 1e-15;
+
+		std::printf("period 3: %s\n", found ? "found" : "missing");
+		if (!found) failures++;
+	}
+
+	// Deep in the seahorse valley, found in a 3-limb search then refined at 4 limbs from a view
+	// centered off its minibrot
+	const auto coarse = find_nearest_nucleus(
+		Fixed_complex::from_double({-0.743643887037151, 0.131825904205330}, 3), 1e-10, 10000);
+	if (!coarse.has_value())
+	{
+		std::printf("seahorse: no nucleus\n");
+		return 1;
+	}
+
+	const glm::dvec2 view_center = coarse->center.to_double() + glm::dvec2(4 * coarse->size, 0.0);
+
+	const auto nucleus = find_nearest_nucleus(
+		Fixed_complex::from_double(view_center, 4), 1e-14, 10000);
+	if (!nucleus.has_value() || nucleus->period != coarse->period)
+	{
+		std::printf("seahorse: refined nucleus missing\n");
+		return 1;
+	}
+
+	std::printf("seahorse: period %d, %d Newton steps, size %.3g, residual %.3g\n",
+				nucleus->period,
+				nucleus->newton_steps,
+				nucleus->size,
+				residual(*nucleus));
+	if (residual(*nucleus) > 1e-30) failures++;
+
+	{
+		const int			width = 64, height = 48;
+		const Render_params params{.center		  = view_center,
+								   .size		  = {2e-14, 1.5e-14},
+								   .max_iter	  = 20000,
+								   .palette_cycle = 256};
+
+		Kernel_variant variant;
+		variant.coloring = Kernel_coloring::Iteration;
+
+		uint64_t			   rebases[2];
+		std::vector<glm::vec2> maps[2];
+
+		for (bool use_nucleus : {false, true})
+		{
+			Cpu_renderer renderer;
+			renderer.perturbation	   = true;
+			renderer.nucleus_reference = use_nucleus;
+
+			renderer.render(params, variant, width, height, maps[use_nucleus]);
+			rebases[use_nucleus] = renderer.get_stats().lanes.rebases;
+		}
+
+		int mismatches = 0;
+		for (size_t i = 0; i < maps[0].size(); i++)
+			if (maps[0][i].x != maps[1][i].x) mismatches++;
+
+		std::printf("rebases: %llu at the view center, %llu at the nucleus, %d pixels differ\n",
+					(unsigned long long)rebases[0],
+					(unsigned long long)rebases[1],
+					mismatches);
+
+		if (rebases[1] >= rebases[0] || mismatches > width * height / 100) failures++;
+	}
+
+	return failures == 0 ? 0 : 1;
+}
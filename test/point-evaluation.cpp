@@ -0,0 +1,96 @@
+#include <cpu-kernel.hpp>
+#include <cpu-renderer.hpp>
+#include <point-stream.hpp>
+
+#include <cstring>
+
+// Checks point lists against the scalar reference at the same points, and that streaming them
+// in chunks that don't divide the list gives the same results as a single evaluation
+int main()
+{
+	const int width = 256, height = 192;
+
+	const Render_params params
+		= {.center = {-0.7435, 0.1314}, .size = {0.004, 0.003}, .max_iter = 1000, .palette_cycle = 256};
+
+	const size_t		count = (size_t)width * height;
+	std::vector<double> x(count), y(count);
+	for (int py = 0; py < height; py++)
+		for (int px = 0; px < width; px++)
+		{
+			const auto c	   = pixel_to_complex(params, px, py, width, height);
+			x[py * width + px] = c.x;
+			y[py * width + px] = c.y;
+		}
+
+	Cpu_renderer renderer;
+
+	int failures = 0;
+
+	for (bool periodicity : {false, true})
+		for (int interval : {1, 8})
+		{
+			Kernel_variant variant;
+			variant.coloring		 = Kernel_coloring::Iteration;
+			variant.periodicity		 = periodicity;
+			variant.bailout_interval = interval;
+
+			std::vector<int32_t> iterations(count);
+			std::vector<double>	 z_x(count), z_y(count), distance(count);
+			renderer.evaluate_points(variant,
+									 params.max_iter,
+									 x.data(),
+									 y.data(),
+									 count,
+									 {iterations.data(), z_x.data(), z_y.data(), distance.data()});
+
+			// Distances are tracked for the point list only, the reference needs them requested
+			auto reference_variant		 = variant;
+			reference_variant.derivative = true;
+
+			int mismatches = 0;
+			for (size_t i = 0; i < count; i++)
+			{
+				const auto expected = cpu_evaluate(params, reference_variant, {x[i], y[i]}, 1.0f);
+
+				const int expected_iterations = expected.x < 0 ? -1 : (int)expected.x + 1;
+				if (iterations[i] != expected_iterations) mismatches++;
+				if (iterations[i] >= 0 && std::abs(distance[i] / expected.y - 1.0) > 1e-4) mismatches++;
+			}
+
+			// Chunks of a prime size, so that every block boundary falls somewhere new
+			size_t	   read_count = 0;
+			const auto read		  = [&](double* chunk_x, double* chunk_y, size_t capacity)
+			{
+				const size_t n = std::min(capacity, count - read_count);
+				std::memcpy(chunk_x, x.data() + read_count, n * sizeof(double));
+				std::memcpy(chunk_y, y.data() + read_count, n * sizeof(double));
+				read_count += n;
+				return n;
+			};
+
+			int		   stream_mismatches = 0;
+			const auto write			 = [&](uint64_t first, size_t n, const Point_results& results)
+			{
+				for (size_t i = 0; i < n; i++)
+					if (results.iterations[i] != iterations[first + i] || results.z_x[i] != z_x[first + i]
+						|| results.z_y[i] != z_y[first + i] || results.distance[i] != distance[first + i])
+						stream_mismatches++;
+			};
+
+			const auto streamed
+				= stream_points(renderer, variant, params.max_iter, {}, 4999, read, write);
+			if (streamed != count) stream_mismatches++;
+
+			std::printf("periodicity=%d interval=%-2d: %d mismatches, %d streamed mismatches, %.1fms\n",
+						periodicity,
+						interval,
+						mismatches,
+						stream_mismatches,
+						renderer.get_stats().time_ms);
+
+			failures += mismatches + stream_mismatches;
+		}
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+#include <cpu-renderer.hpp>
+#include <reference-orbit-store.hpp>
+#include <reference-orbit.hpp>
+
+#include <cstdio>
+
+namespace
+{
+// Escape iteration of `c` iterated directly in fixed point, the output of Iteration coloring
+float fixed_point_escape(const Fixed_complex& c, int max_iter)
+{
+	Fixed_complex z{Fixed_real(c.x.get_limbs()), Fixed_real(c.x.get_limbs())};
+
+	for (int iter = 1; iter <= max_iter; iter++)
+	{
+		z				 = z.step(c);
+		const auto value = z.to_double();
+		if (value.x * value.x + value.y * value.y >= 4.0) return (float)(iter - 1);
+	}
+
+	return -1.0f;
+}
+
+int count_mismatches(const Reference_orbit& expected, const Reference_orbit& actual)
+{
+	Reference_orbit::Cursor a(expected), b(actual);
+
+	int mismatches = std::abs(expected.get_length() - actual.get_length());
+	for (int n = 0; n <= std::min(expected.get_length(), actual.get_length()); n++)
+		if (a[n] != b[n]) mismatches++;
+
+	return mismatches;
+}
+}
+
+// Regenerated segments and stored orbits, extended or not, must be bit-identical to the original
+// iterates, and perturbed pixels of a view far below double resolution must escape where a
+// direct fixed-point iteration does
+int main()
+{
+	int failures = 0;
+
+	{
+		const auto center = Fixed_complex::from_double({-0.743643887037151, 0.131825904205330}, 4);
+
+		Reference_orbit::Settings unbounded;
+		unbounded.segment_length = 1000;
+
+		Reference_orbit::Settings bounded = unbounded;
+		bounded.memory_budget			  = 2 * 1000 * 2 * sizeof(double);
+
+		const auto reference = Reference_orbit::compute(center, 20000, unbounded);
+		const auto orbit	 = Reference_orbit::compute(center, 20000, bounded);
+
+		const int mismatches = count_mismatches(*reference, *orbit);
+
+		const auto stats = orbit->get_stats();
+		std::printf("orbit: %d iterates, %d/%d segments resident, %llu regenerated, %d mismatches\n",
+					stats.length,
+					stats.resident_segments,
+					stats.segment_count,
+					(unsigned long long)stats.regenerated_segments,
+					mismatches);
+
+		if (mismatches != 0 || stats.regenerated_segments == 0
+			|| stats.resident_bytes > bounded.memory_budget)
+			failures++;
+	}
+
+	for (auto encoding : {Orbit_encoding::Double, Orbit_encoding::Float})
+	{
+		const auto directory = std::filesystem::temp_directory_path() / "reference-orbit-test";
+		std::filesystem::remove_all(directory);
+
+		// Interior point, the orbit never escapes
+		const auto center = Fixed_complex::from_double({-0.12, 0.2}, 3);
+
+		Reference_orbit::Settings settings;
+		settings.encoding		= encoding;
+		settings.segment_length = 1000;	 // Partial last blocks before and after the extension
+
+		const auto reference = Reference_orbit::compute(center, 6500, settings);
+
+		int mismatches = 0;
+		{
+			Reference_orbit_store store(directory);
+
+			mismatches += count_mismatches(
+				*Reference_orbit::compute(center, 2500, settings),
+				*store.get(center, 2500, Kernel_formula::Mandelbrot, settings));
+			mismatches
+				+= count_mismatches(*reference, *store.get(center, 6500, Kernel_formula::Mandelbrot, settings));
+
+			const auto stats = store.get_stats();
+			if (stats.misses != 1 || stats.extensions != 1) mismatches++;
+		}
+
+		// A second store on the same directory, as another process would open it
+		Reference_orbit_store store(directory);
+		const auto			  orbit = store.get(center, 4000, Kernel_formula::Mandelbrot, settings);
+		mismatches += count_mismatches(*reference, *orbit);
+
+		std::printf("store (%s): %zu bytes mapped, %llu hits, %d mismatches\n",
+					encoding == Orbit_encoding::Float ? "float" : "double",
+					orbit->get_stats().mapped_bytes,
+					(unsigned long long)store.get_stats().hits,
+					mismatches);
+
+		if (mismatches != 0 || store.get_stats().hits != 1) failures++;
+
+		std::filesystem::remove_all(directory);
+	}
+
+	{
+		// c = i is a Misiurewicz point, its neighbourhood has structure at every scale
+		const int			width = 64, height = 48;
+		const Render_params params{
+			.center = {0.0, 1.0}, .size = {1e-20, 0.75e-20}, .max_iter = 5000, .palette_cycle = 256};
+
+		Kernel_variant variant;
+		variant.coloring = Kernel_coloring::Iteration;
+
+		Cpu_renderer renderer;
+		renderer.perturbation = true;
+
+		std::vector<glm::vec2> map;
+		renderer.render(params, variant, width, height, map);
+
+		const int limbs		 = renderer.get_reference()->get_limbs();
+		int		  mismatches = 0;
+
+		for (int y = 0; y < height; y++)
+			for (int x = 0; x < width; x++)
+			{
+				const auto offset = pixel_offset(params, x, y, width, height);
+				const Fixed_complex c{
+					Fixed_real::from_double(params.center.x, limbs) + Fixed_real::from_double(offset.x, limbs),
+					Fixed_real::from_double(params.center.y, limbs) + Fixed_real::from_double(offset.y, limbs)};
+
+				if (map[y * width + x].x != fixed_point_escape(c, params.max_iter)) mismatches++;
+			}
+
+		std::printf("perturbation: %d of %d pixels differ from fixed point\n", mismatches, width * height);
+		if (mismatches != 0) failures++;
+	}
+
+	return failures == 0 ? 0 : 1;
+}